@@ -12,13 +12,80 @@
 #include <string>
 #include <vector>
 
+// Architecture parameters. The defaults describe the 3D-FPIM chip; a sweep
+// can load other values from a file of "NAME = value" lines, where NAME is
+// one of the keys below and '#' starts a comment.
+struct HardwareConfig {
+
+        // The size of column/row/depth of the crossbar array
+        unsigned int mvmuDim_ = 128;                /* MVMU_DIM */
+        unsigned int mvmuDpt_ = 64;                 /* MVMU_DPT */
+
+        unsigned int nConstantMVMUsPerCore_ = 1;    /* N_CONSTANT_MVMUS_PER_CORE */
+        unsigned int nCoresPerTile_ = 24;           /* N_CORES_PER_TILE */
+        unsigned int maxLoadStoreWidth_ = 8;        /* MAX_LOAD_STORE_WIDTH */
+        unsigned int maxSendRecvWidth_ = 8;         /* MAX_SEND_RECV_WIDTH */
+        unsigned int registerFileSize_ = 512;       /* REGISTER_FILE_SIZE */
+
+        unsigned int stackReuseLatency_ = 105;      /* STACK_REUSE_LATENCY */
+        unsigned int stackShiftLatency_ = 170;      /* STACK_SHIFT_LATENCY */
+        unsigned int prechargeLatency_ = 32;        /* PRECHARGE_LATENCY */
+        unsigned int adcLatency_ = 256;             /* ADC_LATENCY */
+
+        // Energy of the MVMU steps in pJ, used by the static estimator when
+        // set; 3DNAND_SIM exports all but the ADC energy for a circuit
+        double stackReuseEnergy_ = 0;               /* STACK_REUSE_ENERGY */
+        double stackShiftEnergy_ = 0;               /* STACK_SHIFT_ENERGY */
+        double prechargeEnergy_ = 0;                /* PRECHARGE_ENERGY */
+        double adcEnergy_ = 0;                      /* ADC_ENERGY */
+
+        // Latencies of the remaining operations, used by the simulator
+        unsigned int aluWidth_ = 32;                /* ALU_WIDTH */
+        unsigned int aluLatency_ = 1;               /* ALU_LATENCY */
+        unsigned int edramLatency_ = 8;             /* EDRAM_LATENCY */
+        unsigned int nocLatency_ = 16;              /* NOC_LATENCY */
+
+        // Capacity of the memory shared by the cores of a tile, in words
+        unsigned int tileMemorySize_ = 1 << 22;     /* TILE_MEMORY_SIZE */
+
+        // Tiles are numbered row by row on a 2D mesh network
+        unsigned int meshWidth_ = 16;               /* MESH_WIDTH */
+        unsigned int meshHeight_ = 14;              /* MESH_HEIGHT */
+
+        // Models larger than a chip span several chips with one mesh each,
+        // connected by links slower than the mesh
+        unsigned int nChips_ = 1;                   /* N_CHIPS */
+        unsigned int chipLinkLatency_ = 128;        /* CHIP_LINK_LATENCY */
+        unsigned int chipLinkWidth_ = 2;            /* CHIP_LINK_WIDTH */
+
+        static HardwareConfig load(std::string fileName);
+
+        unsigned int nTilesPerChip() const { return meshWidth_*meshHeight_; }
+        unsigned int nMaxTiles() const { return nTilesPerChip()*nChips_; }
+        unsigned int nInputRegisters() const { return mvmuDim_*nConstantMVMUsPerCore_; }
+        unsigned int nOutputRegisters() const { return mvmuDim_*nConstantMVMUsPerCore_; }
+        unsigned int inputRegistersStartAddress() const { return 0; }
+        unsigned int outputRegistersStartAddress() const
+            { return inputRegistersStartAddress() + nInputRegisters(); }
+        unsigned int registerFileStartAddress() const
+            { return outputRegistersStartAddress() + nOutputRegisters(); }
+        unsigned int registersPerCore() const
+            { return nInputRegisters() + nOutputRegisters() + registerFileSize_; }
+
+};
+
 struct CompilerOptions {
 
-        enum GraphPartitioningScheme { GP_ROW_MAJOR, GP_COL_MAJOR, GP_KAHIP, GP_RANDOM };
+        enum GraphPartitioningScheme { GP_ROW_MAJOR, GP_COL_MAJOR, GP_MULTILEVEL, GP_RANDOM,
+            GP_KAHIP = GP_MULTILEVEL /* Former name, kept for existing drivers */ };
+        enum CodeFormat { CF_TEXT, CF_BINARY };
 
         GraphPartitioningScheme gp_ = GP_ROW_MAJOR;
         bool coalesceMVMOperations_ = false;
         bool printDebugInfo_ = false;
+        bool simulate_ = true;
+        CodeFormat codeFormat_ = CF_TEXT;   /* CF_BINARY emits a single <name>.3dfpimbin */
+        std::string cacheDirectory_ = "";   /* Reuses earlier compilations stored here if set */
 
 };
 
@@ -31,7 +98,7 @@ class Model {
 
     public:
 
-        static Model create(std::string name);
+        static Model create(std::string name, HardwareConfig hardware=HardwareConfig());
         void destroy();
 
         void loadBalance();
@@ -41,6 +108,10 @@ class Model {
 
 };
 
+// Expands a binary container into the per-tile and per-core text programs,
+// named after modelName if given and after the compiled model otherwise
+void disassemble(std::string fileName, std::string modelName="");
+
 class Layer {
 
     public:
@@ -56,9 +127,13 @@ class Layer {
         unsigned int nOutChannels_;
         bool isFC_;
 
+        // FC layers have a single output pixel, so their duplicate width
+        // instead spreads the input stacks over more MVMUs
         unsigned int duplicateWidth_;
         unsigned int duplicateHeight_;
-        unsigned int nStack_;
+        unsigned int nStack_;           /* Stacks per MVMU without spreading */
+        unsigned int nInStack_;         /* Stacks of the whole input */
+        unsigned int stackLoad_;        /* Cycles each further stack adds per output pixel */
         unsigned int load_;
 
     public:
@@ -73,6 +148,9 @@ class Layer {
         ~Layer();
 
         unsigned int getNMVMU();
+        unsigned int getNFCMVMU(unsigned int split);
+        unsigned int getMaxFCSplit() { return nStack_; }
+        unsigned int getFCDepth(unsigned int split) { return (nStack_ - 1) / split + 1; }
         int setDuplicate(unsigned int duplicateWidth,
                 unsigned int duplicateHeight);
 
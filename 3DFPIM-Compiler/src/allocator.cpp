@@ -0,0 +1,153 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <algorithm>
+#include <assert.h>
+
+#include "3dfpim.h"
+
+#include "allocator.h"
+
+CoreAllocator::CoreAllocator(unsigned int startAddress, unsigned int size)
+    : startAddress_(startAddress), size_(size), tree_(4*size)
+{
+    // Children are initialized lazily from the pending assignment of the root
+    fill(1, size_, false);
+}
+
+void CoreAllocator::fill(unsigned int node, unsigned int length, bool used) {
+    Node& n = tree_[node];
+    n.prefix = n.suffix = n.longest = used ? 0 : length;
+    n.used = used ? length : 0;
+    n.pending = used ? 1 : 0;
+}
+
+void CoreAllocator::pushDown(unsigned int node, unsigned int lo, unsigned int hi) {
+    if(tree_[node].pending != -1) {
+        unsigned int mid = (lo + hi)/2;
+        fill(2*node, mid - lo, tree_[node].pending);
+        fill(2*node + 1, hi - mid, tree_[node].pending);
+        tree_[node].pending = -1;
+    }
+}
+
+void CoreAllocator::pullUp(unsigned int node, unsigned int lo, unsigned int hi) {
+    unsigned int mid = (lo + hi)/2;
+    Node& n = tree_[node];
+    const Node& l = tree_[2*node];
+    const Node& r = tree_[2*node + 1];
+    n.prefix = (l.prefix == mid - lo) ? l.prefix + r.prefix : l.prefix;
+    n.suffix = (r.suffix == hi - mid) ? r.suffix + l.suffix : r.suffix;
+    n.longest = std::max(std::max(l.longest, r.longest), l.suffix + r.prefix);
+    n.used = l.used + r.used;
+}
+
+void CoreAllocator::update(unsigned int node, unsigned int lo, unsigned int hi,
+    unsigned int pos, unsigned int end, bool used) {
+
+    if(end <= lo || hi <= pos) {
+        return;
+    }
+    if(pos <= lo && hi <= end) {
+        assert(tree_[node].used == (used ? 0 : hi - lo) && "Attempt to free unallocated registers!");
+        fill(node, hi - lo, used);
+        return;
+    }
+    pushDown(node, lo, hi);
+    unsigned int mid = (lo + hi)/2;
+    update(2*node, lo, mid, pos, end, used);
+    update(2*node + 1, mid, hi, pos, end, used);
+    pullUp(node, lo, hi);
+}
+
+unsigned int CoreAllocator::findFirstFit(unsigned int node, unsigned int lo, unsigned int hi,
+    unsigned int size) {
+
+    // The caller guarantees that the range contains a free run of the size
+    if(hi - lo == 1) {
+        return lo;
+    }
+    pushDown(node, lo, hi);
+    unsigned int mid = (lo + hi)/2;
+    const Node& l = tree_[2*node];
+    const Node& r = tree_[2*node + 1];
+    if(l.longest >= size) {
+        return findFirstFit(2*node, lo, mid, size);
+    } else if(l.suffix + r.prefix >= size) {
+        return mid - l.suffix;
+    } else {
+        return findFirstFit(2*node + 1, mid, hi, size);
+    }
+}
+
+unsigned int CoreAllocator::allocate(unsigned int size) {
+    if(tree_[1].longest < size) {
+        return OUT_OF_REGISTERS;
+    }
+    unsigned int pos = findFirstFit(1, 0, size_, size);
+    update(1, 0, size_, pos, pos + size, true);
+    return startAddress_ + pos;
+}
+
+void CoreAllocator::free(unsigned int reg, unsigned int size) {
+    unsigned int pos = reg - startAddress_;
+    update(1, 0, size_, pos, pos + size, false);
+}
+
+StoreOperation* SpillTracker::getSpillOperation(ProducerOperation* producer) {
+    assert(isSpilled(producer));
+    return producer2spill[producer];
+}
+
+LoadOperation* SpillTracker::getLiveNowReload(ProducerOperation* producer) {
+    assert(hasLiveNowReload(producer));
+    return producer2reload[producer];
+}
+
+ProducerOperation* SpillTracker::getOriginalProducer(LoadOperation* load) {
+    assert(isLiveNowReload(load));
+    return reload2producer[load];
+}
+
+void SpillTracker::setSpillOperation
+    (ProducerOperation* producer, StoreOperation* store) {
+
+    assert(!producer2spill.count(producer) && "Register allocation error: spilling a register that has already been spilled!");
+    producer2spill[producer] = store;
+}
+
+void SpillTracker::setLiveNowReload
+    (ProducerOperation* producer, LoadOperation* load) {
+
+    assert(!hasLiveNowReload(producer) && "Register allocation error: reloading a spilled register that has already been reloaded!");
+    producer2reload[producer] = load;
+    reload2producer[load] = producer;
+}
+
+void SpillTracker::killLiveNowReload(LoadOperation* load) {
+    // check if a load to producer exist
+    assert(isLiveNowReload(load));
+    ProducerOperation* producer = reload2producer[load];
+    producer2reload.erase(producer);
+    reload2producer.erase(load);
+}
+
+void SpillTracker::setRematerialized(ProducerOperation* producer) {
+    assert(!isSpilled(producer) && !isRematerialized(producer) && "Register allocation error: spilling a register that has already been spilled!");
+    rematerialized.insert(producer);
+}
+
+void SpillTracker::setLiveNowRematerialization(ProducerOperation* rematerialization) {
+    liveNowRematerializations.insert(rematerialization);
+}
+
+void SpillTracker::killLiveNowRematerialization(ProducerOperation* rematerialization) {
+    assert(isLiveNowRematerialization(rematerialization));
+    liveNowRematerializations.erase(rematerialization);
+}
+
@@ -0,0 +1,105 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "common.h"
+
+// First-fit allocator for the general-purpose register file of a core. A
+// segment tree over the register file tracks, for every range, the longest
+// free run and the free runs touching its ends, so that the leftmost run
+// that fits is found in O(log n) and ranges are (de)allocated lazily.
+class CoreAllocator {
+
+    private:
+
+        struct Node {
+            unsigned int prefix;    /* Free registers at the start of the range */
+            unsigned int suffix;    /* Free registers at the end of the range */
+            unsigned int longest;   /* Longest free run in the range */
+            unsigned int used;      /* Allocated registers in the range */
+            int pending;            /* Lazy assignment: -1 none, 0 free, 1 used */
+        };
+
+        unsigned int startAddress_;
+        unsigned int size_;
+        std::vector<Node> tree_;
+
+        void fill(unsigned int node, unsigned int length, bool used);
+        void pushDown(unsigned int node, unsigned int lo, unsigned int hi);
+        void pullUp(unsigned int node, unsigned int lo, unsigned int hi);
+        void update(unsigned int node, unsigned int lo, unsigned int hi,
+            unsigned int pos, unsigned int end, bool used);
+        unsigned int findFirstFit(unsigned int node, unsigned int lo, unsigned int hi,
+            unsigned int size);
+
+    public:
+
+        static const unsigned int OUT_OF_REGISTERS = (unsigned int) -1;
+
+        CoreAllocator(unsigned int startAddress, unsigned int size);
+
+        unsigned int allocate(unsigned int size);
+        void free(unsigned int pos, unsigned int size);
+
+};
+
+class SpillTracker {
+
+    private:
+
+        std::map<ProducerOperation*, StoreOperation*> producer2spill;
+        std::map<ProducerOperation*, LoadOperation*> producer2reload;
+        std::map<LoadOperation*, ProducerOperation*> reload2producer;
+
+        // Values recreated where they are used instead of spilled
+        std::set<ProducerOperation*> rematerialized;
+        std::set<ProducerOperation*> liveNowRematerializations;
+
+    public:
+
+        bool isSpilled(ProducerOperation* producer)
+            { return producer2spill.count(producer); }
+        bool hasLiveNowReload(ProducerOperation* producer)
+            { return producer2reload.count(producer); }
+        bool isLiveNowReload(LoadOperation* load)
+            { return reload2producer.count(load); }
+        bool isRematerialized(ProducerOperation* producer)
+            { return rematerialized.count(producer); }
+        bool isLiveNowRematerialization(ProducerOperation* producer)
+            { return liveNowRematerializations.count(producer); }
+
+        StoreOperation* getSpillOperation
+            (ProducerOperation* producer);
+        LoadOperation* getLiveNowReload
+            (ProducerOperation* producer);
+        ProducerOperation* getOriginalProducer
+            (LoadOperation* load);
+
+        void setSpillOperation
+            (ProducerOperation* producer, StoreOperation* store);
+        void setLiveNowReload
+            (ProducerOperation* producer, LoadOperation* load);
+        void killLiveNowReload
+            (LoadOperation* load);
+        void setRematerialized
+            (ProducerOperation* producer);
+        void setLiveNowRematerialization
+            (ProducerOperation* rematerialization);
+        void killLiveNowRematerialization
+            (ProducerOperation* rematerialization);
+
+        std::map<ProducerOperation*, LoadOperation*>::iterator
+            reloads_begin() { return producer2reload.begin(); }
+        std::map<ProducerOperation*, LoadOperation*>::iterator
+            reloads_end() { return producer2reload.end(); }
+
+};
+
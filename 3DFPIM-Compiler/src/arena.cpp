@@ -0,0 +1,55 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <assert.h>
+#include <omp.h>
+
+#include "arena.h"
+
+// Enough for any of the objects placed in the arena
+static const size_t ARENA_ALIGNMENT = 16;
+
+Arena::Arena() : offset_(SLAB_SIZE), reserved_(0) {
+}
+
+Arena::~Arena() {
+    for(char* slab : slabs_) {
+        delete [] slab;
+    }
+}
+
+void* Arena::bump(size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if(size > SLAB_SIZE/4) {
+        // Large requests get a slab of their own, kept behind the current one
+        char* slab = new char[size];
+        slabs_.insert(slabs_.empty() ? slabs_.end() : slabs_.end() - 1, slab);
+        reserved_ += size;
+        return slab;
+    }
+    if(offset_ + size > SLAB_SIZE) {
+        slabs_.push_back(new char[SLAB_SIZE]);
+        reserved_ += SLAB_SIZE;
+        offset_ = 0;
+    }
+    void* ptr = slabs_.back() + offset_;
+    offset_ += size;
+    return ptr;
+}
+
+void* Arena::allocate(size_t size) {
+    // Passes that build operations from parallel regions share the arena
+    if(omp_in_parallel()) {
+        void* ptr;
+        #pragma omp critical (arena)
+        ptr = bump(size);
+        return ptr;
+    }
+    return bump(size);
+}
+
@@ -0,0 +1,47 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <stddef.h>
+#include <vector>
+
+#include "common.h"
+
+// Bump allocator for objects that live as long as their model (operations,
+// tensor tiles, sliding sets). Objects are carved out of large slabs and are
+// destroyed in place; the slabs themselves are only released in bulk when
+// the arena is destroyed.
+class Arena {
+
+    private:
+
+        std::vector<char*> slabs_;
+        size_t offset_;             /* Bytes used in the current slab */
+        size_t reserved_;           /* Bytes held by all slabs */
+
+        void* bump(size_t size);
+
+    public:
+
+        static const size_t SLAB_SIZE = 1 << 20;
+
+        Arena();
+        ~Arena();
+
+        void* allocate(size_t size);
+        template <class T>
+        T* allocateArray(size_t n) { return static_cast<T*>(allocate(n*sizeof(T))); }
+
+        size_t reserved() { return reserved_; }
+
+};
+
+// Placement form used as `new (model->getArena()) T(...)`. The matching
+// delete is only called by the compiler if the constructor throws.
+inline void* operator new(size_t size, Arena& arena) { return arena.allocate(size); }
+inline void operator delete(void* ptr, Arena& arena) { }
+
@@ -0,0 +1,380 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "3dfpim.h"
+
+#include "binary.h"
+
+static const char* aluOpName[] = {
+    "add", "sub", "mul", "div",
+    "mul",
+    "and", "or", "not",
+    "eq", "neq", "lt", "leq", "gt", "geq",
+    "min", "max",
+    "mse",
+    "sig", "tanh", "exp", "log", "relu", "relud", "log_softmax", "log_softmaxd", "rndcmp",
+    "resize",
+    "concat",
+    "noact"
+};
+
+Instruction::Instruction(Opcode op) : opcode(op), flags(0), aluOp(0) {
+    memset(raw, 0, sizeof(raw));
+}
+
+uint32_t CodeStream::addString(std::string str) {
+    strings_.push_back(str);
+    return strings_.size() - 1;
+}
+
+uint32_t CodeStream::addDestination(uint32_t tile, uint32_t core) {
+    Destination dst;
+    dst.tile = tile;
+    dst.core = core;
+    destinations_.push_back(dst);
+    return destinations_.size() - 1;
+}
+
+void CodeStream::disassemble(std::ostream& out, unsigned int nMVMUsPerCore) {
+    for(const Instruction& instruction : instructions_) {
+        const char* name = NULL;
+        if(instruction.opcode == Instruction::MVM) {
+            name = strings_[instruction.mvm.name].c_str();
+        }
+        ::disassemble(instruction, name, destinations_.data(), nMVMUsPerCore, out);
+    }
+}
+
+BinaryWriter::BinaryWriter(std::string fileName, std::string modelName,
+    unsigned int nTiles, unsigned int nCoresPerTile, unsigned int nMVMUsPerCore) {
+
+    out_.open(fileName, std::ios::binary);
+    assert(out_.good() && "Cannot open binary output file");
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.magic, BINARY_MAGIC, sizeof(header_.magic));
+    header_.version = BINARY_VERSION;
+    header_.nTiles = nTiles;
+    header_.nCoresPerTile = nCoresPerTile;
+    header_.nMVMUsPerCore = nMVMUsPerCore;
+    header_.name = addString(modelName);
+    chips_.assign(nTiles, 0);
+
+    // Instructions start right after the header; it is rewritten on close
+    out_.write((const char*) &header_, sizeof(header_));
+}
+
+uint32_t BinaryWriter::addString(std::string str) {
+    uint32_t offset = strings_.size();
+    strings_.append(str);
+    strings_.push_back('\0');
+    return offset;
+}
+
+// Rebases the stream-local string and destination indices of an instruction
+void BinaryWriter::append(Instruction instruction, const char* name, const Destination* destinations) {
+    if(instruction.opcode == Instruction::MVM) {
+        instruction.mvm.name = addString(name);
+    } else if(instruction.opcode == Instruction::STORE) {
+        destinations_.insert(destinations_.end(),
+            destinations + instruction.store.dst,
+            destinations + instruction.store.dst + instruction.store.nDsts);
+        instruction.store.dst = destinations_.size() - instruction.store.nDsts;
+    }
+    out_.write((const char*) &instruction, sizeof(instruction));
+}
+
+void BinaryWriter::append(CodeStream& code) {
+    BinaryStreamEntry entry;
+    entry.offset = out_.tellp();
+    entry.count = code.size();
+    index_.push_back(entry);
+    for(unsigned int i = 0; i < code.size(); ++i) {
+        const Instruction& instruction = code.getInstruction(i);
+        const char* name = NULL;
+        if(instruction.opcode == Instruction::MVM) {
+            name = code.getString(instruction.mvm.name).c_str();
+        }
+        append(instruction, name, code.getDestinations());
+    }
+}
+
+void BinaryWriter::append(BinaryReader& reader, unsigned int stream) {
+    BinaryStreamEntry entry;
+    entry.offset = out_.tellp();
+    entry.count = reader.getStreamSize(stream);
+    index_.push_back(entry);
+    const Instruction* instructions = reader.getStream(stream);
+    for(unsigned int i = 0; i < reader.getStreamSize(stream); ++i) {
+        const char* name = NULL;
+        if(instructions[i].opcode == Instruction::MVM) {
+            name = reader.getString(instructions[i].mvm.name);
+        }
+        append(instructions[i], name, reader.getDestinations());
+    }
+}
+
+void BinaryWriter::close() {
+    assert(index_.size() == header_.nTiles*(header_.nCoresPerTile + 1));
+    header_.indexOffset = out_.tellp();
+    out_.write((const char*) index_.data(), index_.size()*sizeof(BinaryStreamEntry));
+    header_.stringsOffset = out_.tellp();
+    header_.stringsSize = strings_.size();
+    out_.write(strings_.data(), strings_.size());
+    header_.destinationsOffset = out_.tellp();
+    header_.nDestinations = destinations_.size();
+    out_.write((const char*) destinations_.data(), destinations_.size()*sizeof(Destination));
+    header_.chipsOffset = out_.tellp();
+    out_.write((const char*) chips_.data(), chips_.size()*sizeof(uint32_t));
+    out_.seekp(0);
+    out_.write((const char*) &header_, sizeof(header_));
+    out_.close();
+}
+
+BinaryReader::BinaryReader(std::string fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    assert(fd >= 0 && "Cannot open binary file");
+    struct stat st;
+    fstat(fd, &st);
+    size_ = st.st_size;
+    assert(size_ >= sizeof(BinaryHeader) && "Truncated binary file");
+    data_ = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    assert(data_ != MAP_FAILED && "Cannot map binary file");
+    ::close(fd);
+    header_ = (const BinaryHeader*) data_;
+    assert(memcmp(header_->magic, BINARY_MAGIC, sizeof(header_->magic)) == 0 && "Not a 3D-FPIM binary file");
+    assert(header_->version == BINARY_VERSION && "Unsupported binary version");
+    index_ = (const BinaryStreamEntry*) ((const char*) data_ + header_->indexOffset);
+}
+
+BinaryReader::~BinaryReader() {
+    munmap(data_, size_);
+}
+
+const Instruction* BinaryReader::getStream(unsigned int stream) {
+    assert(stream < getNStreams());
+    return (const Instruction*) ((const char*) data_ + index_[stream].offset);
+}
+
+const char* BinaryReader::getString(uint32_t offset) {
+    assert(offset < header_->stringsSize);
+    return (const char*) data_ + header_->stringsOffset + offset;
+}
+
+const Destination* BinaryReader::getDestinations() {
+    return (const Destination*) ((const char*) data_ + header_->destinationsOffset);
+}
+
+unsigned int BinaryReader::getChip(unsigned int tile) {
+    assert(tile < header_->nTiles);
+    return ((const uint32_t*) ((const char*) data_ + header_->chipsOffset))[tile];
+}
+
+unsigned int BinaryReader::getNChips() {
+    unsigned int nChips = 1;
+    for(unsigned int tile = 0; tile < header_->nTiles; ++tile) {
+        nChips = std::max(nChips, getChip(tile) + 1);
+    }
+    return nChips;
+}
+
+void BinaryReader::disassemble(unsigned int stream, std::ostream& out) {
+    const Instruction* instructions = getStream(stream);
+    for(unsigned int i = 0; i < getStreamSize(stream); ++i) {
+        const char* name = NULL;
+        if(instructions[i].opcode == Instruction::MVM) {
+            name = getString(instructions[i].mvm.name);
+        }
+        ::disassemble(instructions[i], name, getDestinations(), getNMVMUsPerCore(), out);
+    }
+}
+
+void disassemble(const Instruction& instruction, const char* name,
+    const Destination* destinations, unsigned int nMVMUsPerCore, std::ostream& out) {
+
+    switch(instruction.opcode) {
+        case Instruction::MVM:
+            if(instruction.flags & Instruction::COALESCED) {
+                out << "mvm(['";
+                for(unsigned int i = 0; i < nMVMUsPerCore; ++i) {
+                    out << ((instruction.mvm.mask >> i) & 1);
+                }
+                out << "'], depth = " << instruction.mvm.depth
+                    << ", precision = " << instruction.mvm.precision
+                    << ", stacks = " << instruction.mvm.stacks
+                    << ", name = '" << name << "'";
+            } else {
+                out << "mvm(xb_nma = ['";
+                for(unsigned int i = 0; i < nMVMUsPerCore; ++i) {
+                    out << ((instruction.mvm.mask >> i) & 1);
+                }
+                out << "']"
+                    << ", name = '" << name << "'"
+                    << ", precision = " << instruction.mvm.precision
+                    << ", depth = " << instruction.mvm.depth
+                    << ", stacks = " << instruction.mvm.stacks
+                    << ", slideId = " << instruction.mvm.slideId;
+            }
+            if(instruction.flags & Instruction::LAST) {
+                out << ", isLast = True)\n";
+            } else {
+                out << ", isLast = False)\n";
+            }
+            break;
+        case Instruction::ALU:
+            out << "alu";
+            if(instruction.flags & Instruction::IMMEDIATE) {
+                out << "i";
+            }
+            out << "('" << aluOpName[instruction.aluOp] << "', "
+                << "d1=" << instruction.alu.d1 << ", "
+                << "r1=" << instruction.alu.r1 << ", ";
+            if(instruction.flags & Instruction::BINARY) {
+                out << "r2=" << instruction.alu.r2 << ", ";
+            }
+            if(instruction.flags & Instruction::IMMEDIATE) {
+                out << "imm=" << instruction.alu.imm << ", ";
+            }
+            out << "intermediate=False, "
+                << "vec=" << instruction.alu.vec << ")\n";
+            break;
+        case Instruction::SET:
+            out << "set("
+                << "d1=" << instruction.set.d1 << ", "
+                << "imm=" << instruction.set.imm << ", "
+                << "vec=" << instruction.set.vec << ", "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::COPY:
+            out << "copy("
+                << "d1=" << instruction.copy.d1 << ", "
+                << "r1=" << instruction.copy.r1 << ", "
+                << "vec=" << instruction.copy.vec << ", "
+                << "src_type=" << 1 << ", "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::LOAD:
+            out << "load("
+                << "d1=" << instruction.load.d1 << ", "
+                << "r1=" << instruction.load.r1 << ", "
+                << "load_width=" << instruction.load.width << ", "
+                << "vec=" << instruction.load.vec << ", "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::STORE:
+            out << "store(d1=" << instruction.store.d1 << ", "
+                << "r1=" << instruction.store.r1 << ", "
+                << "counter=" << instruction.store.counter << ", "
+                << "store_width=" << instruction.store.width << ", "
+                << "vec=" << instruction.store.vec << ", "
+                << "dst=[";
+            for(unsigned int i = 0; i < instruction.store.nDsts; ++i) {
+                const Destination& dst = destinations[instruction.store.dst + i];
+                if(dst.core == Destination::OUTPUT) {
+                    out << "(1, 0), ";
+                } else {
+                    out << "(" << dst.tile << "," << dst.core << "), ";
+                }
+            }
+            out << "], "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::GUARD:
+            out << "guard("
+                << "r1=" << instruction.guard.r1 << ", "
+                << "guard_width=" << instruction.guard.width << ", "
+                << "vec=" << instruction.guard.vec << ", "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::SEND:
+            out << "send("
+                << "mem_addr=" << instruction.send.memAddr << ", "
+                << "vtile_id=" << instruction.send.vtile << ", "
+                << "send_width=" << instruction.send.width << ", "
+                << "target_addr=" << instruction.send.target << ", "
+                << "vec=" << instruction.send.vec << ", "
+                << "op_id=" << instruction.send.opId << ", "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::RECEIVE:
+            out << "receive(mem_addr=" << instruction.recv.memAddr << ", "
+                << "vtile_id=" << instruction.recv.vtile << ", "
+                << "receive_width=" << instruction.recv.width << ", "
+                << "counter=" << instruction.recv.counter << ", "
+                << "vec=" << instruction.recv.vec << ", "
+                << "op_id=" << instruction.recv.opId << ", "
+                << "intermediate=False)\n";
+            break;
+        case Instruction::HALT:
+            out << "halt()" << std::endl;
+            break;
+        case Instruction::HLT:
+            out << "hlt()" << std::endl;
+            break;
+        default:
+            assert(0 && "Unsupported instruction for disassembly!");
+    }
+}
+
+void disassemble(std::string fileName, std::string modelName) {
+    BinaryReader reader(fileName);
+    if(modelName.empty()) {
+        modelName = reader.getName();
+    }
+    unsigned int nChips = reader.getNChips();
+    makeChipDirectories(modelName, nChips);
+    for(unsigned int pTile = 0; pTile < reader.getNTiles(); ++pTile) {
+        unsigned int chip = reader.getChip(pTile);
+        unsigned int stream = pTile*(reader.getNCoresPerTile() + 1);
+        std::ofstream tileCode(getProgramFileName(modelName, nChips, chip, pTile));
+        reader.disassemble(stream, tileCode);
+        tileCode.close();
+        for(unsigned int pCore = 0; pCore < reader.getNCoresPerTile(); ++pCore) {
+            std::ofstream coreCode(getProgramFileName(modelName, nChips, chip, pTile, pCore));
+            reader.disassemble(stream + 1 + pCore, coreCode);
+            coreCode.close();
+        }
+    }
+}
+
+std::string getProgramFileName(std::string modelName, unsigned int nChips,
+    unsigned int chip, unsigned int pTile, int pCore) {
+    std::stringstream fileName;
+    if(nChips > 1) {
+        fileName << modelName << "-chip" << chip << "/";
+    }
+    fileName << modelName << "-tile" << pTile;
+    if(pCore >= 0) {
+        fileName << "-core" << pCore;
+    }
+    fileName << ".3dfpim";
+    return fileName.str();
+}
+
+void makeChipDirectories(std::string modelName, unsigned int nChips) {
+    for(unsigned int chip = 0; nChips > 1 && chip < nChips; ++chip) {
+        std::stringstream directory;
+        directory << modelName << "-chip" << chip;
+        if(mkdir(directory.str().c_str(), 0755) != 0 && errno != EEXIST) {
+            std::cerr << "Cannot create directory " << directory.str()
+                << ": " << strerror(errno) << std::endl;
+            assert(0 && "Cannot create chip directory");
+        }
+    }
+}
+
@@ -0,0 +1,182 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+#define BINARY_MAGIC                    "3DFPIMBC"
+#define BINARY_VERSION                  3
+
+// A fixed-size (32-byte) encoding of a single 3D-FPIM instruction
+struct Instruction {
+
+    enum Opcode {
+        MVM, ALU, SET, COPY, LOAD, STORE, GUARD, SEND, RECEIVE,
+        HALT,   /* End of a tile program */
+        HLT     /* End of a core program */
+    };
+
+    enum Flags {
+        LAST        = 0x1,  /* MVM: last stack of a merged set */
+        COALESCED   = 0x2,  /* MVM: issued on behalf of a coalesced set */
+        IMMEDIATE   = 0x4,  /* ALU: operates on an immediate (alui) */
+        BINARY      = 0x8   /* ALU: has a second register operand */
+    };
+
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t aluOp;
+    union {
+        struct { uint32_t mask, name, precision, depth, stacks, slideId; } mvm;
+        struct { uint32_t d1, r1, r2; float imm; uint32_t vec; } alu;
+        struct { uint32_t d1, imm, vec; } set;
+        struct { uint32_t d1, r1, vec; } copy;
+        struct { uint32_t d1, r1, width, vec; } load;
+        struct { uint32_t d1, r1, counter, width, vec, dst, nDsts; } store;
+        struct { uint32_t r1, width, vec; } guard;
+        struct { uint32_t memAddr, vtile, width, target, vec, opId; } send;
+        struct { uint32_t memAddr, vtile, width, counter, vec, opId; } recv;
+        uint32_t raw[7];
+    };
+
+    Instruction(Opcode op);
+
+};
+
+// A consumer of a store; outputs are read by the host through tile 1
+struct Destination {
+
+    static const uint32_t OUTPUT = 0xffffffff;
+
+    uint32_t tile;
+    uint32_t core;
+
+};
+
+// The instructions of one tile or core program along with the strings and
+// store destinations they refer to. Indices are local to the stream.
+class CodeStream {
+
+    private:
+
+        std::vector<Instruction> instructions_;
+        std::vector<std::string> strings_;
+        std::vector<Destination> destinations_;
+
+    public:
+
+        void append(const Instruction& instruction) { instructions_.push_back(instruction); }
+        uint32_t addString(std::string str);
+        uint32_t addDestination(uint32_t tile, uint32_t core);
+
+        unsigned int size() { return instructions_.size(); }
+        const Instruction& getInstruction(unsigned int i) { return instructions_[i]; }
+        const std::string& getString(uint32_t i) { return strings_[i]; }
+        const Destination* getDestinations() { return destinations_.data(); }
+
+        void disassemble(std::ostream& out, unsigned int nMVMUsPerCore);
+
+};
+
+// On-disk layout: header, instructions of all streams, stream index,
+// string table, destination table and the chip of each tile. Stream 0 is
+// the program of tile 0, followed by its cores, then tile 1 and so on.
+struct BinaryHeader {
+
+    char magic[8];
+    uint32_t version;
+    uint32_t nTiles;
+    uint32_t nCoresPerTile;
+    uint32_t nMVMUsPerCore;
+    uint32_t name;
+    uint64_t indexOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t destinationsOffset;
+    uint64_t nDestinations;
+    uint64_t chipsOffset;
+
+};
+
+struct BinaryStreamEntry {
+
+    uint64_t offset;
+    uint64_t count;
+
+};
+
+class BinaryWriter {
+
+    private:
+
+        std::ofstream out_;
+        BinaryHeader header_;
+        std::vector<BinaryStreamEntry> index_;
+        std::string strings_;
+        std::vector<Destination> destinations_;
+        std::vector<uint32_t> chips_;
+
+        uint32_t addString(std::string str);
+        void append(Instruction instruction, const char* name, const Destination* destinations);
+
+    public:
+
+        BinaryWriter(std::string fileName, std::string modelName,
+            unsigned int nTiles, unsigned int nCoresPerTile, unsigned int nMVMUsPerCore);
+
+        void append(CodeStream& code);
+        void append(BinaryReader& reader, unsigned int stream);    /* Copies a stream of another container */
+        void setChip(unsigned int tile, unsigned int chip) { chips_[tile] = chip; }
+        void close();
+
+};
+
+// Read-only view of a binary container mapped into memory
+class BinaryReader {
+
+    private:
+
+        void* data_;
+        size_t size_;
+        const BinaryHeader* header_;
+        const BinaryStreamEntry* index_;
+
+    public:
+
+        BinaryReader(std::string fileName);
+        ~BinaryReader();
+
+        std::string getName() { return getString(header_->name); }
+        unsigned int getNTiles() { return header_->nTiles; }
+        unsigned int getNCoresPerTile() { return header_->nCoresPerTile; }
+        unsigned int getNMVMUsPerCore() { return header_->nMVMUsPerCore; }
+        unsigned int getNStreams() { return header_->nTiles*(header_->nCoresPerTile + 1); }
+        unsigned int getChip(unsigned int tile);
+        unsigned int getNChips();
+        const Instruction* getStream(unsigned int stream);
+        unsigned int getStreamSize(unsigned int stream) { return index_[stream].count; }
+        const char* getString(uint32_t offset);
+        const Destination* getDestinations();
+
+        void disassemble(unsigned int stream, std::ostream& out);
+
+};
+
+void disassemble(const Instruction& instruction, const char* name,
+    const Destination* destinations, unsigned int nMVMUsPerCore, std::ostream& out);
+
+// Text programs are named after their tile and core, and go into a
+// <model>-chip<c> directory per chip when the model spans several chips
+std::string getProgramFileName(std::string modelName, unsigned int nChips,
+    unsigned int chip, unsigned int pTile, int pCore = -1);
+void makeChipDirectories(std::string modelName, unsigned int nChips);
+
@@ -0,0 +1,214 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "3dfpim.h"
+
+#include "binary.h"
+#include "cache.h"
+#include "model.h"
+#include "operations.h"
+#include "tensors.h"
+
+// Bumped whenever a change to the compiler alters its output for the same key
+static const unsigned int CACHE_VERSION = 7;
+
+// 64-bit FNV-1a
+static void hash(uint64_t& key, uint64_t value) {
+    for(unsigned int byte = 0; byte < sizeof(value); ++byte) {
+        key ^= (value >> (8*byte)) & 0xff;
+        key *= 1099511628211ull;
+    }
+}
+
+static void hash(uint64_t& key, std::string str) {
+    hash(key, str.size());
+    for(char c : str) {
+        key ^= (unsigned char) c;
+        key *= 1099511628211ull;
+    }
+}
+
+static void makeDirectory(std::string directory) {
+    if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create cache directory " << directory
+            << ": " << strerror(errno) << std::endl;
+        assert(0 && "Cannot create cache directory");
+    }
+}
+
+CompilationCache::CompilationCache(ModelImpl* model, CompilerOptions& options)
+    : model_(model), options_(options) {
+}
+
+bool CompilationCache::isEnabled() {
+    // Debug graphs are printed between passes, so they need a full compilation
+    return !options_.cacheDirectory_.empty() && !options_.printDebugInfo_;
+}
+
+uint64_t CompilationCache::computeKey() {
+
+    uint64_t key = 14695981039346656037ull;
+    hash(key, CACHE_VERSION);
+    hash(key, BINARY_VERSION);
+
+    // Compiler options; the code format only changes how the cached code is restored
+    hash(key, options_.gp_);
+    hash(key, options_.coalesceMVMOperations_);
+
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    hash(key, hardware.mvmuDim_);
+    hash(key, hardware.mvmuDpt_);
+    hash(key, hardware.nConstantMVMUsPerCore_);
+    hash(key, hardware.nCoresPerTile_);
+    hash(key, hardware.maxLoadStoreWidth_);
+    hash(key, hardware.maxSendRecvWidth_);
+    hash(key, hardware.registerFileSize_);
+    hash(key, hardware.tileMemorySize_);
+    hash(key, hardware.meshWidth_);
+    hash(key, hardware.meshHeight_);
+    hash(key, hardware.nChips_);
+
+    for(auto it = model_->layer_begin(); it != model_->layer_end(); ++it) {
+        Layer* layer = *it;
+        hash(key, layer->kernelWidth_);
+        hash(key, layer->kernelHeight_);
+        hash(key, layer->inImageWidth_);
+        hash(key, layer->inImageHeight_);
+        hash(key, layer->nInChannels_);
+        hash(key, layer->outImageWidth_);
+        hash(key, layer->outImageHeight_);
+        hash(key, layer->nOutChannels_);
+        hash(key, layer->isFC_);
+        hash(key, layer->duplicateWidth_);
+        hash(key, layer->duplicateHeight_);
+    }
+
+    // Operations are created in a deterministic order, so ids identify operands
+    for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
+        Operation* op = *it;
+        hash(key, op->getKind());
+        hash(key, op->length());
+        hash(key, op->id);
+        if(ConsumerOperation* consumer = op->asConsumer()) {
+            hash(key, consumer->numOperands());
+            for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
+                hash(key, consumer->getOperand(o)->id);
+            }
+        }
+        switch(op->getKind()) {
+            case Operation::MVM: {
+                MVMOperation* mvm = opcast<MVMOperation>(op);
+                hash(key, mvm->printOperationType());
+                hash(key, mvm->isMVMLast());
+                hash(key, mvm->getDepth());
+                hash(key, mvm->getNStack());
+                hash(key, mvm->getPrecision());
+                hash(key, mvm->getSlideId());
+                break;
+            }
+            case Operation::MERGED_MVM: {
+                // Members are kept in address order
+                MergedMVMSet* mergedMVM = opcast<MergedMVMSet>(op);
+                std::vector<int> mvms;
+                for(MVMOperation* mvm : *mergedMVM) {
+                    mvms.push_back(mvm->id);
+                }
+                std::sort(mvms.begin(), mvms.end());
+                for(int mvm : mvms) {
+                    hash(key, mvm);
+                }
+                break;
+            }
+            case Operation::ALU_VECTOR: {
+                ALUVectorOperation* alu = opcast<ALUVectorOperation>(op);
+                float imm = alu->getImmediate();
+                uint32_t immBits;
+                memcpy(&immBits, &imm, sizeof(immBits));
+                hash(key, alu->getOpCode());
+                hash(key, immBits);
+                break;
+            }
+            case Operation::SET_IMMEDIATE:
+                hash(key, opcast<SetImmediateOperation>(op)->getImmediate());
+                break;
+            case Operation::PSEUDO_INPUT:
+                hash(key, opcast<PseudoInputOperation>(op)->getSrc()->name());
+                break;
+            case Operation::PSEUDO_OUTPUT:
+                hash(key, opcast<PseudoOutputOperation>(op)->getDst()->name());
+                break;
+            default:
+                break;
+        }
+    }
+
+    return key;
+}
+
+bool CompilationCache::lookup() {
+    std::stringstream entryDirectory;
+    entryDirectory << options_.cacheDirectory_ << "/"
+        << std::hex << std::setw(16) << std::setfill('0') << computeKey();
+    entryDirectory_ = entryDirectory.str();
+
+    bool hit = (access(getReportFileName().c_str(), R_OK) == 0)
+        && (!options_.simulate_ || access(getProgramsFileName().c_str(), R_OK) == 0);
+    if(!hit) {
+        makeDirectory(options_.cacheDirectory_);
+        makeDirectory(entryDirectory_);
+    }
+    return hit;
+}
+
+void CompilationCache::restoreCode() {
+    std::string name = model_->getName();
+    if(options_.codeFormat_ == CompilerOptions::CF_BINARY) {
+        // The container records the name of the model it was compiled for
+        BinaryReader reader(getContainerFileName());
+        BinaryWriter writer(name + ".3dfpimbin", name, reader.getNTiles(),
+            reader.getNCoresPerTile(), reader.getNMVMUsPerCore());
+        for(unsigned int tile = 0; tile < reader.getNTiles(); ++tile) {
+            writer.setChip(tile, reader.getChip(tile));
+        }
+        for(unsigned int stream = 0; stream < reader.getNStreams(); ++stream) {
+            writer.append(reader, stream);
+        }
+        writer.close();
+    } else {
+        disassemble(getContainerFileName(), name);
+    }
+}
+
+std::string CompilationCache::loadReport() {
+    std::ifstream file(getReportFileName());
+    std::stringstream report;
+    report << file.rdbuf();
+    return report.str();
+}
+
+void CompilationCache::storeReport(std::string report) {
+    std::string tempFileName = getReportFileName() + ".tmp";
+    std::ofstream file(tempFileName);
+    file << report;
+    file.close();
+    rename(tempFileName.c_str(), getReportFileName().c_str());
+}
+
@@ -0,0 +1,46 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <stdint.h>
+#include <string>
+
+#include "common.h"
+
+// On-disk cache of compiled models. The key hashes the operation graph, the
+// compiler options and the hardware parameters read by the compiler passes;
+// latencies are only read by the simulator, so models that differ in them
+// share an entry. An entry holds the code as a binary container, the
+// simulator programs and the compile-time part of the report, which is
+// written last and marks the entry as complete.
+class CompilationCache {
+
+    private:
+
+        ModelImpl* model_;
+        CompilerOptions& options_;
+        std::string entryDirectory_;
+
+        uint64_t computeKey();
+
+    public:
+
+        CompilationCache(ModelImpl* model, CompilerOptions& options);
+
+        bool isEnabled();
+        bool lookup();
+
+        std::string getContainerFileName() { return entryDirectory_ + "/code.3dfpimbin"; }
+        std::string getProgramsFileName() { return entryDirectory_ + "/programs.bin"; }
+        std::string getReportFileName() { return entryDirectory_ + "/report.out"; }
+
+        void restoreCode();
+        std::string loadReport();
+        void storeReport(std::string report);
+
+};
+
@@ -19,7 +19,89 @@
 #include "stdio.h"
 #include "string.h"
 
-#include <omp.h>
+#include <algorithm>
+
+bool SparseBitSet::test(unsigned int id) const {
+    auto block = std::lower_bound(blocks_.begin(), blocks_.end(), id/64);
+    if(block == blocks_.end() || *block != id/64) {
+        return false;
+    }
+    return (words_[block - blocks_.begin()] >> (id%64)) & 1;
+}
+
+void SparseBitSet::insert(unsigned int id) {
+    // Ids mostly arrive in increasing order
+    if(blocks_.empty() || blocks_.back() < id/64) {
+        blocks_.push_back(id/64);
+        words_.push_back((uint64_t) 1 << (id%64));
+        return;
+    } else if(blocks_.back() == id/64) {
+        words_.back() |= (uint64_t) 1 << (id%64);
+        return;
+    }
+    auto block = std::lower_bound(blocks_.begin(), blocks_.end(), id/64);
+    unsigned int idx = block - blocks_.begin();
+    if(block == blocks_.end() || *block != id/64) {
+        blocks_.insert(block, id/64);
+        words_.insert(words_.begin() + idx, 0);
+    }
+    words_[idx] |= (uint64_t) 1 << (id%64);
+}
+
+void SparseBitSet::unionWith(const SparseBitSet& other) {
+    // Merge in place when every block of the other set is already present
+    unsigned int i = 0, missing = 0;
+    for(uint32_t block : other.blocks_) {
+        while(i < blocks_.size() && blocks_[i] < block) {
+            ++i;
+        }
+        if(i == blocks_.size() || blocks_[i] != block) {
+            ++missing;
+        }
+    }
+    if(missing == 0) {
+        i = 0;
+        for(unsigned int j = 0; j < other.blocks_.size(); ++j) {
+            while(blocks_[i] < other.blocks_[j]) {
+                ++i;
+            }
+            words_[i] |= other.words_[j];
+        }
+        return;
+    }
+
+    // Otherwise merge the sorted block lists
+    std::vector<uint32_t> blocks;
+    std::vector<uint64_t> words;
+    blocks.reserve(blocks_.size() + missing);
+    words.reserve(blocks_.size() + missing);
+    unsigned int j = 0;
+    i = 0;
+    while(i < blocks_.size() || j < other.blocks_.size()) {
+        if(j == other.blocks_.size() || (i < blocks_.size() && blocks_[i] < other.blocks_[j])) {
+            blocks.push_back(blocks_[i]);
+            words.push_back(words_[i++]);
+        } else if(i == blocks_.size() || other.blocks_[j] < blocks_[i]) {
+            blocks.push_back(other.blocks_[j]);
+            words.push_back(other.words_[j++]);
+        } else {
+            blocks.push_back(blocks_[i]);
+            words.push_back(words_[i++] | other.words_[j++]);
+        }
+    }
+    blocks_.swap(blocks);
+    words_.swap(words);
+}
+
+std::vector<unsigned int> SparseBitSet::elements() const {
+    std::vector<unsigned int> ids;
+    for(unsigned int i = 0; i < blocks_.size(); ++i) {
+        for(uint64_t word = words_[i]; word != 0; word &= word - 1) {
+            ids.push_back(blocks_[i]*64 + __builtin_ctzll(word));
+        }
+    }
+    return ids;
+}
 
 Coalescer::Coalescer
     (ModelImpl* model, Placer* placer, 
@@ -34,7 +116,7 @@ Coalescer::Coalescer
 
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(MergedMVMSet* mergedMVM = dynamic_cast<MergedMVMSet*>(op)){
+        if(MergedMVMSet* mergedMVM = opcast<MergedMVMSet>(op)){
             assert(mergedMVM->getCoalescedSet() != NULL);
         }
     }
@@ -48,8 +130,18 @@ Coalescer::~Coalescer() {
     }
 }
 
+unsigned int Coalescer::getNumCoalescedSets() {
+    unsigned int numCoalescedSets = 0;
+    for(auto& coreCoalescedSets : coalescedMVMSets_) {
+        numCoalescedSets += coreCoalescedSets.size();
+    }
+    return numCoalescedSets;
+}
+
 void Coalescer::coalesceMVMOperations() {
 
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+
     // Strategy
     // 1) coalesce MVM operations for a single larger MVM!
     // 2) traverse in the reverse post order =>
@@ -70,7 +162,7 @@ void Coalescer::coalesceMVMOperations() {
             unsigned int pTile = placer_->getPTile(*(mergedMVM->begin()));
 
             if(!localCoalescedMergedMVMSets[pTile].count(pCore)) {
-                localCoalescedMergedMVMSets[pTile][pCore] = new CoalescedMergedMVMSet();
+                localCoalescedMergedMVMSets[pTile][pCore] = new CoalescedMergedMVMSet(hardware.nConstantMVMUsPerCore_);
             }
             localCoalescedMergedMVMSets[pTile][pCore]->add(mergedMVM, pMVMU);
         }
@@ -85,7 +177,7 @@ void Coalescer::coalesceMVMOperations() {
                 // => use it! (complete coalesce set)
                 if(coalescedSet->isComplete()) {
                     // multiple nmvmus are mapped to a single coalescedMVMSet!
-                    coalescedMVMSets_[pTile*N_CORES_PER_TILE + pCore].
+                    coalescedMVMSets_[pTile*hardware.nCoresPerTile_ + pCore].
                         push_back(coalescedSet);
                 } 
                 // 2) if all the MVMs are not mapped to a single core
@@ -103,7 +195,7 @@ void Coalescer::coalesceMVMOperations() {
     int temp = 0;
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(MergedMVMSet* mergedMVM = dynamic_cast<MergedMVMSet*>(op)){
+        if(MergedMVMSet* mergedMVM = opcast<MergedMVMSet>(op)){
             CoalescedMergedMVMSet* coalescedSet = mergedMVM->getCoalescedSet();
             if(coalescedSet == NULL){
                 mergedMVM->mergedId = mergedCount;
@@ -117,77 +209,45 @@ void Coalescer::coalesceMVMOperations() {
     }
 
     if(mergedCount != 0){
-        unsigned int** mergedMVMSetOfMergedMVMs;
-        bool** preBool;
-        bool** sucBool;
-
-        unsigned int* preCount;
-        unsigned int* sucCount;
-        mergedMVMSetOfMergedMVMs = new unsigned int* [mergedCount];
-        preBool = new bool* [mergedCount];
-        sucBool = new bool* [mergedCount];
-
-        preCount = new unsigned int [mergedCount];
-        sucCount = new unsigned int [mergedCount];
-        for(unsigned int i = 0; i < mergedCount; i++){
-            mergedMVMSetOfMergedMVMs[i] = new unsigned int[mergedCount];
-            preBool[i] = new bool[mergedCount];
-            sucBool[i] = new bool[mergedCount];
-
-            preCount[i] = 0;
-            sucCount[i] = 0;
-            for(unsigned int j = 0; j < mergedCount; j++){
-                mergedMVMSetOfMergedMVMs[i][j] = 0;
-                preBool[i][j] = false;
-                sucBool[i][j] = false;
-            }
-        }
+        // Transitive predecessors and successors of each uncoalesced merged MVM
+        std::vector<SparseBitSet> predecessors(mergedCount);
+        std::vector<SparseBitSet> successors(mergedCount);
 
         // Analyze initial dependences between remaining MVM operations
         std::set<MergedMVMSet*> isMergedVisited;
         for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
             Operation* op = *it;
-            if(dynamic_cast<ReadOutputOperation*>(op)) {
+            if(opcast<ReadOutputOperation>(op)) {
                 std::set<Operation*> nearestVisited;
                 std::set<MergedMVMSet*> nearestMerged = 
                     findNearestMergedMVMPredecessors(op, true, nearestVisited);
                 for(auto it = nearestMerged.begin(); it != nearestMerged.end(); it++){
                     findMergedMVMPredecessors(*it, 
                         isMergedVisited,
-                        mergedMVMSetOfMergedMVMs,
-                        preCount,
-                        sucCount,
-                        preBool,
-                        sucBool);
+                        predecessors);
                 }
             }
         }
 
-        std::set<Operation*> isVisited;
+        // Successors are the transpose of the predecessors; visiting the
+        // merged MVMs in id order only ever appends to each set
+        for(unsigned int mergedId = 0; mergedId < mergedCount; ++mergedId) {
+            for(unsigned int mergedMVMPreId : predecessors[mergedId].elements()) {
+                successors[mergedMVMPreId].insert(mergedId);
+            }
+        }
+
+        OperationSet isVisited(model_->op_count);
         for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
             Operation* op = *it;
             // start from the bottom!!
-            if(dynamic_cast<ReadOutputOperation*>(op)) {
+            if(opcast<ReadOutputOperation>(op)) {
                 coalesceMVMPredecessors
                     (op, isVisited, 
-                    mergedMVMSetOfMergedMVMs,
-                    preCount,
-                    sucCount,
-                    preBool,
-                    sucBool);
+                    predecessors,
+                    successors);
             }
         }
-
-        delete [] preCount;
-        delete [] sucCount;
-        for(unsigned int i = 0; i < mergedCount; i++){
-            delete [] mergedMVMSetOfMergedMVMs[i];
-            delete [] preBool[i];
-            delete [] sucBool[i];
-        }
-        delete [] mergedMVMSetOfMergedMVMs;
-        delete [] preBool;
-        delete [] sucBool;
     }
 }
 
@@ -198,13 +258,13 @@ std::set<MergedMVMSet*> Coalescer::findNearestMergedMVMPredecessors
     std::set<MergedMVMSet*> mergedPred;
     if(!isVisited.count(op)){
         isVisited.insert(op);
-        if(MergedMVMSet* mergedMVM = dynamic_cast<MergedMVMSet*>(op)) {
+        if(MergedMVMSet* mergedMVM = opcast<MergedMVMSet>(op)) {
             if(start || mergedMVM->mergedId == -1) {
                 for(MVMOperation* mvm : *mergedMVM) {
                     for(unsigned int o = 0; o < mvm->numOperands(); ++o) {
                         ProducerOperation* predecessor = mvm->getOperand(o);
                         // if mvm op => insert the mergedMVM
-                        if(!dynamic_cast<MVMOperation*>(predecessor)) {
+                        if(!opcast<MVMOperation>(predecessor)) {
                             std::set<MergedMVMSet*> pred = 
                                 findNearestMergedMVMPredecessors(predecessor, false, isVisited);
                             mergedPred.insert(pred.begin(), pred.end());
@@ -213,11 +273,11 @@ std::set<MergedMVMSet*> Coalescer::findNearestMergedMVMPredecessors
                 }
             }
         }
-        else if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(op)) {
+        else if(ConsumerOperation* consumer = opcast<ConsumerOperation>(op)) {
             for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                 ProducerOperation* predecessor = consumer->getOperand(o);
                 // if mvm op => insert the mergedMVM
-                if(MVMOperation* mvmPred = dynamic_cast<MVMOperation*>(predecessor)) {
+                if(MVMOperation* mvmPred = opcast<MVMOperation>(predecessor)) {
                     MergedMVMSet* mergedM = mvmPred->getMergedSet();
                     if(mergedM->mergedId == -1){
                         std::set<MergedMVMSet*> pred = 
@@ -236,7 +296,7 @@ std::set<MergedMVMSet*> Coalescer::findNearestMergedMVMPredecessors
                 }
             }
         }
-        if(TileMemoryReadOperation* read = dynamic_cast<TileMemoryReadOperation*>(op)) {
+        if(TileMemoryReadOperation* read = opcast<TileMemoryReadOperation>(op)) {
             for(unsigned int i = 0; i < read->numSrcs(); ++i) {
                 TileMemoryWriteOperation* predecessor = read->getSrc(i);
                 std::set<MergedMVMSet*> pred = 
@@ -244,7 +304,7 @@ std::set<MergedMVMSet*> Coalescer::findNearestMergedMVMPredecessors
                 mergedPred.insert(pred.begin(), pred.end());
             }
         }
-        if(ReceiveOperation* recv = dynamic_cast<ReceiveOperation*>(op)) {
+        if(ReceiveOperation* recv = opcast<ReceiveOperation>(op)) {
             SendOperation* predecessor = recv->getSrc();
             std::set<MergedMVMSet*> pred = 
                 findNearestMergedMVMPredecessors(predecessor, false, isVisited);
@@ -255,18 +315,14 @@ std::set<MergedMVMSet*> Coalescer::findNearestMergedMVMPredecessors
     return mergedPred;
 }
 
-std::set<int> Coalescer::findMergedMVMPredecessors
+SparseBitSet Coalescer::findMergedMVMPredecessors
     (MergedMVMSet* mergedMVM,
     std::set<MergedMVMSet*>& isVisited,
-    unsigned int** mergedMVMSetOfMergedMVMs,
-    unsigned int* preCount,
-    unsigned int* sucCount,
-    bool** preBool, 
-    bool** sucBool) {
+    std::vector<SparseBitSet>& predecessors) {
 
     // if the mvm predessors 
     // has not counted the predecessor
-    std::set<int> mergedPred;
+    SparseBitSet mergedPred;
 
     // Visit nodes in reverse postorder 
     // (find MVM predecessors of all predecessors of the operation 
@@ -293,23 +349,12 @@ std::set<int> Coalescer::findMergedMVMPredecessors
                     CoalescedMergedMVMSet* coalSet = (*it)->getCoalescedSet();
 
                     if(isVisited.count(*it)){
-                        int preTemp = preCount[(*it)->mergedId];
-                        for(unsigned int precount = 0; 
-                            precount < preTemp; precount++){
-                            unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                [(*it)->mergedId][precount];
-                            mergedPred.insert(mergedMVMPreId);
-                        }
+                        mergedPred.unionWith(predecessors[(*it)->mergedId]);
                     }
                     else{
-                        std::set<int> pred = findMergedMVMPredecessors(*it, 
+                        mergedPred.unionWith(findMergedMVMPredecessors(*it, 
                             isVisited,
-                            mergedMVMSetOfMergedMVMs,
-                            preCount,
-                            sucCount,
-                            preBool,
-                            sucBool);
-                        mergedPred.insert(pred.begin(), pred.end());
+                            predecessors));
                     }
 
                     if(coalSet == NULL){
@@ -330,23 +375,12 @@ std::set<int> Coalescer::findMergedMVMPredecessors
             for(auto it = nearestMerged.begin(); it != nearestMerged.end(); it++){
 
                 if(isVisited.count(*it)){
-                    int preTemp = preCount[(*it)->mergedId];
-                    for(unsigned int precount = 0; 
-                        precount < preTemp; precount++){
-                        unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                            [(*it)->mergedId][precount];
-                        mergedPred.insert(mergedMVMPreId);
-                    }
+                    mergedPred.unionWith(predecessors[(*it)->mergedId]);
                 }
                 else{
-                    std::set<int> pred = findMergedMVMPredecessors(*it, 
+                    mergedPred.unionWith(findMergedMVMPredecessors(*it, 
                         isVisited,
-                        mergedMVMSetOfMergedMVMs,
-                        preCount,
-                        sucCount,
-                        preBool,
-                        sucBool);
-                    mergedPred.insert(pred.begin(), pred.end());
+                        predecessors));
                 }
 
                 CoalescedMergedMVMSet* coalSet = (*it)->getCoalescedSet();
@@ -358,35 +392,13 @@ std::set<int> Coalescer::findMergedMVMPredecessors
                 }
             }
         }
-        // if I'm merged mvm => then add it
-        for(auto it = mergedPred.begin(); it != mergedPred.end(); it++){
-            int mergedMId = *it;
-            // add the mergedM as the predecessor of the mergedMVM
-            if(!preBool[mergedMVM->mergedId][mergedMId]){
-                mergedMVMSetOfMergedMVMs[mergedMVM->mergedId]
-                    [preCount[mergedMVM->mergedId]++] = mergedMId;
-                preBool[mergedMVM->mergedId][mergedMId] = true;
-            }
-
-            if(!sucBool[mergedMId][mergedMVM->mergedId]){
-                mergedMVMSetOfMergedMVMs[mergedMId]
-                    [mergedCount - 1 - sucCount[mergedMId]++] = mergedMVM->mergedId;
-                sucBool[mergedMId][mergedMVM->mergedId] = true;
-            }
-        }
+        // add the mergedM as the predecessor of the mergedMVM
+        predecessors[mergedMVM->mergedId].unionWith(mergedPred);
 
     } 
     // if visited => fast return
     else {
-        // mergedPred 
-        int preTemp = preCount[mergedMVM->mergedId];
-        for(unsigned int precount = 0; 
-            precount < preTemp; precount++){
-
-            unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                [mergedMVM->mergedId][precount];
-            mergedPred.insert(mergedMVMPreId);
-        }
+        mergedPred = predecessors[mergedMVM->mergedId];
     }
 
     // iterate over the predecessors
@@ -395,19 +407,17 @@ std::set<int> Coalescer::findMergedMVMPredecessors
 
 
 void Coalescer::coalesceMVMPredecessors(Operation* op, 
-    std::set<Operation*>& isVisited, 
-    unsigned int** mergedMVMSetOfMergedMVMs,
-    unsigned int* preCount,
-    unsigned int* sucCount,
-    bool** preBool,
-    bool** sucBool) {
+    OperationSet& isVisited, 
+    std::vector<SparseBitSet>& predecessors,
+    std::vector<SparseBitSet>& successors) {
 
+    const HardwareConfig& hardware = model_->getHardwareConfig();
     if(!isVisited.count(op)) {
         // Visit nodes in reverse postorder 
         // (not necessary, but visiting in same order as 
         // linearization helps reduce register pressure)
         if(ConsumerOperation* consumer = 
-            dynamic_cast<ConsumerOperation*>(op)) {
+            opcast<ConsumerOperation>(op)) {
             // reverse post order!
             // we iterate over the consumers
 
@@ -415,26 +425,23 @@ void Coalescer::coalesceMVMPredecessors(Operation* op,
                 ProducerOperation* predecessor = consumer->getOperand(o);
                 coalesceMVMPredecessors
                     (predecessor, isVisited, 
-                    mergedMVMSetOfMergedMVMs,
-                    preCount,
-                    sucCount,
-                    preBool,
-                    sucBool);
+                    predecessors,
+                    successors);
             }
 
             // if the consumer (current op) is MVM operation
             // (coalesce only the MVM operations)
-            if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(consumer)) {
+            if(MVMOperation* mvm = opcast<MVMOperation>(consumer)) {
                 // if the current mvm is not currently coalesced
                 MergedMVMSet* mergedMVM = mvm->getMergedSet();
                 if(mergedMVM->getCoalescedSet() == NULL) {
                     
                     // retrieve the coalesced set for the given (tile / core)
                     std::vector<CoalescedMergedMVMSet*> &coreCoalescedSets = 
-                        coalescedMVMSets_[placer_->getPTile(mvm)*N_CORES_PER_TILE + 
+                        coalescedMVMSets_[placer_->getPTile(mvm)*hardware.nCoresPerTile_ + 
                         placer_->getPCore(mvm)];
                     std::vector<CoalescedMergedMVMSet*> &remainingCoreCoalescedSets = 
-                        remainingCoalescedMVMSets_[placer_->getPTile(mvm)*N_CORES_PER_TILE + 
+                        remainingCoalescedMVMSets_[placer_->getPTile(mvm)*hardware.nCoresPerTile_ + 
                         placer_->getPCore(mvm)];
 
                     unsigned int pMVMU = placer_->getPMVMU(mvm);
@@ -470,8 +477,8 @@ void Coalescer::coalesceMVMPredecessors(Operation* op,
                                 // check if there is a dependecy
                                 // (either predecessor / successor)
                                 if(mergedM != NULL){
-                                    hasDataHazard = preBool[mergedMVM->mergedId][mergedM->mergedId]
-                                        || sucBool[mergedMVM->mergedId][mergedM->mergedId];
+                                    hasDataHazard = predecessors[mergedMVM->mergedId].test(mergedM->mergedId)
+                                        || successors[mergedMVM->mergedId].test(mergedM->mergedId);
                                 }
                                 if(hasDataHazard) break;
                             }
@@ -481,7 +488,7 @@ void Coalescer::coalesceMVMPredecessors(Operation* op,
                     }
                     if(coalescedSet == NULL) {
                         // Create new coalesced set if none found
-                        coalescedSet = new CoalescedMergedMVMSet();
+                        coalescedSet = new CoalescedMergedMVMSet(hardware.nConstantMVMUsPerCore_);
                         coreCoalescedSets.push_back(coalescedSet);
                         remainingCoreCoalescedSets.push_back(coalescedSet);
                     }
@@ -493,147 +500,41 @@ void Coalescer::coalesceMVMPredecessors(Operation* op,
                             // predecessors of m and successors of m
                             // i.e., synchronize the dependency of the
                             // coalescedSet!!!
-                            // iterate over the predecessors
-                            int preTemp1 = preCount[mergedMVM->mergedId];
-                            int sucTemp1 = sucCount[mergedM->mergedId];
-
-                            for(unsigned int precount = 0; 
-                                precount < preTemp1; precount++){
-                                // the mergedMVMPreId => returns the id of the pred
-                                unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                    [mergedMVM->mergedId][precount];
-
-                                if(!preBool[mergedM->mergedId][mergedMVMPreId]){
-                                    //// the mvm's predecessor becomes m's predecessor
-                                    mergedMVMSetOfMergedMVMs[mergedM->mergedId]
-                                        [preCount[mergedM->mergedId]++] = mergedMVMPreId;
-                                    preBool[mergedM->mergedId][mergedMVMPreId] = true;
-                                }
-                                //// the m becomes mem's predeceddors's successor
-
-                                if(!sucBool[mergedMVMPreId][mergedM->mergedId]){
-                                    mergedMVMSetOfMergedMVMs[mergedMVMPreId]
-                                        [mergedCount - 1 - sucCount[mergedMVMPreId]++] = mergedM->mergedId;
-                                    sucBool[mergedMVMPreId][mergedM->mergedId] = true;
-                                }
+                            SparseBitSet mvmPre = predecessors[mergedMVM->mergedId];
+                            SparseBitSet mSuc = successors[mergedM->mergedId];
+                            std::vector<unsigned int> mvmPreIds = mvmPre.elements();
+                            std::vector<unsigned int> mSucIds = mSuc.elements();
+
+                            // the mvm's predecessor becomes m's predecessor
+                            // and m becomes the mvm's predecessors's successor
+                            predecessors[mergedM->mergedId].unionWith(mvmPre);
+                            for(unsigned int mergedMVMPreId : mvmPreIds) {
+                                successors[mergedMVMPreId].insert(mergedM->mergedId);
                             }
-
-                            if(preTemp1 != 0 && sucTemp1 != 0){
-
-                                #pragma omp parallel for if(sucTemp1 > 1000 || preTemp1 > 10000)
-                                for(unsigned int succount = 0; 
-                                    succount < sucTemp1; succount++){
-                                    unsigned int mergedMVMSucId = 
-                                        mergedMVMSetOfMergedMVMs
-                                        [mergedM->mergedId][mergedCount - 1 - succount];
-
-                                    for(unsigned int precount = 0; 
-                                        precount < preTemp1; precount++){
-                                        unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                            [mergedMVM->mergedId][precount];
-
-                                        if(!preBool[mergedMVMSucId][mergedMVMPreId]){
-                                            mergedMVMSetOfMergedMVMs[mergedMVMSucId]
-                                                [preCount[mergedMVMSucId]++] = mergedMVMPreId;
-                                            preBool[mergedMVMSucId][mergedMVMPreId] = true;
-                                        }
-                                    }
-                                }
-
-                                #pragma omp parallel for if(preTemp1 > 1000 || sucTemp1 > 10000)
-                                for(unsigned int precount = 0; 
-                                    precount < preTemp1; precount++){
-                                    unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                        [mergedMVM->mergedId][precount];
-                                    for(unsigned int succount = 0; 
-                                        succount < sucTemp1; succount++){
-
-                                        // the mergedMVMSucId => returns the id of the succ
-                                        // the merged suc id => 
-                                        unsigned int mergedMVMSucId = 
-                                            mergedMVMSetOfMergedMVMs
-                                            [mergedM->mergedId][mergedCount - 1 - succount];
-
-                                        if(!sucBool[mergedMVMPreId][mergedMVMSucId]){
-                                            mergedMVMSetOfMergedMVMs[mergedMVMPreId]
-                                                [mergedCount - 1 - sucCount[mergedMVMPreId]++] 
-                                                    = mergedMVMSucId;
-                                            sucBool[mergedMVMPreId][mergedMVMSucId] = true;
-                                        }
-                                    }
-                                }
+                            for(unsigned int mergedMVMSucId : mSucIds) {
+                                predecessors[mergedMVMSucId].unionWith(mvmPre);
+                            }
+                            for(unsigned int mergedMVMPreId : mvmPreIds) {
+                                successors[mergedMVMPreId].unionWith(mSuc);
                             }
 
                             // m's predecessor becomes the predecessor of mvm
                             // mvm's successor becomes the successor 
                             // of the m's predecessors
-                            int preTemp2 = preCount[mergedM->mergedId];
-                            int sucTemp2 = sucCount[mergedMVM->mergedId];
-                            
-                            for(unsigned int precount = 0; 
-                                precount < preTemp2; precount++){
-                                // the mergedMVMPreId => returns the id of the pred
-                                unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                    [mergedM->mergedId][precount];
-
-                                //// the mvm's predecessor becomes m's predecessor
-                                if(!preBool[mergedMVM->mergedId][mergedMVMPreId]){
-                                    mergedMVMSetOfMergedMVMs[mergedMVM->mergedId]
-                                        [preCount[mergedMVM->mergedId]++] = mergedMVMPreId;
-                                    preBool[mergedMVM->mergedId][mergedMVMPreId] = true;
-                                }
-
-                                if(!sucBool[mergedMVMPreId][mergedMVM->mergedId]){
-                                    // the m becomes mem's predeceddors's successor
-                                    mergedMVMSetOfMergedMVMs[mergedMVMPreId]
-                                        [mergedCount - 1 - sucCount[mergedMVMPreId]] = mergedMVM->mergedId;
-                                    sucCount[mergedMVMPreId] += 1;
-                                    sucBool[mergedMVMPreId][mergedMVM->mergedId] = true;
-                                }
+                            SparseBitSet mPre = predecessors[mergedM->mergedId];
+                            SparseBitSet mvmSuc = successors[mergedMVM->mergedId];
+                            std::vector<unsigned int> mPreIds = mPre.elements();
+                            std::vector<unsigned int> mvmSucIds = mvmSuc.elements();
+
+                            predecessors[mergedMVM->mergedId].unionWith(mPre);
+                            for(unsigned int mergedMVMPreId : mPreIds) {
+                                successors[mergedMVMPreId].insert(mergedMVM->mergedId);
                             }
-                            if(preTemp2 != 0 && sucTemp2 != 0){
-                                #pragma omp parallel for if(sucTemp2 > 1000 || preTemp2 > 10000)
-                                for(unsigned int succount = 0; 
-                                    succount < sucTemp2; succount++){
-
-                                    // the mergedMVMSucId => returns the id of the succ
-                                    unsigned int mergedMVMSucId = 
-                                        mergedMVMSetOfMergedMVMs
-                                        [mergedMVM->mergedId][mergedCount - 1- succount];
-                                    for(unsigned int precount = 0; 
-                                        precount < preTemp2; precount++){
-
-                                        unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                            [mergedM->mergedId][precount];
-                                        
-                                        if(!preBool[mergedMVMSucId][mergedMVMPreId]){
-                                            mergedMVMSetOfMergedMVMs[mergedMVMSucId]
-                                                [preCount[mergedMVMSucId]++] = mergedMVMPreId;
-                                            preBool[mergedMVMSucId][mergedMVMPreId] = true;
-                                        }
-                                    }
-                                }
-
-                                #pragma omp parallel for if(preTemp2 > 1000 || sucTemp2 > 10000)
-                                for(unsigned int precount = 0; 
-                                    precount < preTemp2; precount++){
-                                    unsigned int mergedMVMPreId = mergedMVMSetOfMergedMVMs
-                                        [mergedM->mergedId][precount];
-                                    for(unsigned int succount = 0; 
-                                        succount < sucTemp2; succount++){
-
-                                        // the mergedMVMSucId => returns the id of the succ
-                                        unsigned int mergedMVMSucId = 
-                                            mergedMVMSetOfMergedMVMs
-                                            [mergedMVM->mergedId][mergedCount - 1- succount];
-
-                                        if(!sucBool[mergedMVMPreId][mergedMVMSucId]){
-                                            mergedMVMSetOfMergedMVMs[mergedMVMPreId]
-                                                [mergedCount - 1 - sucCount[mergedMVMPreId]++] = mergedMVMSucId;
-                                            sucBool[mergedMVMPreId][mergedMVMSucId] = true;
-                                        }
-                                    }
-                                }
+                            for(unsigned int mergedMVMSucId : mvmSucIds) {
+                                predecessors[mergedMVMSucId].unionWith(mPre);
+                            }
+                            for(unsigned int mergedMVMPreId : mPreIds) {
+                                successors[mergedMVMPreId].unionWith(mvmSuc);
                             }
                         }
                     }
@@ -647,29 +548,23 @@ void Coalescer::coalesceMVMPredecessors(Operation* op,
             }
         }
         if(TileMemoryReadOperation* read = 
-            dynamic_cast<TileMemoryReadOperation*>(op)) {
+            opcast<TileMemoryReadOperation>(op)) {
 
             for(unsigned int i = 0; i < read->numSrcs(); ++i) {
                 TileMemoryWriteOperation* predecessor = read->getSrc(i);
 
                 coalesceMVMPredecessors
                     (predecessor, isVisited, 
-                    mergedMVMSetOfMergedMVMs,
-                    preCount,
-                    sucCount,
-                    preBool,
-                    sucBool);
+                    predecessors,
+                    successors);
             }
         }
-        if(ReceiveOperation* recv = dynamic_cast<ReceiveOperation*>(op)) {
+        if(ReceiveOperation* recv = opcast<ReceiveOperation>(op)) {
             SendOperation* predecessor = recv->getSrc();
             coalesceMVMPredecessors
                 (predecessor, isVisited, 
-                 mergedMVMSetOfMergedMVMs,
-                 preCount,
-                 sucCount,
-                 preBool,
-                 sucBool);
+                 predecessors,
+                 successors);
         }
         isVisited.insert(op);
     }
@@ -8,11 +8,31 @@
 
 #include <map>
 #include <set>
+#include <stdint.h>
 #include <vector>
 #include <sys/time.h>
 
 #include "common.h"
 
+// Set of merged MVM ids kept as sorted 64-bit blocks. Transitive dependence
+// sets are sparse for most of the graph, so only non-empty blocks are stored.
+class SparseBitSet {
+
+    private:
+
+        std::vector<uint32_t> blocks_;
+        std::vector<uint64_t> words_;
+
+    public:
+
+        bool test(unsigned int id) const;
+        void insert(unsigned int id);
+        void unionWith(const SparseBitSet& other);
+        bool empty() const { return blocks_.empty(); }
+        std::vector<unsigned int> elements() const;
+
+};
+
 class Coalescer {
 
     private:
@@ -27,23 +47,16 @@ class Coalescer {
         std::vector<CoalescedMergedMVMSet*>** perMVMAvailCoalescedMVMSets_;
 
         void coalesceMVMOperations();
-        std::set<int> findMergedMVMPredecessors(MergedMVMSet* mergedMVM, 
+        SparseBitSet findMergedMVMPredecessors(MergedMVMSet* mergedMVM, 
             std::set<MergedMVMSet*>& isVisted,
-            unsigned int** mergedMVMSetOfMergedMVMs,
-            unsigned int* preCount,
-            unsigned int* sucCount,
-            bool** preBool, 
-            bool** sucBool);
+            std::vector<SparseBitSet>& predecessors);
 
         std::set<MergedMVMSet*> findNearestMergedMVMPredecessors(Operation* op, bool start
             , std::set<Operation*>& isVisited);
         void coalesceMVMPredecessors(Operation* op, 
-            std::set<Operation*>& isVisited, 
-            unsigned int** mergedMVMSetOfMergedMVMs,
-            unsigned int* preCount,
-            unsigned int* sucCount,
-            bool** preBool,
-            bool** sucBool);
+            OperationSet& isVisited, 
+            std::vector<SparseBitSet>& predecessors,
+            std::vector<SparseBitSet>& successors);
 
     public:
 
@@ -53,5 +66,7 @@ class Coalescer {
             std::vector<std::vector<MergedMVMSet*>*>& coalesceableMVMVectors);
         ~Coalescer();
 
+        unsigned int getNumCoalescedSets();
+
 };
 
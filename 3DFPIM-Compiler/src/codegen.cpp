@@ -9,9 +9,11 @@
 #include <assert.h>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
 #include "3dfpim.h"
 
+#include "binary.h"
 #include "coalescer.h"
 #include "codegen.h"
 #include "linearizer.h"
@@ -23,241 +25,231 @@
 
 #include <iostream>
 
-CodeGenerator::CodeGenerator(ModelImpl* model, Placer* placer, MemoryAllocator* memoryAllocator, Coalescer* coalescer, Linearizer* linearizer, RegisterAllocator* registerAllocator)
-    : model_(model), placer_(placer), memoryAllocator_(memoryAllocator), coalescer_(coalescer), linearizer_(linearizer), registerAllocator_(registerAllocator)
+CodeGenerator::CodeGenerator(ModelImpl* model, Placer* placer, MemoryAllocator* memoryAllocator, Coalescer* coalescer, Linearizer* linearizer, RegisterAllocator* registerAllocator, CompilerOptions::CodeFormat format, std::string containerFileName)
+    : model_(model), placer_(placer), memoryAllocator_(memoryAllocator), coalescer_(coalescer), linearizer_(linearizer), registerAllocator_(registerAllocator), format_(format), containerFileName_(containerFileName)
 {
     codegen();
 }
 
+// Largest width not exceeding maxWidth that evenly divides the vector
+static unsigned int transferWidth(unsigned int length, unsigned int maxWidth) {
+    unsigned int width;
+    for(width = maxWidth; !(length%width == 0); --width);
+    return width;
+}
+
 void CodeGenerator::codegen() {
 
-    // TODO: Define ABI for laying out the binary
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    assert(hardware.nConstantMVMUsPerCore_ <= 32 && "MVMU mask does not fit in an instruction");
+
+    // Programs are independent and only read the results of earlier passes,
+    // so every tile and core is generated concurrently. Stream i is tile
+    // i/(nCoresPerTile + 1), followed by its cores, as in the binary.
+    const unsigned int nCoresPerTile = hardware.nCoresPerTile_;
+    unsigned int nStreams = placer_->getNPTiles()*(nCoresPerTile + 1);
+    bool binary = (format_ == CompilerOptions::CF_BINARY);
+    bool container = binary || !containerFileName_.empty();
+    std::vector<CodeStream> streams(container?nStreams:0);
+    const unsigned int nChips = placer_->getNChips();
+    if(!binary) {
+        makeChipDirectories(model_->getName(), nChips);
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for(unsigned int stream = 0; stream < nStreams; ++stream) {
+        unsigned int pTile = stream/(nCoresPerTile + 1);
+        unsigned int slot = stream%(nCoresPerTile + 1);
+        CodeStream local;
+        CodeStream& code = container?streams[stream]:local;
+        if(slot == 0) {
+            codegen(pTile, code);
+        } else {
+            codegen(pTile, slot - 1, code);
+        }
+        if(!binary) {
+            std::ofstream file(getProgramFileName(model_->getName(), nChips,
+                placer_->getChip(pTile), pTile, (int) slot - 1));
+            code.disassemble(file, hardware.nConstantMVMUsPerCore_);
+            file.close();
+        }
+    }
+
+    // The container is written serially so its layout does not depend on scheduling
+    if(binary) {
+        writeContainer(model_->getName() + ".3dfpimbin", streams);
+    }
+    if(!containerFileName_.empty()) {
+        writeContainer(containerFileName_, streams);
+    }
 
+}
+
+void CodeGenerator::writeContainer(std::string fileName, std::vector<CodeStream>& streams) {
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    BinaryWriter writer(fileName, model_->getName(), placer_->getNPTiles(),
+        hardware.nCoresPerTile_, hardware.nConstantMVMUsPerCore_);
     for(unsigned int pTile = 0; pTile < placer_->getNPTiles(); ++pTile) {
+        writer.setChip(pTile, placer_->getChip(pTile));
+    }
+    for(CodeStream& code : streams) {
+        writer.append(code);
+    }
+    writer.close();
+}
 
-        // Generate code for the tile
-        std::stringstream fileName;
-        fileName << model_->getName() << "-tile" << pTile << ".3dfpim";
-        std::ofstream tileCode;
-        tileCode.open(fileName.str());
-        std::list<TileOperation*>& tileOperationList = linearizer_->getTileOperationList(pTile);
-        for(TileOperation* tileOp : tileOperationList) {
-            if(SendOperation* send = dynamic_cast<SendOperation*>(tileOp)) {
-                tileCode << codegen(send);
-            } else if(ReceiveOperation* recv = dynamic_cast<ReceiveOperation*>(tileOp)) {
-                tileCode << codegen(recv);
-            } else if(WriteInputOperation* write = dynamic_cast<WriteInputOperation*>(tileOp)) {
-                tileCode << codegen(write);
-            } else if(ReadOutputOperation* read = dynamic_cast<ReadOutputOperation*>(tileOp)) {
-                tileCode << codegen(read);
-            } else {
+void CodeGenerator::codegen(unsigned int pTile, CodeStream& code) {
+    std::list<TileOperation*>& tileOperationList = linearizer_->getTileOperationList(pTile);
+    for(TileOperation* tileOp : tileOperationList) {
+        switch(tileOp->getKind()) {
+            case Operation::SEND:
+                codegen(opcast<SendOperation>(tileOp), code);
+                break;
+            case Operation::RECEIVE:
+                codegen(opcast<ReceiveOperation>(tileOp), code);
+                break;
+            case Operation::WRITE_INPUT:
+                // Inputs are written to tile memory by the host
+                break;
+            case Operation::READ_OUTPUT:
+                // Outputs are read from tile memory by the host
+                break;
+            default:
                 assert(0 && "Unsupported operation for code generation!");
-            }
         }
-        tileCode << "halt()" << std::endl;
-        tileCode.close();
+    }
+    code.append(Instruction(Instruction::HALT));
+}
 
-        // Generate code for each core in the tile
-        for(unsigned int pCore = 0; pCore < N_CORES_PER_TILE; ++pCore) {
-            std::stringstream fileName;
-            fileName << model_->getName() << "-tile" << pTile << "-core" << pCore << ".3dfpim";
-            std::ofstream coreCode;
-            coreCode.open(fileName.str());
-            std::list<CoreOperation*>& coreOperationList = 
-                linearizer_->getCoreOperationList(pTile, pCore);
-            for(CoreOperation* coreOp : coreOperationList) {
-                if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(coreOp)) {
-                    coreCode << codegen(mvm);
-                } else if(ALUVectorOperation* aluOp = dynamic_cast<ALUVectorOperation*>(coreOp)) {
-                    coreCode << codegen(aluOp);
-                } else if(SetImmediateOperation* seti = dynamic_cast<SetImmediateOperation*>(coreOp)) {
-                    coreCode << codegen(seti);
-                } else if(CopyOperation* copy = dynamic_cast<CopyOperation*>(coreOp)) {
-                    coreCode << codegen(copy);
-                } else if(LoadOperation* load = dynamic_cast<LoadOperation*>(coreOp)) {
-                    coreCode << codegen(load);
-                } else if(StoreOperation* store = dynamic_cast<StoreOperation*>(coreOp)) {
-                    coreCode << codegen(store);
-                } else if(MVMGuardOperation* guard = dynamic_cast<MVMGuardOperation*>(coreOp)) {
-                    coreCode << codegen(guard);
-                } else {
-                    assert(0 && "Unsupported operation for code generation!");
-                }
-            }
-            coreCode << "hlt()" << std::endl;
-            coreCode.close();
+void CodeGenerator::codegen(unsigned int pTile, unsigned int pCore, CodeStream& code) {
+    std::list<CoreOperation*>& coreOperationList = 
+        linearizer_->getCoreOperationList(pTile, pCore);
+    for(CoreOperation* coreOp : coreOperationList) {
+        switch(coreOp->getKind()) {
+            case Operation::MVM:
+                codegen(opcast<MVMOperation>(coreOp), code);
+                break;
+            case Operation::ALU_VECTOR:
+                codegen(opcast<ALUVectorOperation>(coreOp), code);
+                break;
+            case Operation::SET_IMMEDIATE:
+                codegen(opcast<SetImmediateOperation>(coreOp), code);
+                break;
+            case Operation::COPY:
+                codegen(opcast<CopyOperation>(coreOp), code);
+                break;
+            case Operation::LOAD:
+                codegen(opcast<LoadOperation>(coreOp), code);
+                break;
+            case Operation::STORE:
+                codegen(opcast<StoreOperation>(coreOp), code);
+                break;
+            case Operation::MVM_GUARD:
+                codegen(opcast<MVMGuardOperation>(coreOp), code);
+                break;
+            default:
+                assert(0 && "Unsupported operation for code generation!");
         }
-
     }
-
+    code.append(Instruction(Instruction::HLT));
 }
 
-std::string CodeGenerator::codegen(CoalescedMVMSet* coalescedMVMSet) {
-    std::stringstream ss;
-    ss << "mvm(['";
+void CodeGenerator::codegen(CoalescedMVMSet* coalescedMVMSet, CodeStream& code) {
+    Instruction instruction(Instruction::MVM);
+    instruction.flags |= Instruction::COALESCED;
 
-    int depth;
-    bool isLast;
-    int nStack;
-    int precision;
     std::string layer_name = "";
-    for(unsigned int i = 0; i < N_CONSTANT_MVMUS_PER_CORE; ++i) {
+    for(unsigned int i = 0; i < model_->getHardwareConfig().nConstantMVMUsPerCore_; ++i) {
         if(coalescedMVMSet->usesPMVMU(i)) {
             MVMOperation* mvm = coalescedMVMSet->getPMVMU(i);
-            depth = mvm->getDepth();
-            isLast = mvm->isMVMLast();
-            ss << 1;
+            instruction.mvm.mask |= 1u << i;
+            instruction.mvm.depth = mvm->getDepth();
+            if(mvm->isMVMLast()) {
+                instruction.flags |= Instruction::LAST;
+            } else {
+                instruction.flags &= ~Instruction::LAST;
+            }
             layer_name = mvm->printOperationType();
-            nStack = mvm->getNStack();
-            precision = mvm->getPrecision();
-        } else {
-            ss << 0;
+            instruction.mvm.stacks = mvm->getNStack();
+            instruction.mvm.precision = mvm->getPrecision();
         }
     }
-
-    ss << "'], depth = " << depth;
-    ss << ", precision = " << precision << "";
-    ss << ", stacks = " << nStack;
-    ss << ", name = '" << layer_name << "'";
-    if(isLast)
-        ss << ", isLast = True)\n";
-    else
-        ss << ", isLast = False)\n";
-    return ss.str();
+    instruction.mvm.name = code.addString(layer_name);
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(MVMOperation* mvm) {
+void CodeGenerator::codegen(MVMOperation* mvm, CodeStream& code) {
     CoalescedMVMSet* coalescedMVMSet = mvm->getCoalescedSet();
     if(coalescedMVMSet != NULL) {
-        if(coalescedMVMSet->isSetLeader(mvm)) { 
         // Only one MVM in a coalesced set does code generation on behalf of the others
-            return codegen(coalescedMVMSet);
-        } else {
-            return "";
+        if(coalescedMVMSet->isSetLeader(mvm)) { 
+            codegen(coalescedMVMSet, code);
         }
     } else {
-        std::stringstream ss;
-        ss << "mvm(xb_nma = ['";
-        for(unsigned int i = 0; i < N_CONSTANT_MVMUS_PER_CORE; ++i) {
-            if(i == placer_->getPMVMU(mvm)) {
-                ss << 1;
-            } else {
-                ss << 0;
-            }
+        Instruction instruction(Instruction::MVM);
+        instruction.mvm.mask = 1u << placer_->getPMVMU(mvm);
+        instruction.mvm.name = code.addString(mvm->printOperationType());
+        instruction.mvm.precision = mvm->getPrecision();
+        instruction.mvm.depth = mvm->getDepth();
+        instruction.mvm.stacks = mvm->getNStack();
+        instruction.mvm.slideId = mvm->getSlideId();
+        if(mvm->isMVMLast()) {
+            instruction.flags |= Instruction::LAST;
         }
-        ss << "']";
-        ss << ", name = '" << mvm->printOperationType() << "'";
-        ss << ", precision = " << mvm->getPrecision();
-        ss << ", depth = " << mvm->getDepth();
-        ss << ", stacks = " << mvm->getNStack();
-        ss << ", slideId = " << mvm->getSlideId();
-        if(mvm->isMVMLast())
-            ss << ", isLast = True)\n";
-        else
-            ss << ", isLast = False)\n";
-        return ss.str();
+        code.append(instruction);
     }
 }
 
-std::string CodeGenerator::codegen(ALUVectorOperation* aluOp) {
-    std::stringstream ss;
-    ss << "alu";
-    switch(aluOp->getOpCode()) {
-        case ALUVectorOperation::MULI:
-            ss << "i";
-    }
-    ss << "('";
-    switch(aluOp->getOpCode()) {
-        case ALUVectorOperation::RESIZE: ss << "resize"; break;
-        case ALUVectorOperation::CONCAT: ss << "concat"; break;
-        case ALUVectorOperation::ADD: ss << "add"; break;
-        case ALUVectorOperation::SUB: ss << "sub"; break;
-        case ALUVectorOperation::MUL:
-        case ALUVectorOperation::MULI: ss << "mul"; break;
-        case ALUVectorOperation::DIV: ss << "div"; break;
-        case ALUVectorOperation::AND: ss << "and"; break;
-        case ALUVectorOperation::OR: ss << "or"; break;
-        case ALUVectorOperation::NOT: ss << "not"; break;
-        case ALUVectorOperation::EQ: ss << "eq"; break;
-        case ALUVectorOperation::NEQ: ss << "neq"; break;
-        case ALUVectorOperation::LT: ss << "lt"; break;
-        case ALUVectorOperation::LEQ: ss << "leq"; break;
-        case ALUVectorOperation::GT: ss << "gt"; break;
-        case ALUVectorOperation::GEQ: ss << "geq"; break;
-        case ALUVectorOperation::MIN: ss << "min"; break;
-        case ALUVectorOperation::MAX: ss << "max"; break;
-        case ALUVectorOperation::MSE: ss << "mse"; break;
-        case ALUVectorOperation::SIG: ss << "sig"; break;
-        case ALUVectorOperation::NOACT: ss << "noact"; break;
-        case ALUVectorOperation::TANH: ss << "tanh"; break;
-        case ALUVectorOperation::EXP: ss << "exp"; break;
-        case ALUVectorOperation::LOG: ss << "log"; break;
-        case ALUVectorOperation::RELU: ss << "relu"; break;
-        case ALUVectorOperation::RELUD: ss << "relud"; break;
-        case ALUVectorOperation::LOG_SOFTMAX: ss << "log_softmax"; break;
-        case ALUVectorOperation::LOG_SOFTMAXD: ss << "log_softmaxd"; break;
-        case ALUVectorOperation::RNDCMP: ss << "rndcmp"; break;
-    }
-    ss << "', "
-       << "d1=" << registerAllocator_->getRegister(aluOp) << ", "
-       << "r1=" << registerAllocator_->getRegister(aluOp->getOperand(0)) << ", ";
+void CodeGenerator::codegen(ALUVectorOperation* aluOp, CodeStream& code) {
+    Instruction instruction(Instruction::ALU);
+    instruction.aluOp = aluOp->getOpCode();
+    instruction.alu.d1 = registerAllocator_->getRegister(aluOp);
+    instruction.alu.r1 = registerAllocator_->getRegister(aluOp->getOperand(0));
     if(aluOp->numOperands() > 1) {
-        ss << "r2=" << registerAllocator_->getRegister(aluOp->getOperand(1)) << ", ";
+        instruction.flags |= Instruction::BINARY;
+        instruction.alu.r2 = registerAllocator_->getRegister(aluOp->getOperand(1));
     }
     if(aluOp->isImmediate()) {
-        ss << "imm=" << aluOp->getImmediate() << ", ";
+        instruction.flags |= Instruction::IMMEDIATE;
+        instruction.alu.imm = aluOp->getImmediate();
     }
-    ss << "intermediate=False, ";
-    ss << "vec=" << aluOp->length()
-       << ")\n";
-    return ss.str();
+    instruction.alu.vec = aluOp->length();
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(SetImmediateOperation* seti) {
-    std::stringstream ss;
-    ss << "set("
-       << "d1=" << registerAllocator_->getRegister(seti) << ", "
-       << "imm=" << seti->getImmediate() << ", "
-       << "vec=" << seti->length() << ", ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+void CodeGenerator::codegen(SetImmediateOperation* seti, CodeStream& code) {
+    Instruction instruction(Instruction::SET);
+    instruction.set.d1 = registerAllocator_->getRegister(seti);
+    instruction.set.imm = seti->getImmediate();
+    instruction.set.vec = seti->length();
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(CopyOperation* copy) {
-    std::stringstream ss;
-    ss << "copy("
-       << "d1=" << registerAllocator_->getRegister(copy) << ", "
-       << "r1=" << registerAllocator_->getRegister(copy->getOperand(0)) << ", "
-       << "vec=" << copy->length() << ", "
-       << "src_type=" << 1 << ", ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+void CodeGenerator::codegen(CopyOperation* copy, CodeStream& code) {
+    Instruction instruction(Instruction::COPY);
+    instruction.copy.d1 = registerAllocator_->getRegister(copy);
+    instruction.copy.r1 = registerAllocator_->getRegister(copy->getOperand(0));
+    instruction.copy.vec = copy->length();
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(LoadOperation* load) {
-    std::stringstream ss;
-    unsigned int loadWidth;
-    for(loadWidth = MAX_LOAD_STORE_WIDTH; !(load->length()%loadWidth == 0); --loadWidth);
-    ss << "load("
-       << "d1=" << registerAllocator_->getRegister(load) << ", "
-       << "r1=" << registerAllocator_->getRegister(load->getOperand(0)) << ", "
-       << "load_width=" << loadWidth << ", "
-       << "vec=" << load->length()/loadWidth << ", ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+void CodeGenerator::codegen(LoadOperation* load, CodeStream& code) {
+    Instruction instruction(Instruction::LOAD);
+    unsigned int loadWidth = transferWidth(load->length(), model_->getHardwareConfig().maxLoadStoreWidth_);
+    instruction.load.d1 = registerAllocator_->getRegister(load);
+    instruction.load.r1 = registerAllocator_->getRegister(load->getOperand(0));
+    instruction.load.width = loadWidth;
+    instruction.load.vec = load->length()/loadWidth;
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(StoreOperation* store) {
-    std::stringstream ss;
-    unsigned int storeWidth;
-    for(storeWidth = MAX_LOAD_STORE_WIDTH; !(store->length()%storeWidth == 0); --storeWidth);
+void CodeGenerator::codegen(StoreOperation* store, CodeStream& code) {
+    Instruction instruction(Instruction::STORE);
+    unsigned int storeWidth = transferWidth(store->length(), model_->getHardwareConfig().maxLoadStoreWidth_);
 
     int counter = 0;
     for (auto u = store->user_begin(); u != store->user_end(); ++u) {
-        if (MVMGuardOperation* guard = dynamic_cast<MVMGuardOperation*>(*u)) {
+        if (MVMGuardOperation* guard = opcast<MVMGuardOperation>(*u)) {
             continue;
         }
         else {
@@ -265,88 +257,83 @@ std::string CodeGenerator::codegen(StoreOperation* store) {
         }
     }
 
-    ss << "store(d1=" << registerAllocator_->getRegister(store->getOperand(1)) << ", "
-       << "r1=" << registerAllocator_->getRegister(store->getOperand(0)) << ", "
-       << "counter=" << counter << ", "
-       << "store_width=" << storeWidth << ", "
-       << "vec=" << store->length()/storeWidth << ", ";
-    ss << "dst=[";
+    instruction.store.d1 = registerAllocator_->getRegister(store->getOperand(1));
+    instruction.store.r1 = registerAllocator_->getRegister(store->getOperand(0));
+    instruction.store.counter = counter;
+    instruction.store.width = storeWidth;
+    instruction.store.vec = store->length()/storeWidth;
     for (auto u = store->user_begin(); u != store->user_end(); ++u) {
         TileMemoryReadOperation* user = *u;
-        if (LoadOperation* load = dynamic_cast<LoadOperation*>(user)) {
-            ss << "(" << placer_->getPTile(load) << "," << placer_->getPCore(load) << "), ";
+        uint32_t dst;
+        if (LoadOperation* load = opcast<LoadOperation>(user)) {
+            dst = code.addDestination(placer_->getPTile(load), placer_->getPCore(load));
         }
-        else if (MVMGuardOperation* guard = dynamic_cast<MVMGuardOperation*>(user)) {
+        else if (MVMGuardOperation* guard = opcast<MVMGuardOperation>(user)) {
             continue;
         }
-        else if (SendOperation* send = dynamic_cast<SendOperation*>(user)) {
+        else if (SendOperation* send = opcast<SendOperation>(user)) {
             ReceiveOperation* recv = send->getDst();
             for (auto ru = recv->user_begin(); ru != recv->user_end(); ++ru) {
                 TileMemoryReadOperation* recv_user = *ru;
-                if (LoadOperation* load = dynamic_cast<LoadOperation*>(recv_user)) {
-                    ss << "(" << placer_->getPTile(load) << "," << placer_->getPCore(load) << "), ";
+                if (LoadOperation* load = opcast<LoadOperation>(recv_user)) {
+                    dst = code.addDestination(placer_->getPTile(load), placer_->getPCore(load));
                 }
-                else if (MVMGuardOperation* guard = dynamic_cast<MVMGuardOperation*>(recv_user)) {
+                else if (MVMGuardOperation* guard = opcast<MVMGuardOperation>(recv_user)) {
                     continue;
                 }
-                else if (SendOperation* sendrecv = dynamic_cast<SendOperation*>(recv_user)) {
+                else if (SendOperation* sendrecv = opcast<SendOperation>(recv_user)) {
                     assert(0 && "Send cannot consume receive");
                 }
-                else if (ReadOutputOperation* output = dynamic_cast<ReadOutputOperation*>(recv_user)) {
-                    ss << "(1, 0), ";
+                else if (ReadOutputOperation* output = opcast<ReadOutputOperation>(recv_user)) {
+                    dst = code.addDestination(1, Destination::OUTPUT);
                 }
                 else {
                     assert(0 && "Only load, send, output can consume receive");
                 }
+                if (instruction.store.nDsts++ == 0) {
+                    instruction.store.dst = dst;
+                }
             }
+            continue;
         }
         else {
             assert(0 && "Only load and send can consume store");
         }
+        if (instruction.store.nDsts++ == 0) {
+            instruction.store.dst = dst;
+        }
     }
-    ss << "], ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(MVMGuardOperation* guard) {
-    std::stringstream ss;
-    unsigned int guardWidth;
-    for(guardWidth = MAX_LOAD_STORE_WIDTH; !(guard->length()%guardWidth == 0); --guardWidth);
-    ss << "guard("
-       << "r1=" << registerAllocator_->getRegister(guard->getOperand(0)) << ", "
-       << "guard_width=" << guardWidth << ", "
-       << "vec=" << guard->length()/guardWidth << ", ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+void CodeGenerator::codegen(MVMGuardOperation* guard, CodeStream& code) {
+    Instruction instruction(Instruction::GUARD);
+    unsigned int guardWidth = transferWidth(guard->length(), model_->getHardwareConfig().maxLoadStoreWidth_);
+    instruction.guard.r1 = registerAllocator_->getRegister(guard->getOperand(0));
+    instruction.guard.width = guardWidth;
+    instruction.guard.vec = guard->length()/guardWidth;
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(SendOperation* send) {
-    std::stringstream ss;
-    unsigned int sendWidth;
-    for(sendWidth = MAX_SEND_RECV_WIDTH; !(send->length()%sendWidth == 0); --sendWidth);
-    ss << "send("
-       << "mem_addr=" << memoryAllocator_->getTileMemoryAddress(send->getSrc(0)) << ", "
-       << "vtile_id=" << placer_->getPTile(send) << ", " // FIXME: Assign sender IDs
-       << "send_width=" << sendWidth << ", "
-       << "target_addr=" << placer_->getPTile(send->getDst()) << ", "
-       << "vec=" << send->length()/sendWidth << ", "
-       << "op_id=" << send->id << ", ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+void CodeGenerator::codegen(SendOperation* send, CodeStream& code) {
+    Instruction instruction(Instruction::SEND);
+    unsigned int sendWidth = transferWidth(send->length(), model_->getHardwareConfig().maxSendRecvWidth_);
+    instruction.send.memAddr = memoryAllocator_->getTileMemoryAddress(send->getSrc(0));
+    instruction.send.vtile = placer_->getPTile(send); // FIXME: Assign sender IDs
+    instruction.send.width = sendWidth;
+    instruction.send.target = placer_->getPTile(send->getDst());
+    instruction.send.vec = send->length()/sendWidth;
+    instruction.send.opId = send->id;
+    code.append(instruction);
 }
 
-std::string CodeGenerator::codegen(ReceiveOperation* recv) {
-    std::stringstream ss;
-    unsigned int recvWidth;
-    for(recvWidth = MAX_SEND_RECV_WIDTH; !(recv->length()%recvWidth == 0); --recvWidth);
+void CodeGenerator::codegen(ReceiveOperation* recv, CodeStream& code) {
+    Instruction instruction(Instruction::RECEIVE);
+    unsigned int recvWidth = transferWidth(recv->length(), model_->getHardwareConfig().maxSendRecvWidth_);
 
     int counter = 0;
     for (auto u = recv->user_begin(); u != recv->user_end(); ++u) {
-        if (MVMGuardOperation* guard = dynamic_cast<MVMGuardOperation*>(*u)) {
+        if (MVMGuardOperation* guard = opcast<MVMGuardOperation>(*u)) {
             continue;
         }
         else {
@@ -354,22 +341,11 @@ std::string CodeGenerator::codegen(ReceiveOperation* recv) {
         }
     }
 
-    ss << "receive(mem_addr=" << memoryAllocator_->getTileMemoryAddress(recv) << ", "
-       << "vtile_id=" << placer_->getPTile(recv->getSrc()) << ", " // FIXME: Assign sender IDs
-       << "receive_width=" << recvWidth << ", "
-       << "counter=" << counter << ", "
-       << "vec=" << recv->length()/recvWidth << ", "
-       << "op_id=" << recv->id << ", ";
-    ss << "intermediate=False";
-    ss << ")\n";
-    return ss.str();
+    instruction.recv.memAddr = memoryAllocator_->getTileMemoryAddress(recv);
+    instruction.recv.vtile = placer_->getPTile(recv->getSrc()); // FIXME: Assign sender IDs
+    instruction.recv.width = recvWidth;
+    instruction.recv.counter = counter;
+    instruction.recv.vec = recv->length()/recvWidth;
+    instruction.recv.opId = recv->id;
+    code.append(instruction);
 }
-
-std::string CodeGenerator::codegen(WriteInputOperation* write) {
-    return "";
-}
-
-std::string CodeGenerator::codegen(ReadOutputOperation* read) {
-    return "";
-}
-
@@ -6,6 +6,9 @@
 * LICENSE file.
 *******************************************************************************/
 
+#include <string>
+#include <vector>
+
 #include "common.h"
 
 class CodeGenerator {
@@ -18,25 +21,27 @@ class CodeGenerator {
         Coalescer* coalescer_;
         Linearizer* linearizer_;
         RegisterAllocator* registerAllocator_;
+        CompilerOptions::CodeFormat format_;
+        std::string containerFileName_;     /* Extra copy of the code as a binary container, if set */
 
         void codegen();
-        std::string codegen(CoalescedMVMSet* coalescedMVMSet);
-        std::string codegen(MergedMVMSet* mergedMVM);
-        std::string codegen(MVMOperation* mvm);
-        std::string codegen(ALUVectorOperation* aluOp);
-        std::string codegen(SetImmediateOperation* seti);
-        std::string codegen(CopyOperation* copy);
-        std::string codegen(LoadOperation* load);
-        std::string codegen(StoreOperation* store);
-        std::string codegen(MVMGuardOperation* load);
-        std::string codegen(SendOperation* send);
-        std::string codegen(ReceiveOperation* recv);
-        std::string codegen(WriteInputOperation* write);
-        std::string codegen(ReadOutputOperation* read);
+        void writeContainer(std::string fileName, std::vector<CodeStream>& streams);
+        void codegen(unsigned int pTile, CodeStream& code);
+        void codegen(unsigned int pTile, unsigned int pCore, CodeStream& code);
+        void codegen(CoalescedMVMSet* coalescedMVMSet, CodeStream& code);
+        void codegen(MVMOperation* mvm, CodeStream& code);
+        void codegen(ALUVectorOperation* aluOp, CodeStream& code);
+        void codegen(SetImmediateOperation* seti, CodeStream& code);
+        void codegen(CopyOperation* copy, CodeStream& code);
+        void codegen(LoadOperation* load, CodeStream& code);
+        void codegen(StoreOperation* store, CodeStream& code);
+        void codegen(MVMGuardOperation* guard, CodeStream& code);
+        void codegen(SendOperation* send, CodeStream& code);
+        void codegen(ReceiveOperation* recv, CodeStream& code);
 
     public:
 
-        CodeGenerator(ModelImpl* model, Placer* placer, MemoryAllocator* memoryAllocator, Coalescer* coalescer, Linearizer* linearizer, RegisterAllocator* registerAllocator);
+        CodeGenerator(ModelImpl* model, Placer* placer, MemoryAllocator* memoryAllocator, Coalescer* coalescer, Linearizer* linearizer, RegisterAllocator* registerAllocator, CompilerOptions::CodeFormat format, std::string containerFileName="");
 
 };
 
@@ -11,31 +11,6 @@
 
 #include "3dfpim.h"
 
-/* Constants */
-
-// The size of column/row/depth of the crossbar array
-#define MVMU_DIM                        128
-#define MVMU_DPT                        64
-
-#define N_CONSTANT_MVMUS_PER_CORE       1
-#define N_CORES_PER_TILE                24
-#define MAX_LOAD_STORE_WIDTH            8
-#define MAX_SEND_RECV_WIDTH             8
-#define N_INPUT_REGISTERS               MVMU_DIM * N_CONSTANT_MVMUS_PER_CORE
-#define N_OUTPUT_REGISTERS              MVMU_DIM * N_CONSTANT_MVMUS_PER_CORE
-#define INPUT_REGISTERS_START_ADDRESS   0
-#define OUTPUT_REGISTERS_START_ADDRESS  (INPUT_REGISTERS_START_ADDRESS + N_INPUT_REGISTERS)
-#define REGISTER_FILE_START_ADDRESS     (OUTPUT_REGISTERS_START_ADDRESS + N_OUTPUT_REGISTERS)
-#define REGISTER_FILE_SIZE              (N_OUTPUT_REGISTERS) * 4
-#define REGISTERS_PER_CORE              (N_INPUT_REGISTERS + N_OUTPUT_REGISTERS + REGISTER_FILE_SIZE)
-
-#define STACK_REUSE_LATENCY             105
-#define STACK_SHIFT_LATENCY             170
-#define PRECHARGE_LATENCY               32
-#define ADC_LATENCY                     256
-
-#define N_MAX_TILE                      14 * 16
-
 /* tensors.h */
 class AbstractTensor;
 class AbstractVector;
@@ -81,17 +56,27 @@ class WriteInputOperation;
 class ReadOutputOperation;
 class PseudoInputOperation;
 class PseudoOutputOperation;
+class OperationSet;
 
 /* allocator.h */
 class CoreAllocator;
 class SpillTracker;
 
+/* arena.h */
+class Arena;
+
 /* model.h */
 class ModelImpl;
 
 /* partitioner.h */
 class Partitioner;
 
+/* multilevel.h */
+class MultilevelPartitioner;
+
+/* loadbalancer.h */
+class LoadBalancer;
+
 /* placer.h */
 class Placer;
 
@@ -110,5 +95,23 @@ class RegisterAllocator;
 /* codegen.h */
 class CodeGenerator;
 
+/* binary.h */
+struct Instruction;
+class CodeStream;
+class BinaryWriter;
+class BinaryReader;
+
+/* simulator.h */
+class Simulator;
+
+/* estimator.h */
+class Estimator;
+
+/* stats.h */
+class CompilerStats;
+
+/* cache.h */
+class CompilationCache;
+
 #endif
 
@@ -0,0 +1,277 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+
+#include "3dfpim.h"
+
+#include "estimator.h"
+#include "linearizer.h"
+#include "model.h"
+#include "operations.h"
+#include "placer.h"
+#include "simulator.h"
+#include "tensors.h"
+
+Estimator::Estimator(ModelImpl* model, Placer* placer, Linearizer* linearizer)
+    : model_(model), placer_(placer)
+{
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    nCores_ = placer->getNPCores();
+    nUnits_ = nCores_ + placer->getNPTiles();
+    programs_.resize(nUnits_);
+    for(unsigned int unit = 0; unit < nUnits_; ++unit) {
+        unsigned int pTile = getPTile(unit);
+        if(unit < nCores_) {
+            std::list<CoreOperation*>& coreOperationList =
+                linearizer->getCoreOperationList(pTile, unit%nCoresPerTile);
+            programs_[unit].assign(coreOperationList.begin(), coreOperationList.end());
+        } else {
+            std::list<TileOperation*>& tileOperationList =
+                linearizer->getTileOperationList(pTile);
+            programs_[unit].assign(tileOperationList.begin(), tileOperationList.end());
+        }
+    }
+    estimate();
+    traceCriticalPath();
+}
+
+unsigned int Estimator::getPTile(unsigned int unit) {
+    if(unit < nCores_) {
+        return unit/model_->getHardwareConfig().nCoresPerTile_;
+    } else {
+        return unit - nCores_;
+    }
+}
+
+unsigned int Estimator::getLayer(MVMOperation* mvm) {
+    // Matrix tiles are named after their layer followed by the tile indices
+    std::string name = mvm->getConstantMatrixTile()->name();
+    name = name.substr(0, name.find('['));
+    auto it = layerIndices_.find(name);
+    if(it != layerIndices_.end()) {
+        return it->second;
+    }
+    layerIndices_[name] = layers_.size();
+    layers_.push_back(LayerEstimate());
+    layers_.back().name = name;
+    return layers_.size() - 1;
+}
+
+Estimator::Category Estimator::getCategory(Operation* op) {
+    switch(op->getKind()) {
+        case Operation::LOAD:
+        case Operation::STORE:
+        case Operation::RECEIVE:
+        case Operation::MVM_GUARD:
+            return MEMORY;
+        case Operation::SEND:
+            return NETWORK;
+        default:
+            return COMPUTE;
+    }
+}
+
+void Estimator::estimate() {
+
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    const unsigned int nOperations = model_->op_count;
+    operations_.assign(nOperations, NULL);
+    start_.assign(nOperations, 0);
+    finish_.assign(nOperations, -1);
+    criticalPredecessor_.assign(nOperations, -1);
+    busy_.assign(nUnits_, 0);
+
+    // Every unit runs until it needs a result that is not produced yet, and
+    // resumes once it is; the order of the units does not change the result
+    std::vector<unsigned int> pc(nUnits_, 0);
+    std::vector<unsigned long long> time(nUnits_, 0);
+    std::vector<int> previous(nUnits_, -1);
+    std::map<int, std::vector<unsigned int>> waiters;
+    std::vector<unsigned int> ready;
+    for(unsigned int unit = 0; unit < nUnits_; ++unit) {
+        ready.push_back(unit);
+    }
+    while(!ready.empty()) {
+        unsigned int unit = ready.back();
+        ready.pop_back();
+        while(pc[unit] < programs_[unit].size()) {
+
+            Operation* op = programs_[unit][pc[unit]];
+            unsigned long long start = time[unit];
+            int predecessor = previous[unit];
+            int dependency = Simulator::getDependency(op);
+            if(dependency >= 0) {
+                if(finish_[dependency] < 0) {
+                    waiters[dependency].push_back(unit);
+                    break;
+                }
+                if((unsigned long long) finish_[dependency] > start) {
+                    start = finish_[dependency];
+                    predecessor = dependency;
+                }
+            }
+
+            unsigned long long end = start;
+            unsigned int length = op->length();
+            switch(op->getKind()) {
+                case Operation::MVM: {
+                    MVMOperation* mvm = opcast<MVMOperation>(op);
+                    end = start + Simulator::getMVMCycles(hardware,
+                        Simulator::reusesStack(mvm), mvm->isMVMLast());
+                    LayerEstimate& layer = layers_[getLayer(mvm)];
+                    if(layer.nMVMs == 0 || start < layer.start) {
+                        layer.start = start;
+                    }
+                    layer.end = std::max(layer.end, end);
+                    layer.mvmCycles += end - start;
+                    ++layer.nMVMs;
+                    ++nMVMs_;
+                    nStackReuses_ += Simulator::reusesStack(mvm);
+                    nADCReadouts_ += mvm->isMVMLast();
+                    break;
+                }
+                case Operation::ALU_VECTOR:
+                case Operation::SET_IMMEDIATE:
+                case Operation::COPY:
+                    end = start + Simulator::getALUCycles(hardware, length);
+                    nALUElements_ += length;
+                    break;
+                case Operation::LOAD:
+                case Operation::STORE:
+                case Operation::SEND:
+                case Operation::RECEIVE:
+                    end = start + Simulator::getTransferCycles(length, hardware.maxLoadStoreWidth_)
+                        + hardware.edramLatency_;
+                    nTileMemoryWords_ += length;
+                    break;
+                case Operation::MVM_GUARD:
+                    end = start + hardware.edramLatency_;
+                    break;
+                case Operation::WRITE_INPUT:
+                case Operation::READ_OUTPUT:
+                    break;
+                default:
+                    assert(0 && "Unsupported operation for estimation!");
+            }
+
+            // Sent data arrives after crossing the network
+            unsigned long long finish = end;
+            if(SendOperation* send = opcast<SendOperation>(op)) {
+                bool crossesChip = placer_->getChip(getPTile(unit))
+                    != placer_->getChip(placer_->getPTile(send->getDst()));
+                finish += Simulator::getNetworkCycles(hardware, length, crossesChip);
+                nNetworkWords_ += length;
+                nInterChipWords_ += crossesChip ? length : 0;
+            }
+
+            assert(op->id >= 0 && op->id < (int) nOperations);
+            operations_[op->id] = op;
+            start_[op->id] = start;
+            finish_[op->id] = finish;
+            criticalPredecessor_[op->id] = predecessor;
+            busy_[unit] += end - start;
+            time[unit] = end;
+            previous[unit] = op->id;
+            ++pc[unit];
+            if(end > latency_ || lastOperation_ < 0) {
+                latency_ = end;
+                lastOperation_ = op->id;
+            }
+
+            auto w = waiters.find(op->id);
+            if(w != waiters.end()) {
+                ready.insert(ready.end(), w->second.begin(), w->second.end());
+                waiters.erase(w);
+            }
+
+        }
+    }
+
+    for(unsigned int unit = 0; unit < nUnits_; ++unit) {
+        if(pc[unit] != programs_[unit].size()) {
+            std::cerr << "Estimation deadlock: tile " << getPTile(unit);
+            if(unit < nCores_) {
+                std::cerr << " core " << unit%hardware.nCoresPerTile_;
+            }
+            std::cerr << " is blocked on operation " << programs_[unit][pc[unit]]->id << std::endl;
+            assert(0 && "Estimation deadlock!");
+        }
+    }
+
+}
+
+void Estimator::traceCriticalPath() {
+    // Each operation on the path holds it from its start to the start of the next one
+    unsigned long long time = latency_;
+    for(int id = lastOperation_; id >= 0; id = criticalPredecessor_[id]) {
+        criticalCycles_[getCategory(operations_[id])] += time - start_[id];
+        time = start_[id];
+    }
+}
+
+void Estimator::printReport(std::ostream& report) {
+
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    const unsigned int nCoresPerTile = hardware.nCoresPerTile_;
+    unsigned int bottleneck = 0;
+    for(unsigned int unit = 0; unit < nCores_; ++unit) {
+        if(busy_[unit] > busy_[bottleneck]) {
+            bottleneck = unit;
+        }
+    }
+    report << "# estimated cycles per inference = " << latency_ << std::endl;
+    if(latency_ > 0) {
+        report << "% critical path in compute = " << 100.0*criticalCycles_[COMPUTE]/latency_
+            << "%, tile memory = " << 100.0*criticalCycles_[MEMORY]/latency_
+            << "%, network = " << 100.0*criticalCycles_[NETWORK]/latency_ << "%" << std::endl;
+    }
+    report << "estimated bottleneck core = tile " << bottleneck/nCoresPerTile
+        << " core " << bottleneck%nCoresPerTile << std::endl;
+    report << "# estimated bottleneck core busy cycles = " << busy_[bottleneck] << std::endl;
+    report << "# MVMs = " << nMVMs_ << " (stack reuses = " << nStackReuses_
+        << "), ADC readouts = " << nADCReadouts_
+        << ", ALU elements = " << nALUElements_
+        << ", tile memory words = " << nTileMemoryWords_
+        << ", network words = " << nNetworkWords_;
+    if(hardware.nChips_ > 1) {
+        report << " (inter-chip = " << nInterChipWords_ << ")";
+    }
+    report << std::endl;
+
+    // Energy is only known when the configuration provides it
+    double mvmuEnergy = nMVMs_*hardware.prechargeEnergy_
+        + nStackReuses_*hardware.stackReuseEnergy_
+        + (nMVMs_ - nStackReuses_)*hardware.stackShiftEnergy_
+        + nADCReadouts_*hardware.adcEnergy_;
+    if(mvmuEnergy > 0) {
+        report << "# estimated MVMU energy per inference = " << mvmuEnergy*1e-6 << " uJ" << std::endl;
+    }
+
+    // Layers in the order they start
+    std::vector<LayerEstimate> layers = layers_;
+    std::stable_sort(layers.begin(), layers.end(),
+        [](const LayerEstimate& a, const LayerEstimate& b) { return a.start < b.start; });
+    for(LayerEstimate& layer : layers) {
+        report << "layer " << layer.name << ": MVMs = " << layer.nMVMs
+            << ", MVM cycles = " << layer.mvmCycles
+            << ", active from cycle " << layer.start << " to " << layer.end << std::endl;
+    }
+
+    for(unsigned int unit = 0; unit < nCores_; ++unit) {
+        if(!programs_[unit].empty()) {
+            report << "tile " << unit/nCoresPerTile
+                << " core " << unit%nCoresPerTile
+                << ": estimated busy cycles = " << busy_[unit] << std::endl;
+        }
+    }
+
+}
+
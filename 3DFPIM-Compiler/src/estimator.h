@@ -0,0 +1,81 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+// Static estimate of the inference latency over the linearized programs.
+// Each operation costs what it costs in the simulator, but tile memory
+// accesses never wait for the shared port, so the estimate is the longest
+// path through program order and data dependencies. It is computed in a
+// single pass and needs no event queue.
+class Estimator {
+
+    private:
+
+        enum Category { COMPUTE, MEMORY, NETWORK, N_CATEGORIES };
+
+        struct LayerEstimate {
+            std::string name;
+            unsigned int nMVMs = 0;
+            unsigned long long mvmCycles = 0;
+            unsigned long long start = 0;
+            unsigned long long end = 0;
+        };
+
+        ModelImpl* model_;
+        Placer* placer_;
+
+        unsigned int nCores_;
+        unsigned int nUnits_;
+
+        std::vector<std::vector<Operation*>> programs_;
+        std::vector<unsigned long long> busy_;
+
+        // Indexed by operation id
+        std::vector<Operation*> operations_;
+        std::vector<unsigned long long> start_;
+        std::vector<long long> finish_;
+        std::vector<int> criticalPredecessor_;      /* Operation that decided the start, -1 if none */
+
+        std::vector<LayerEstimate> layers_;
+        std::map<std::string, unsigned int> layerIndices_;
+
+        int lastOperation_ = -1;
+        unsigned long long latency_ = 0;
+        unsigned long long criticalCycles_[N_CATEGORIES] = {};
+
+        // Activity an energy model would weight
+        unsigned long long nMVMs_ = 0;
+        unsigned long long nStackReuses_ = 0;
+        unsigned long long nADCReadouts_ = 0;
+        unsigned long long nALUElements_ = 0;
+        unsigned long long nTileMemoryWords_ = 0;
+        unsigned long long nNetworkWords_ = 0;
+        unsigned long long nInterChipWords_ = 0;
+
+        void estimate();
+        void traceCriticalPath();
+        unsigned int getPTile(unsigned int unit);
+        unsigned int getLayer(MVMOperation* mvm);
+        Category getCategory(Operation* op);
+
+    public:
+
+        Estimator(ModelImpl* model, Placer* placer, Linearizer* linearizer);
+
+        unsigned long long getLatency() { return latency_; }
+
+        void printReport(std::ostream& report);
+
+};
+
@@ -0,0 +1,106 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "3dfpim.h"
+
+static const struct {
+    const char* name;
+    unsigned int HardwareConfig::*field;
+} hardwareParameters[] = {
+    { "MVMU_DIM", &HardwareConfig::mvmuDim_ },
+    { "MVMU_DPT", &HardwareConfig::mvmuDpt_ },
+    { "N_CONSTANT_MVMUS_PER_CORE", &HardwareConfig::nConstantMVMUsPerCore_ },
+    { "N_CORES_PER_TILE", &HardwareConfig::nCoresPerTile_ },
+    { "MAX_LOAD_STORE_WIDTH", &HardwareConfig::maxLoadStoreWidth_ },
+    { "MAX_SEND_RECV_WIDTH", &HardwareConfig::maxSendRecvWidth_ },
+    { "REGISTER_FILE_SIZE", &HardwareConfig::registerFileSize_ },
+    { "STACK_REUSE_LATENCY", &HardwareConfig::stackReuseLatency_ },
+    { "STACK_SHIFT_LATENCY", &HardwareConfig::stackShiftLatency_ },
+    { "PRECHARGE_LATENCY", &HardwareConfig::prechargeLatency_ },
+    { "ADC_LATENCY", &HardwareConfig::adcLatency_ },
+    { "ALU_WIDTH", &HardwareConfig::aluWidth_ },
+    { "ALU_LATENCY", &HardwareConfig::aluLatency_ },
+    { "EDRAM_LATENCY", &HardwareConfig::edramLatency_ },
+    { "NOC_LATENCY", &HardwareConfig::nocLatency_ },
+    { "TILE_MEMORY_SIZE", &HardwareConfig::tileMemorySize_ },
+    { "MESH_WIDTH", &HardwareConfig::meshWidth_ },
+    { "MESH_HEIGHT", &HardwareConfig::meshHeight_ },
+    { "N_CHIPS", &HardwareConfig::nChips_ },
+    { "CHIP_LINK_LATENCY", &HardwareConfig::chipLinkLatency_ },
+    { "CHIP_LINK_WIDTH", &HardwareConfig::chipLinkWidth_ },
+};
+
+static const struct {
+    const char* name;
+    double HardwareConfig::*field;
+} energyParameters[] = {
+    { "STACK_REUSE_ENERGY", &HardwareConfig::stackReuseEnergy_ },
+    { "STACK_SHIFT_ENERGY", &HardwareConfig::stackShiftEnergy_ },
+    { "PRECHARGE_ENERGY", &HardwareConfig::prechargeEnergy_ },
+    { "ADC_ENERGY", &HardwareConfig::adcEnergy_ },
+};
+
+// Values are non-negative numbers of the parameter's type
+template <typename T>
+static bool parseValue(std::string token, T& value) {
+    std::stringstream ss(token);
+    return token[0] != '-' && (ss >> value) && ss.eof();
+}
+
+HardwareConfig HardwareConfig::load(std::string fileName) {
+
+    // Parameters missing from the file keep their default values, and a
+    // repeated parameter takes its last value, so files can be concatenated
+    HardwareConfig config;
+    std::ifstream file(fileName);
+    if(!file.good()) {
+        std::cerr << "Cannot open hardware configuration " << fileName << std::endl;
+        assert(0 && "Cannot open hardware configuration");
+    }
+    std::string line;
+    for(unsigned int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+        std::stringstream ss(line);
+        std::string name, equals, value;
+        if(!(ss >> name)) {
+            continue;
+        }
+        bool valid = (ss >> equals >> value) && equals == "=" && !(ss >> equals);
+        bool known = false;
+        for(auto& parameter : hardwareParameters) {
+            if(valid && name == parameter.name) {
+                known = true;
+                valid = parseValue(value, config.*parameter.field);
+            }
+        }
+        for(auto& parameter : energyParameters) {
+            if(valid && name == parameter.name) {
+                known = true;
+                valid = parseValue(value, config.*parameter.field);
+            }
+        }
+        if(!known || !valid) {
+            std::cerr << fileName << ":" << lineNumber
+                << ": expected \"NAME = value\" with a known parameter name" << std::endl;
+            assert(0 && "Malformed hardware configuration");
+        }
+    }
+
+    assert(config.mvmuDim_ > 0 && config.mvmuDpt_ > 0 && config.nCoresPerTile_ > 0
+        && config.nConstantMVMUsPerCore_ > 0 && config.nMaxTiles() > 2
+        && "Hardware configuration has no room for the network");
+    assert(config.maxLoadStoreWidth_ > 0 && config.maxSendRecvWidth_ > 0
+        && config.chipLinkWidth_ > 0 && "Transfer widths must be positive");
+    return config;
+}
+
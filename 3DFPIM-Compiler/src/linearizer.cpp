@@ -10,6 +10,7 @@
 
 #include "3dfpim.h"
 
+#include "arena.h"
 #include "linearizer.h"
 #include "model.h"
 #include "operations.h"
@@ -27,23 +28,23 @@ Linearizer::Linearizer(ModelImpl* model, Partitioner* partitioner, Placer* place
 
 void Linearizer::linearize() {
     // Begin traversal from operations that output final results, namely matrix update operations and output operations
-    std::set<Operation*> isVisited;
-    std::set<Operation*> wasAddedEarly;
+    OperationSet isVisited(model_->op_count);
+    OperationSet wasAddedEarly(model_->op_count);
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(dynamic_cast<ReadOutputOperation*>(op)) {
+        if(opcast<ReadOutputOperation>(op)) {
             linearizeWithPredecessors(op, isVisited, wasAddedEarly);
         }
     }
 }
 
 void Linearizer::linearizeWithPredecessors
-    (Operation* op, std::set<Operation*>& isVisited, 
-    std::set<Operation*>& wasAddedEarly, 
+    (Operation* op, OperationSet& isVisited, 
+    OperationSet& wasAddedEarly, 
     bool addSelf, bool sliding) {
 
     if(!isVisited.count(op)) {
-        if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(op)) { // MVMOp
+        if(MVMOperation* mvm = opcast<MVMOperation>(op)) { // MVMOp
             assert(addSelf); 
 
             if(sliding == false) {
@@ -65,7 +66,7 @@ void Linearizer::linearizeWithPredecessors
                     for(int op = lastMVM->numOperands() - 1; op >= 0; --op) {
                         ProducerOperation* operand = lastMVM->getOperand(op);
 
-                        if(!dynamic_cast<MVMOperation*>(operand)) {
+                        if(!opcast<MVMOperation>(operand)) {
                             linearizeWithPredecessors(
                                     operand, isVisited, wasAddedEarly, /*addSelf*/true, /*sliding*/false);
                         } else {
@@ -88,7 +89,7 @@ void Linearizer::linearizeWithPredecessors
                 for(int op = mvm->numOperands() - 1; op >= 0; op--) {
                     ProducerOperation* operand = mvm->getOperand(op);
 
-                    if(!dynamic_cast<MVMOperation*>(operand)) {
+                    if(!opcast<MVMOperation>(operand)) {
                         linearizeWithPredecessors(
                                 operand, isVisited, wasAddedEarly, /*addSelf*/true, /*sliding*/false);
                     } else {
@@ -106,16 +107,17 @@ void Linearizer::linearizeWithPredecessors
                     LoadOperation* load = insertMVMGuard(lastMVM);
                     if(load != NULL && !isVisited.count(load)) {
                         assert(load->numOperands() == 1);
-                        SetImmediateOperation* loadset = dynamic_cast<SetImmediateOperation*>(load->getOperand(0));
+                        SetImmediateOperation* loadset = opcast<SetImmediateOperation>(load->getOperand(0));
                         assert(loadset != NULL);
                         unsigned int address = loadset->getImmediate();
 
-                        SetImmediateOperation* seti = new SetImmediateOperation(model_, address);
+                        SetImmediateOperation* seti = new (model_->getArena()) SetImmediateOperation(model_, address);
                         partitioner_->cloneAssignment(load, seti);
                         addToList(seti, isVisited);
 
                         assert(load->numSrcs() == 1);
-                        MVMGuardOperation* guard = new MVMGuardOperation(model_, lastMVM, load->getSrc(0));
+                        MVMGuardOperation* guard = new (model_->getArena()) MVMGuardOperation(model_, lastMVM, load->getSrc(0));
+                        ++numMVMGuards_;
                         partitioner_->cloneAssignment(load, guard);
                         guard->addTileMemoryAddressOperand(seti);
                         addToList(guard, isVisited);
@@ -127,39 +129,39 @@ void Linearizer::linearizeWithPredecessors
             }
         } else { // Non-MVMOp
             if(ConsumerOperation* consumer = 
-                dynamic_cast<ConsumerOperation*>(op)) {
+                opcast<ConsumerOperation>(op)) {
                 
                 // prioritize mvm / alu operation first
                 for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                     ProducerOperation* operand = consumer->getOperand(o);
-                    if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(operand)){
+                    if(MVMOperation* mvm = opcast<MVMOperation>(operand)){
                         linearizeWithPredecessors
                         (mvm, 
                         isVisited, wasAddedEarly);
-                    } else if(dynamic_cast<ALUVectorOperation*>(operand)){
+                    } else if(opcast<ALUVectorOperation>(operand)){
                         linearizeWithPredecessors
                         (operand, 
                         isVisited, wasAddedEarly);
-                        //(addSelf || (dynamic_cast<CopyOperation*>(op) != NULL)));
+                        //(addSelf || (opcast<CopyOperation>(op) != NULL)));
                     }
                 }
                 // then perform non mvm / alu operation
                 for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                     ProducerOperation* operand = consumer->getOperand(o);
-                    if(!dynamic_cast<MVMOperation*>(operand) && !dynamic_cast<ALUVectorOperation*>(operand)){
+                    if(!opcast<MVMOperation>(operand) && !opcast<ALUVectorOperation>(operand)){
                         // if I'm the parent of MVM operation
                         // then, my predecessor should be added along with me!
                         linearizeWithPredecessors
                         (operand, 
                         isVisited, wasAddedEarly);
-                        //(addSelf || (dynamic_cast<CopyOperation*>(op) != NULL)));
+                        //(addSelf || (opcast<CopyOperation>(op) != NULL)));
                     }
                 }
                 // this should be the copy operation
             }
             // starting point
             if(TileMemoryReadOperation* read = 
-                dynamic_cast<TileMemoryReadOperation*>(op)) {
+                opcast<TileMemoryReadOperation>(op)) {
                 
                 for(unsigned int i = 0; i < read->numSrcs(); ++i) {
                     linearizeWithPredecessors
@@ -167,13 +169,13 @@ void Linearizer::linearizeWithPredecessors
                 }
                 assert(!wasAddedEarly.count(read));
             }
-            if(ReceiveOperation* recv = dynamic_cast<ReceiveOperation*>(op)) {
+            if(ReceiveOperation* recv = opcast<ReceiveOperation>(op)) {
                 linearizeWithPredecessors(recv->getSrc(), 
                 isVisited, wasAddedEarly);
                 assert(!wasAddedEarly.count(recv));
             }
             if(addSelf) {
-                ALUVectorOperation* alu = dynamic_cast<ALUVectorOperation*>(op);
+                ALUVectorOperation* alu = opcast<ALUVectorOperation>(op);
                 if(alu != NULL && alu->isResize()) {
                     assert(!wasAddedEarly.count(op));
                 } else {
@@ -200,29 +202,29 @@ LoadOperation* Linearizer::insertMVMGuard(MVMOperation* lastMVM) {
         for(int op = 0; op < mvm->numOperands(); ++op) {
             ProducerOperation* operand = mvm->getOperand(op);
 
-            if(!dynamic_cast<MVMOperation*>(operand)) { // the operand is not an MVMOp
+            if(!opcast<MVMOperation>(operand)) { // the operand is not an MVMOp
                 while(1) {
-                    if(ALUVectorOperation* resize = dynamic_cast<ALUVectorOperation*>(operand)) {
+                    if(ALUVectorOperation* resize = opcast<ALUVectorOperation>(operand)) {
                         ProducerOperation* rProducer = resize->getOperand(1);
 
-                        if(LoadOperation* load = dynamic_cast<LoadOperation*>(rProducer)) {
+                        if(LoadOperation* load = opcast<LoadOperation>(rProducer)) {
                             return load;
-                        } else if(SetImmediateOperation* set = dynamic_cast<SetImmediateOperation*>(rProducer)) {
+                        } else if(SetImmediateOperation* set = opcast<SetImmediateOperation>(rProducer)) {
                             operand = resize->getOperand(0);
                             continue;
-                        } else if(CopyOperation* copy = dynamic_cast<CopyOperation*>(rProducer)) {
-                            LoadOperation* load = dynamic_cast<LoadOperation*>(copy->getOperand(0));
+                        } else if(CopyOperation* copy = opcast<CopyOperation>(rProducer)) {
+                            LoadOperation* load = opcast<LoadOperation>(copy->getOperand(0));
                             assert(load != NULL);
                             return load;
                         } else {
                             assert(0 && "Only Load, Set, Copy can feed Resize");
                         }
-                    } else if(LoadOperation* load = dynamic_cast<LoadOperation*>(operand)) {
+                    } else if(LoadOperation* load = opcast<LoadOperation>(operand)) {
                         return load;
-                    } else if(SetImmediateOperation* set = dynamic_cast<SetImmediateOperation*>(operand)) {
+                    } else if(SetImmediateOperation* set = opcast<SetImmediateOperation>(operand)) {
                         break;
-                    } else if(CopyOperation* copy = dynamic_cast<CopyOperation*>(operand)) {
-                        LoadOperation* load = dynamic_cast<LoadOperation*>(copy->getOperand(0));
+                    } else if(CopyOperation* copy = opcast<CopyOperation>(operand)) {
+                        LoadOperation* load = opcast<LoadOperation>(copy->getOperand(0));
                         assert(load != NULL);
                         return load;
                     } else {
@@ -230,7 +232,7 @@ LoadOperation* Linearizer::insertMVMGuard(MVMOperation* lastMVM) {
                     }
                 }
             } else { 
-                mvm = dynamic_cast<MVMOperation*>(operand);
+                mvm = opcast<MVMOperation>(operand);
                 break;
             }
         }
@@ -239,10 +241,10 @@ LoadOperation* Linearizer::insertMVMGuard(MVMOperation* lastMVM) {
     assert(0);
 }
 
-void Linearizer::addToList (Operation* op, std::set<Operation*>& isVisited) {
+void Linearizer::addToList (Operation* op, OperationSet& isVisited) {
     assert(!isVisited.count(op));
-    if(CoreOperation* coreOp = dynamic_cast<CoreOperation*>(op)) {
-        if(MergedMVMSet* mergedMVM = dynamic_cast<MergedMVMSet*>(coreOp)){
+    if(CoreOperation* coreOp = opcast<CoreOperation>(op)) {
+        if(MergedMVMSet* mergedMVM = opcast<MergedMVMSet>(coreOp)){
             getCoreOperationList
                 (placer_->getPTile(mergedMVM), placer_->getPCore(mergedMVM)).push_back(coreOp);
         } else{
@@ -251,7 +253,7 @@ void Linearizer::addToList (Operation* op, std::set<Operation*>& isVisited) {
         }
         
     }
-    if(TileOperation* tileOp = dynamic_cast<TileOperation*>(op)) {
+    if(TileOperation* tileOp = opcast<TileOperation>(op)) {
         getTileOperationList(placer_->getPTile(tileOp)).push_back(tileOp);
     }
     isVisited.insert(op);
@@ -259,8 +261,8 @@ void Linearizer::addToList (Operation* op, std::set<Operation*>& isVisited) {
 
 void Linearizer::addConsumersToList
     (ProducerOperation* producer, 
-    std::set<Operation*>& isVisited, 
-    std::set<Operation*>& wasAddedEarly) {
+    OperationSet& isVisited, 
+    OperationSet& wasAddedEarly) {
 
     bool allConsumersCanBeAdded = true;
 
@@ -291,10 +293,10 @@ void Linearizer::addConsumersToList
                 wasAddedEarly.insert(consumer);
             }
 
-            if(ProducerOperation* consumerProducer = dynamic_cast<ProducerOperation*>(consumer)) {
+            if(ProducerOperation* consumerProducer = opcast<ProducerOperation>(consumer)) {
                 addConsumersToList(consumerProducer, isVisited, wasAddedEarly);
             } else {
-                StoreOperation* consumerStore = dynamic_cast<StoreOperation*>(consumer);
+                StoreOperation* consumerStore = opcast<StoreOperation>(consumer);
                 assert(consumerStore != NULL);
             }
         } else {
@@ -302,9 +304,10 @@ void Linearizer::addConsumersToList
         }
     }
 
-    if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(producer)) {
+    if(MVMOperation* mvm = opcast<MVMOperation>(producer)) {
         if(!allConsumersCanBeAdded) {
-            CopyOperation* copy = new CopyOperation(model_, producer);
+            CopyOperation* copy = new (model_->getArena()) CopyOperation(model_, producer);
+            ++numCopies_;
             partitioner_->cloneAssignment(producer, copy);
             addToList(copy, isVisited);
             for(auto u = producer->user_begin(); u != producer->user_end(); ) {
@@ -321,45 +324,51 @@ void Linearizer::addConsumersToList
 
 bool Linearizer::addPredecessorsToList
     (Operation* op,
-    std::set<Operation*>& isVisited,
-    std::set<Operation*>& wasAddedEarly) {
+    OperationSet& isVisited,
+    OperationSet& wasAddedEarly) {
 
     assert(!isVisited.count(op));
 
-    if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(op)) {
+    if(MVMOperation* mvm = opcast<MVMOperation>(op)) {
         return false;
-    } else if(SendOperation* send = dynamic_cast<SendOperation*>(op)) {
+    } else if(SendOperation* send = opcast<SendOperation>(op)) {
         for(unsigned int i = 0; i < send->numSrcs(); ++i) {
-            linearizeWithPredecessors(send->getSrc(i), isVisited, wasAddedEarly, /*addSelf*/true, /*sliding*/false);
+            if(!isVisited.count(send->getSrc(i))
+                && !addPredecessorsToList(send->getSrc(i), isVisited, wasAddedEarly)) {
+                return false;
+            }
         }
         addToList(op, isVisited);
         return true;
-    } else if(ReceiveOperation* recv = dynamic_cast<ReceiveOperation*>(op)) {
-        if(!isVisited.count(recv->getSrc())) {
-            bool predecessorAdded = addPredecessorsToList(recv->getSrc(), isVisited, wasAddedEarly);
-            assert(predecessorAdded);
+    } else if(ReceiveOperation* recv = opcast<ReceiveOperation>(op)) {
+        if(!isVisited.count(recv->getSrc())
+            && !addPredecessorsToList(recv->getSrc(), isVisited, wasAddedEarly)) {
+            return false;
         }
         addToList(op, isVisited);
         return true;
-    } else if(StoreOperation* store = dynamic_cast<StoreOperation*>(op)) {
+    } else if(StoreOperation* store = opcast<StoreOperation>(op)) {
         for(unsigned int o = 0; o < store->numOperands(); ++o) {
-            linearizeWithPredecessors(store->getOperand(o), isVisited, wasAddedEarly, /*addSelf*/true, /*sliding*/false);
+            if(!isVisited.count(store->getOperand(o))
+                && !addPredecessorsToList(store->getOperand(o), isVisited, wasAddedEarly)) {
+                return false;
+            }
         }
         if(!wasAddedEarly.count(op)) {
             addToList(op, isVisited);
         }
         return true;
     } else {
-        if(TileMemoryReadOperation* read = dynamic_cast<TileMemoryReadOperation*>(op)) {
+        if(TileMemoryReadOperation* read = opcast<TileMemoryReadOperation>(op)) {
             for(unsigned int i = 0; i < read->numSrcs(); ++i) {
-                if(!isVisited.count(read->getSrc(i))) {
-                    bool predecessorAdded = addPredecessorsToList(read->getSrc(i), isVisited, wasAddedEarly);
-                    assert(predecessorAdded);
+                if(!isVisited.count(read->getSrc(i))
+                    && !addPredecessorsToList(read->getSrc(i), isVisited, wasAddedEarly)) {
+                    return false;
                 }
             }
         }
 
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(op)) {
+        if(ConsumerOperation* consumer = opcast<ConsumerOperation>(op)) {
             bool consumerCanBeAdded = true;
 
             for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
@@ -390,7 +399,7 @@ bool Linearizer::addPredecessorsToList
 std::list<CoreOperation*>& Linearizer::getCoreOperationList
     (unsigned int pTile, unsigned int pCore) {
 
-    return coreOperationLists_[pTile*N_CORES_PER_TILE + pCore];
+    return coreOperationLists_[pTile*model_->getHardwareConfig().nCoresPerTile_ + pCore];
 }
 
 std::list<TileOperation*>& Linearizer::getTileOperationList(unsigned int pTile) {
@@ -23,17 +23,20 @@ class Linearizer {
         std::vector<std::list<CoreOperation*>> coreOperationLists_;
         std::vector<std::list<TileOperation*>> tileOperationLists_;
 
+        unsigned int numMVMGuards_ = 0;
+        unsigned int numCopies_ = 0;
+
         void linearize();
         void linearizeWithPredecessors(Operation* op, 
-            std::set<Operation*>& isVisited, 
-            std::set<Operation*>& wasAddedEarly, 
+            OperationSet& isVisited, 
+            OperationSet& wasAddedEarly, 
             bool addSelf=true, bool sliding=false);
 
-        void addToList(Operation* op, std::set<Operation*>& isVisited);
+        void addToList(Operation* op, OperationSet& isVisited);
         void addConsumersToList(ProducerOperation* producer, 
-            std::set<Operation*>& isVisited, std::set<Operation*>& wasAddedEarly);
+            OperationSet& isVisited, OperationSet& wasAddedEarly);
         bool addPredecessorsToList(Operation* op,
-            std::set<Operation*>& isVisited, std::set<Operation*>& wasAddedEarly);
+            OperationSet& isVisited, OperationSet& wasAddedEarly);
         LoadOperation* insertMVMGuard(MVMOperation* lastMVM);
 
     public:
@@ -43,5 +46,8 @@ class Linearizer {
         std::list<CoreOperation*>& getCoreOperationList(unsigned int pTile, unsigned int pCore);
         std::list<TileOperation*>& getTileOperationList(unsigned int pTile);
 
+        unsigned int getNumMVMGuards() { return numMVMGuards_; }
+        unsigned int getNumCopies() { return numCopies_; }
+
 };
 
@@ -0,0 +1,187 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <assert.h>
+#include <algorithm>
+#include <climits>
+
+#include "3dfpim.h"
+
+#include "loadbalancer.h"
+#include "model.h"
+
+// Tiles 0 and 1 hold the input and output streams
+static const unsigned int N_RESERVED_TILES = 2;
+
+LoadBalancer::LoadBalancer(ModelImpl* model) : model_(model) {
+    for(auto it = model_->layer_begin(); it != model_->layer_end(); ++it) {
+        Layer* layer = *it;
+        layers_.push_back(layer);
+        pixelCycles_.push_back((unsigned long long) layer->load_
+            / (layer->outImageWidth_ * layer->outImageHeight_));
+    }
+}
+
+unsigned int LoadBalancer::getMaxDuplicate(unsigned int outSize) {
+    // Pooled layers are split in pairs of rows and columns, so every
+    // duplicate must get at least two of them
+    return std::max(1u, outSize / 2);
+}
+
+unsigned int LoadBalancer::getMaxDuplicateWidth(unsigned int layer) {
+    Layer* l = layers_[layer];
+    return l->isFC_ ? l->getMaxFCSplit() : getMaxDuplicate(l->outImageWidth_);
+}
+
+unsigned int LoadBalancer::getMaxDuplicateHeight(unsigned int layer) {
+    Layer* l = layers_[layer];
+    return l->isFC_ ? 1 : getMaxDuplicate(l->outImageHeight_);
+}
+
+unsigned long long LoadBalancer::getStageCycles
+    (unsigned int layer, unsigned int duplicateWidth, unsigned int duplicateHeight) {
+
+    // An FC layer spread over more MVMUs shifts fewer stacks per MVMU
+    Layer* l = layers_[layer];
+    if(l->isFC_) {
+        return pixelCycles_[layer]
+            - (unsigned long long) (l->nStack_ - l->getFCDepth(duplicateWidth)) * l->stackLoad_;
+    }
+    unsigned int width = (l->outImageWidth_ - 1) / duplicateWidth + 1;
+    unsigned int height = (l->outImageHeight_ - 1) / duplicateHeight + 1;
+    return pixelCycles_[layer] * width * height;
+}
+
+unsigned long long LoadBalancer::getNMVMUs
+    (unsigned int layer, unsigned int duplicateWidth, unsigned int duplicateHeight) {
+
+    Layer* l = layers_[layer];
+    if(l->isFC_) {
+        return l->getNFCMVMU(duplicateWidth);
+    }
+    return (unsigned long long) duplicateWidth * duplicateHeight * l->getNMVMU();
+}
+
+unsigned long long LoadBalancer::duplicate(unsigned long long bottleneck,
+    std::vector<unsigned int>& duplicateWidth, std::vector<unsigned int>& duplicateHeight) {
+
+    // Each layer independently takes the fewest MVMUs that keep its stage
+    // within the bottleneck, trying every width and the matching height.
+    // FC layers have a single row and try every spread of their stacks.
+    unsigned long long nMVMUs = 0;
+    for(unsigned int l = 0; l < layers_.size(); ++l) {
+        Layer* layer = layers_[l];
+        unsigned int maxHeight = getMaxDuplicateHeight(l);
+        unsigned long long best = ULLONG_MAX;
+        for(unsigned int dw = 1; dw <= getMaxDuplicateWidth(l); ++dw) {
+            unsigned int dh = 1;
+            if(layer->isFC_) {
+                if(getStageCycles(l, dw, dh) > bottleneck) {
+                    continue;
+                }
+            } else {
+                unsigned long long columnCycles = pixelCycles_[l]
+                    * ((layer->outImageWidth_ - 1) / dw + 1);
+                unsigned long long rows = bottleneck / columnCycles;
+                if(rows == 0) {
+                    continue;
+                }
+                dh = (layer->outImageHeight_ - 1) / rows + 1;
+                if(dh > maxHeight) {
+                    continue;
+                }
+            }
+            if(getNMVMUs(l, dw, dh) < best) {
+                best = getNMVMUs(l, dw, dh);
+                duplicateWidth[l] = dw;
+                duplicateHeight[l] = dh;
+            }
+        }
+        if(best == ULLONG_MAX) {
+            return ULLONG_MAX;
+        }
+        nMVMUs += best;
+    }
+    return nMVMUs;
+}
+
+void LoadBalancer::balance() {
+
+    // The bottleneck can only lie between the slowest fully duplicated stage
+    // and the slowest stage without duplication
+    unsigned long long lo = 0, hi = 0;
+    for(unsigned int l = 0; l < layers_.size(); ++l) {
+        lo = std::max(lo, getStageCycles(l, getMaxDuplicateWidth(l), getMaxDuplicateHeight(l)));
+        hi = std::max(hi, getStageCycles(l, 1, 1));
+    }
+
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    const unsigned long long capacity = (unsigned long long)
+        (hardware.nMaxTiles() - N_RESERVED_TILES) * hardware.nCoresPerTile_
+        * hardware.nConstantMVMUsPerCore_;
+    duplicateWidth_.assign(layers_.size(), 1);
+    duplicateHeight_.assign(layers_.size(), 1);
+    if(duplicate(hi, duplicateWidth_, duplicateHeight_) > capacity) {
+        std::cerr << "Load balancing failed: the network needs more than "
+            << hardware.nMaxTiles() - N_RESERVED_TILES
+            << " tiles without duplication" << std::endl;
+        assert(0 && "Load balancing failed");
+    }
+
+    // The MVMUs needed only grow as the bottleneck shrinks
+    std::vector<unsigned int> duplicateWidth(layers_.size());
+    std::vector<unsigned int> duplicateHeight(layers_.size());
+    while(lo < hi) {
+        unsigned long long mid = lo + (hi - lo) / 2;
+        if(duplicate(mid, duplicateWidth, duplicateHeight) <= capacity) {
+            hi = mid;
+            duplicateWidth_ = duplicateWidth;
+            duplicateHeight_ = duplicateHeight;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    for(unsigned int l = 0; l < layers_.size(); ++l) {
+        int valid = layers_[l]->setDuplicate(duplicateWidth_[l], duplicateHeight_[l]);
+        assert(valid && "Duplicate exceeds the output image");
+    }
+}
+
+void LoadBalancer::printReport(std::ostream& out) {
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    unsigned long long bottleneck = 0;
+    unsigned int bottleneckLayer = 0;
+    unsigned long long nMVMUs = 0;
+    for(unsigned int l = 0; l < layers_.size(); ++l) {
+        Layer* layer = layers_[l];
+        unsigned long long cycles =
+            getStageCycles(l, layer->duplicateWidth_, layer->duplicateHeight_);
+        unsigned long long layerMVMUs =
+            getNMVMUs(l, layer->duplicateWidth_, layer->duplicateHeight_);
+        out << "layer " << l << ": " << layer->outImageWidth_ << "x" << layer->outImageHeight_
+            << "x" << layer->nOutChannels_;
+        if(layer->isFC_) {
+            out << " (FC), split = " << layer->duplicateWidth_;
+        } else {
+            out << ", duplicate = " << layer->duplicateWidth_ << "x" << layer->duplicateHeight_;
+        }
+        out << ", MVMUs = " << layerMVMUs << ", stage = " << cycles << " cycles" << std::endl;
+        if(cycles > bottleneck) {
+            bottleneck = cycles;
+            bottleneckLayer = l;
+        }
+        nMVMUs += layerMVMUs;
+    }
+    out << "# MVMUs = " << nMVMUs << " (at least "
+        << (nMVMUs - 1) / (hardware.nCoresPerTile_ * hardware.nConstantMVMUsPerCore_) + 1
+        << " tiles)" << std::endl;
+    out << "# bottleneck = layer " << bottleneckLayer
+        << ", " << bottleneck << " cycles per image" << std::endl;
+}
+
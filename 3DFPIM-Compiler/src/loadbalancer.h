@@ -1,17 +1,45 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
 #include <iostream>
-#include <string>
+#include <vector>
 
 #include "common.h"
 
+// Chooses how many times each layer is duplicated. Layers form a pipeline
+// whose throughput is set by the slowest stage, so the balancer searches for
+// the smallest bottleneck cycle count whose duplicates fit in the tiles.
 class LoadBalancer {
 
     private:
 
         ModelImpl* model_;
+        std::vector<Layer*> layers_;
+        std::vector<unsigned long long> pixelCycles_;   /* Cycles per output pixel */
+        std::vector<unsigned int> duplicateWidth_;
+        std::vector<unsigned int> duplicateHeight_;
+
+        unsigned int getMaxDuplicate(unsigned int outSize);
+        unsigned int getMaxDuplicateWidth(unsigned int layer);
+        unsigned int getMaxDuplicateHeight(unsigned int layer);
+        unsigned long long getStageCycles
+            (unsigned int layer, unsigned int duplicateWidth, unsigned int duplicateHeight);
+        unsigned long long getNMVMUs
+            (unsigned int layer, unsigned int duplicateWidth, unsigned int duplicateHeight);
+        unsigned long long duplicate(unsigned long long bottleneck,
+            std::vector<unsigned int>& duplicateWidth, std::vector<unsigned int>& duplicateHeight);
 
     public:
 
         LoadBalancer(ModelImpl* model);
 
-        void buildNetwork();
+        void balance();
+        void printReport(std::ostream& out);
+
 };
+
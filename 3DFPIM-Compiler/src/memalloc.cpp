@@ -7,46 +7,95 @@
 *******************************************************************************/
 
 #include <assert.h>
+#include <iostream>
+#include <list>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "3dfpim.h"
 
+#include "arena.h"
+#include "linearizer.h"
 #include "memalloc.h"
 #include "model.h"
 #include "operations.h"
 #include "partitioner.h"
+#include "placer.h"
 #include <algorithm>
 
-MemoryAllocator::MemoryAllocator(ModelImpl* model, Partitioner* partitioner)
-    : model_(model), partitioner_(partitioner)
+// Number of dead regions inspected before a write falls back to fresh memory
+static const unsigned int MAX_REUSE_CANDIDATES = 64;
+
+// A region of tile memory holding the data of one write. Accesses are
+// recorded as (unit, position in the unit's program) so that the region can
+// be handed to a later write only once all of them are known to precede it.
+class TileMemoryRegion {
+
+    public:
+
+        unsigned int address;
+        unsigned int size;
+        unsigned int pendingReads;
+        bool isHostBuffer;      /* Accessed by the host before or after the program */
+        std::vector<unsigned int> writeClock;
+        std::vector<std::pair<unsigned int, unsigned int>> lastAccess;
+
+        void access(unsigned int unit, unsigned int position) {
+            for(auto& a : lastAccess) {
+                if(a.first == unit) {
+                    a.second = position;
+                    return;
+                }
+            }
+            lastAccess.push_back(std::make_pair(unit, position));
+        }
+
+        bool precedes(std::vector<unsigned int>& clock) {
+            for(auto& a : lastAccess) {
+                if(a.second > clock[a.first]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+};
+
+// Loads, stores and guards take their tile memory address from a set immediate
+static void setAddressOperand
+    (ConsumerOperation* consumer, unsigned int o, unsigned int address) {
+
+    SetImmediateOperation* seti = opcast<SetImmediateOperation>(consumer->getOperand(o));
+    assert(seti != NULL && "Tile memory address must be set by an immediate!");
+    seti->setImmediate(address);
+}
+
+MemoryAllocator::MemoryAllocator
+    (ModelImpl* model, Partitioner* partitioner, Placer* placer)
+    : model_(model), partitioner_(partitioner), placer_(placer)
 {
-    memoryAllocation();
+    insertAddressOperands();
 }
 
-void MemoryAllocator::memoryAllocation() {
+void MemoryAllocator::insertAddressOperands() {
 
-    // Tile memory allocation
-    vTileAvailableMemory_.resize(partitioner_->getNVTiles());
+    // Addresses are only known once the graph is linearized, so loads and
+    // stores get a placeholder immediate that allocateTileMemory fills in
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(TileMemoryWriteOperation* write = 
-                dynamic_cast<TileMemoryWriteOperation*>(op)) {
-            // FIXME: Receives used by the same read 
-            // output operation on tile 1 
-            // should be assigned the same memory location
-            unsigned int address = 
-                memalloc(partitioner_->getVTile(write), write->length());
-            assignTileMemoryAddress(write, address);
-            if(StoreOperation* store = dynamic_cast<StoreOperation*>(write)) {
-                SetImmediateOperation* seti = new SetImmediateOperation(model_, address);
+        if(TileMemoryWriteOperation* write =
+                opcast<TileMemoryWriteOperation>(op)) {
+            if(StoreOperation* store = opcast<StoreOperation>(write)) {
+                SetImmediateOperation* seti = new (model_->getArena()) SetImmediateOperation(model_, 0);
                 partitioner_->cloneAssignment(store, seti);
                 store->addTileMemoryAddressOperand(seti);
             }
             for(auto u = write->user_begin(); u != write->user_end(); ++u) {
                 TileMemoryReadOperation* read = *u;
-                if(LoadOperation* load = dynamic_cast<LoadOperation*>(read)) {
-                    SetImmediateOperation* seti = 
-                        new SetImmediateOperation(model_, address);
+                if(LoadOperation* load = opcast<LoadOperation>(read)) {
+                    SetImmediateOperation* seti =
+                        new (model_->getArena()) SetImmediateOperation(model_, 0);
                     partitioner_->cloneAssignment(load, seti);
                     load->addTileMemoryAddressOperand(seti);
                 }
@@ -55,36 +104,225 @@ void MemoryAllocator::memoryAllocation() {
     }
 }
 
+void MemoryAllocator::allocateTileMemory(Linearizer* linearizer) {
+
+    // No operations are created from here on, so the table is never resized
+    // while the tiles are allocated concurrently
+    op2mem_.resize(model_->op_count, -1);
+    pTileFootprint_.assign(placer_->getNPTiles(), 0);
+    pTileBumpFootprint_.assign(placer_->getNPTiles(), 0);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(unsigned int pTile = 0; pTile < placer_->getNPTiles(); ++pTile) {
+        allocateTile(linearizer, pTile);
+    }
+}
+
+void MemoryAllocator::allocateTile(Linearizer* linearizer, unsigned int pTile) {
+
+    // The cores of the tile share its memory with the tile control unit
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    const unsigned int nUnits = hardware.nCoresPerTile_ + 1;
+    std::vector<std::vector<Operation*>> programs(nUnits);
+    for(unsigned int pCore = 0; pCore < hardware.nCoresPerTile_; ++pCore) {
+        std::list<CoreOperation*>& coreOperationList =
+            linearizer->getCoreOperationList(pTile, pCore);
+        programs[pCore].assign(coreOperationList.begin(), coreOperationList.end());
+    }
+    std::list<TileOperation*>& tileOperationList = linearizer->getTileOperationList(pTile);
+    programs[hardware.nCoresPerTile_].assign(tileOperationList.begin(), tileOperationList.end());
+
+    // The host writes every input before the program starts and reads every
+    // output after it ends, so their regions stay live for the whole program
+    std::unordered_map<TileMemoryWriteOperation*, unsigned int> pendingReads;
+    std::unordered_set<TileMemoryWriteOperation*> hostBuffers;
+    for(std::vector<Operation*>& program : programs) {
+        for(Operation* op : program) {
+            if(TileMemoryReadOperation* read = opcast<TileMemoryReadOperation>(op)) {
+                for(unsigned int s = 0; s < read->numSrcs(); ++s) {
+                    ++pendingReads[read->getSrc(s)];
+                    if(opcast<ReadOutputOperation>(read)) {
+                        hostBuffers.insert(read->getSrc(s));
+                    }
+                }
+            }
+            if(WriteInputOperation* input = opcast<WriteInputOperation>(op)) {
+                hostBuffers.insert(input);
+            }
+        }
+    }
+
+    // Walk the programs in an order the hardware could execute them, where a
+    // read waits for its write. Each unit keeps a vector clock of how far
+    // every unit of the tile is known to have progressed, so a dead region
+    // is only reused by a write that all of its accesses happen before.
+    // Edges from other tiles are ignored, which can only hide reuse.
+    std::vector<TileMemoryRegion> regions;
+    std::unordered_map<TileMemoryWriteOperation*, unsigned int> write2region;
+    std::list<unsigned int> deadRegions;
+    std::vector<std::vector<unsigned int>> clock(nUnits, std::vector<unsigned int>(nUnits, 0));
+    std::vector<unsigned int> pc(nUnits, 0);
+    unsigned int top = 0;
+    bool progress = true;
+    while(progress) {
+        progress = false;
+        for(unsigned int unit = 0; unit < nUnits; ++unit) {
+            std::vector<unsigned int>& now = clock[unit];
+            for(; pc[unit] < programs[unit].size(); ++pc[unit], progress = true) {
+                Operation* op = programs[unit][pc[unit]];
+                now[unit] = pc[unit] + 1;
+                if(TileMemoryReadOperation* read = opcast<TileMemoryReadOperation>(op)) {
+                    bool ready = true;
+                    for(unsigned int s = 0; s < read->numSrcs(); ++s) {
+                        ready = ready && write2region.count(read->getSrc(s));
+                    }
+                    if(!ready) {
+                        break;
+                    }
+                    for(unsigned int s = 0; s < read->numSrcs(); ++s) {
+                        TileMemoryRegion& region = regions[write2region[read->getSrc(s)]];
+                        for(unsigned int u = 0; u < nUnits; ++u) {
+                            now[u] = std::max(now[u], region.writeClock[u]);
+                        }
+                    }
+                    for(unsigned int s = 0; s < read->numSrcs(); ++s) {
+                        unsigned int r = write2region[read->getSrc(s)];
+                        regions[r].access(unit, now[unit]);
+                        if(--regions[r].pendingReads == 0 && !regions[r].isHostBuffer) {
+                            std::vector<unsigned int>().swap(regions[r].writeClock);
+                            deadRegions.push_back(r);
+                        }
+                    }
+                    if(LoadOperation* load = opcast<LoadOperation>(read)) {
+                        setAddressOperand(load, 0, getTileMemoryAddress(load->getSrc(0)));
+                    } else if(MVMGuardOperation* guard = opcast<MVMGuardOperation>(read)) {
+                        setAddressOperand(guard, 0, getTileMemoryAddress(guard->getSrc(0)));
+                    }
+                } else if(TileMemoryWriteOperation* write = opcast<TileMemoryWriteOperation>(op)) {
+                    // FIXME: Receives used by the same read
+                    // output operation on tile 1
+                    // should be assigned the same memory location
+                    // Host buffers are never recycled, so they are packed
+                    // instead of aligned to the MVMU size
+                    TileMemoryRegion region;
+                    region.isHostBuffer = hostBuffers.count(write);
+                    unsigned int size = region.isHostBuffer ? write->length()
+                        : (int((write->length() - 1) / hardware.mvmuDim_) + 1) * hardware.mvmuDim_;
+                    bool reuse = false;
+                    auto candidate = deadRegions.begin();
+                    // An input is written before any unit runs, so it never
+                    // takes over a region used by the program
+                    for(unsigned int i = 0; i < MAX_REUSE_CANDIDATES && !opcast<WriteInputOperation>(write)
+                            && candidate != deadRegions.end(); ++i) {
+                        TileMemoryRegion& dead = regions[*candidate];
+                        if(dead.size >= size && dead.precedes(now)) {
+                            reuse = true;
+                            break;
+                        }
+                        // Move regions that cannot be reused yet out of the way
+                        auto next = std::next(candidate);
+                        deadRegions.splice(deadRegions.end(), deadRegions, candidate);
+                        candidate = next;
+                    }
+                    if(reuse) {
+                        region.address = regions[*candidate].address;
+                        region.size = regions[*candidate].size;
+                        std::vector<std::pair<unsigned int, unsigned int>>().swap
+                            (regions[*candidate].lastAccess);
+                        deadRegions.erase(candidate);
+                    } else {
+                        region.address = top;
+                        region.size = size;
+                        top += size;
+                        if(top > hardware.tileMemorySize_) {
+                            #pragma omp critical (memalloc)
+                            std::cerr << "Tile memory overflow: tile " << pTile
+                                << " needs more than " << hardware.tileMemorySize_
+                                << " words of tile memory" << std::endl;
+                            assert(0 && "Tile memory capacity exceeded!");
+                        }
+                    }
+                    region.pendingReads = pendingReads[write];
+                    region.access(unit, now[unit]);
+                    assignTileMemoryAddress(write, region.address);
+                    pTileBumpFootprint_[pTile] += size;
+                    if(StoreOperation* store = opcast<StoreOperation>(write)) {
+                        setAddressOperand(store, 1, region.address);
+                    }
+                    write2region[write] = regions.size();
+                    if(region.pendingReads == 0 && !region.isHostBuffer) {
+                        deadRegions.push_back(regions.size());
+                    } else {
+                        region.writeClock = now;
+                    }
+                    regions.push_back(region);
+                }
+            }
+        }
+    }
+    pTileFootprint_[pTile] = top;
+
+    for(unsigned int unit = 0; unit < nUnits; ++unit) {
+        assert(pc[unit] == programs[unit].size()
+            && "Tile memory read of data not written on the same tile!");
+    }
+
+    // Host buffers must not share memory with each other
+    std::vector<std::pair<unsigned int, unsigned int>> hostRegions;
+    for(TileMemoryRegion& region : regions) {
+        if(region.isHostBuffer) {
+            hostRegions.push_back(std::make_pair(region.address, region.size));
+        }
+    }
+    std::sort(hostRegions.begin(), hostRegions.end());
+    for(unsigned int r = 1; r < hostRegions.size(); ++r) {
+        assert(hostRegions[r - 1].first + hostRegions[r - 1].second <= hostRegions[r].first
+            && "Host input and output buffers overlap in tile memory!");
+    }
+}
+
 bool MemoryAllocator::isTileMemoryAddressAssigned(TileMemoryWriteOperation* op) {
-    return op2mem_.count(op);
+    return op->id >= 0 && (unsigned int) op->id < op2mem_.size() && op2mem_[op->id] != -1;
 }
 
 void MemoryAllocator::assignTileMemoryAddress
     (TileMemoryWriteOperation* op, unsigned int address) {
-    
+
     assert(!isTileMemoryAddressAssigned(op) && "Cannot reassign tile memory address");
-    op2mem_[op] = address;
+    assert(op->id >= 0 && (unsigned int) op->id < op2mem_.size()
+        && "Cannot assign tile memory address to an uncommitted operation");
+    op2mem_[op->id] = address;
 }
 
 unsigned int MemoryAllocator::getTileMemoryAddress
     (TileMemoryWriteOperation* op) {
-    
+
     assert(isTileMemoryAddressAssigned(op) && "Tile memory address has not been assigned");
-    return op2mem_[op];
+    return op2mem_[op->id];
+}
+
+unsigned int MemoryAllocator::getPeakTileMemoryFootprint() {
+    unsigned int peak = 0;
+    for(unsigned int pTile = 0; pTile < pTileFootprint_.size(); ++pTile) {
+        peak = std::max(peak, pTileFootprint_[pTile]);
+    }
+    return peak;
 }
 
-unsigned int MemoryAllocator::memalloc
-    (unsigned int vTile, unsigned int size) {
-    
-    unsigned int aligned_size = (int((size - 1) / MVMU_DIM) + 1) * MVMU_DIM;
-    unsigned int address = vTileAvailableMemory_[vTile];
-    vTileAvailableMemory_[vTile] += aligned_size;
-    return address;
+void MemoryAllocator::printReport(std::ostream& report) {
+    report << "# peak tile memory footprint (words) = " << getPeakTileMemoryFootprint() << std::endl;
+    report << "# tile memory capacity (words) = "
+        << model_->getHardwareConfig().tileMemorySize_ << std::endl;
+    for(unsigned int pTile = 0; pTile < pTileFootprint_.size(); ++pTile) {
+        report << "tile " << pTile
+            << ": tile memory footprint = " << pTileFootprint_[pTile]
+            << ", without reuse = " << pTileBumpFootprint_[pTile] << std::endl;
+    }
 }
 
 std::string MemoryAllocator::printAssignment(Operation* op) {
     std::stringstream ss;
-    if(TileMemoryWriteOperation* write = dynamic_cast<TileMemoryWriteOperation*>(op)) {
+    if(TileMemoryWriteOperation* write = opcast<TileMemoryWriteOperation>(op)) {
         if(isTileMemoryAddressAssigned(write)) {
             ss << "\ntileMemoryAddress = " << getTileMemoryAddress(write);
         }
@@ -6,7 +6,8 @@
 * LICENSE file.
 *******************************************************************************/
 
-#include <map>
+#include <fstream>
+#include <vector>
 
 #include "common.h"
 
@@ -16,21 +17,26 @@ class MemoryAllocator {
 
         ModelImpl* model_;
         Partitioner* partitioner_;
+        Placer* placer_;
 
-        std::map<TileMemoryWriteOperation*, unsigned int> op2mem_;
-        std::vector<unsigned int> vTileAvailableMemory_;
+        std::vector<int> op2mem_;       /* Indexed by operation id, -1 if unassigned */
+        std::vector<unsigned int> pTileFootprint_;      /* Peak words in use */
+        std::vector<unsigned int> pTileBumpFootprint_;  /* Words needed without reuse */
 
         bool isTileMemoryAddressAssigned(TileMemoryWriteOperation* op);
-        void memoryAllocation();
+        void assignTileMemoryAddress(TileMemoryWriteOperation* op, unsigned int address);
+        void insertAddressOperands();
+        void allocateTile(Linearizer* linearizer, unsigned int pTile);
 
     public:
 
-        MemoryAllocator(ModelImpl* model, Partitioner* partitioner);
+        MemoryAllocator(ModelImpl* model, Partitioner* partitioner, Placer* placer);
 
-        void assignTileMemoryAddress(TileMemoryWriteOperation* op, unsigned int address);
+        void allocateTileMemory(Linearizer* linearizer);
         unsigned int getTileMemoryAddress(TileMemoryWriteOperation* op);
-        unsigned int memalloc(unsigned int vTile, unsigned int size);
+        unsigned int getPeakTileMemoryFootprint();
 
+        void printReport(std::ostream& report);
         std::string printAssignment(Operation* op);
 
 };
@@ -10,24 +10,29 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include <cmath>
 
 #include "3dfpim.h"
 
+#include "arena.h"
+#include "cache.h"
 #include "coalescer.h"
 #include "codegen.h"
+#include "estimator.h"
 #include "linearizer.h"
+#include "loadbalancer.h"
 #include "memalloc.h"
 #include "model.h"
 #include "operations.h"
 #include "partitioner.h"
 #include "placer.h"
 #include "regalloc.h"
+#include "simulator.h"
+#include "stats.h"
 #include "tensors.h"
 
-Model Model::create(std::string name) {
+Model Model::create(std::string name, HardwareConfig hardware) {
     Model model;
-    model.impl_ = new ModelImpl(name);
+    model.impl_ = new ModelImpl(name, hardware);
     return model;
 }
 
@@ -47,12 +52,12 @@ void Model::compile(CompilerOptions options) {
     impl_->compile(options);
 }
 
-ModelImpl::ModelImpl(std::string name)
-    : name_(name), modelType_(UNSPECIALIZED), 
+ModelImpl::ModelImpl(std::string name, HardwareConfig& hardware)
+    : name_(name), modelType_(UNSPECIALIZED), hardware_(hardware), arena_(new Arena()), 
     partitioner_(NULL), placer_(NULL), 
     memoryAllocator_(NULL), coalescer_(NULL), 
     linearizer_(NULL), registerAllocator_(NULL), 
-    codeGenerator_(NULL), op_count(0)
+    codeGenerator_(NULL), estimator_(NULL), simulator_(NULL), op_count(0)
 {
 }
 
@@ -78,6 +83,12 @@ ModelImpl::~ModelImpl() {
     if(codeGenerator_ != NULL) {
         delete codeGenerator_;
     }
+    if(estimator_ != NULL) {
+        delete estimator_;
+    }
+    if(simulator_ != NULL) {
+        delete simulator_;
+    }
     for(InputVectorImpl* vec : inputVectors_) {
         delete vec;
     }
@@ -106,11 +117,13 @@ ModelImpl::~ModelImpl() {
         delete matrix;
     }
     for(Operation* op : operations_) {
-        delete op;
+        op->~Operation();
     }
     for(auto coalesceableMVMVector : coalesceableMVMVectors_) {
         delete coalesceableMVMVector;
     }
+    // Operations, tiles and sliding sets are released together
+    delete arena_;
 }
 
 void ModelImpl::addLayer(Layer* layer) {
@@ -168,17 +181,36 @@ void ModelImpl::addFCConstantMatrixImpl(FCConstantMatrixImpl* mat) {
     fcMatrices_.push_back(mat);
 }
 
+// Operations created by the calling thread while deferred are only
+// registered (and given ids) when committed
+static thread_local std::vector<Operation*>* deferredOperations = NULL;
+
 int ModelImpl::addOperation(Operation* op) {
+    if(deferredOperations != NULL) {
+        deferredOperations->push_back(op);
+        return -1;
+    }
     operations_.push_back(op);
     return op_count++;
 }
 
+void ModelImpl::deferOperations(std::vector<Operation*>* pending) {
+    deferredOperations = pending;
+}
+
+void ModelImpl::commitOperations(std::vector<Operation*>& pending) {
+    for(Operation* op : pending) {
+        op->id = addOperation(op);
+    }
+    pending.clear();
+}
+
 void ModelImpl::addCoalesceableMVMVector(std::vector<MergedMVMSet*>* coalesceableMVMVector) {
     coalesceableMVMVectors_.push_back(coalesceableMVMVector);
 }
 
 void ModelImpl::unlink(std::list<Operation*>::iterator it) {
-    delete *it;
+    (*it)->~Operation();
     operations_.erase(it);
 }
 
@@ -222,64 +254,47 @@ std::string ModelImpl::printAssignment(Operation* op) {
     return ss.str();
 }
 
-void ModelImpl::loadBalance() 
-{
-    bool load_balanced = false;
-
-    for (auto r_it = layer_rbegin(); r_it != layer_rend(); ++r_it) {
-        Layer* r_layer = *r_it;
-
-        unsigned int scale_load = r_layer->load_;
-        unsigned int total_mvmu_num = 0;
-        bool all_layer_scaled = true;
-
-        for (auto it = layer_begin(); it != layer_end(); ++it) {
-            Layer* layer = *it;
-
-            unsigned int duplicateWidth;
-            unsigned int duplicateHeight;
-
-            if (layer->isFC_) {
-                duplicateWidth = 1;
-                duplicateHeight = 1;
-            }
-            else {
-                duplicateWidth = ceil(sqrt((double)layer->load_ / scale_load));
-                duplicateHeight = ceil(sqrt((double)layer->load_ / scale_load));
-            }
-
-            if (!layer->setDuplicate(duplicateWidth, duplicateHeight)) {
-                all_layer_scaled = false;
-                break;
-            }
-
-            total_mvmu_num += duplicateWidth * duplicateHeight * layer->getNMVMU();
-        }
+void ModelImpl::loadBalance() {
+    std::cout << "Load balancing... " << std::flush;
+    LoadBalancer loadBalancer(this);
+    loadBalancer.balance();
+    std::cout << "done." << std::endl;
+    loadBalancer.printReport(std::cout);
+}
 
-        unsigned int total_tile_num = (total_mvmu_num - 1)
-                                        / N_CONSTANT_MVMUS_PER_CORE
-                                        / N_CORES_PER_TILE;
+void ModelImpl::compile(CompilerOptions& options) {
 
-        if (all_layer_scaled && total_tile_num <= N_MAX_TILE) {
-            load_balanced = true;
-            break;
+    CompilerStats stats(this);
+
+    // Compilation cache
+    CompilationCache cache(this, options);
+    if(cache.isEnabled()) {
+        std::cout << "Cache lookup... " << std::flush;
+        stats.beginPass("cache lookup");
+        bool hit = cache.lookup();
+        stats.endPass();
+        stats.addCounter("hit", hit);
+        std::cout << (hit ? "hit." : "miss.") << std::endl;
+        if(hit) {
+            compileFromCache(options, cache, stats);
+            return;
         }
     }
 
-    if (!load_balanced) {
-        assert(false && "Load balancing failed");
-    }
-}
-
-void ModelImpl::compile(CompilerOptions& options) {
-
     if(options.printDebugInfo_) {
         printGraph(name_ + "-graph0.dot");
     }
 
     // Model partitioning
     std::cout << "Partitioning graph... " << std::flush;
+    stats.beginPass("partitioning");
     partitioner_ = new Partitioner(this, options.gp_);
+    stats.endPass();
+    stats.addCounter("copies_inserted", partitioner_->getNumCopies());
+    stats.addCounter("load_bytes", partitioner_->getNumLoads());
+    stats.addCounter("store_bytes", partitioner_->getNumStores());
+    stats.addCounter("send_bytes", partitioner_->getNumSends());
+    stats.addCounter("receive_bytes", partitioner_->getNumReceives());
     std::cout << "done." << std::endl;
     if(options.printDebugInfo_) {
         printGraph(name_ + "-graph1-partitioned.dot");
@@ -287,7 +302,9 @@ void ModelImpl::compile(CompilerOptions& options) {
 
     // Physical layout
     std::cout << "Physical layout... " << std::flush;
+    stats.beginPass("physical layout");
     placer_ = new Placer(this, partitioner_);
+    stats.endPass();
     std::cout << "done." << std::endl;
     if(options.printDebugInfo_) {
         printGraph(name_ + "-graph2-virtual-to-physical.dot");
@@ -295,7 +312,9 @@ void ModelImpl::compile(CompilerOptions& options) {
 
     // Memory allocation
     std::cout << "Memory allocation... " << std::flush;
-    memoryAllocator_ = new MemoryAllocator(this, partitioner_);
+    stats.beginPass("memory allocation");
+    memoryAllocator_ = new MemoryAllocator(this, partitioner_, placer_);
+    stats.endPass();
     std::cout << "done." << std::endl;
     if(options.printDebugInfo_) {
         printGraph(name_ + "-graph3-memory-allocation.dot");
@@ -304,13 +323,20 @@ void ModelImpl::compile(CompilerOptions& options) {
     // Coalescing
     if(options.coalesceMVMOperations_) {
         std::cout << "MVM coalescing... " << std::flush;
+        stats.beginPass("MVM coalescing");
         coalescer_ = new Coalescer(this, placer_, coalesceableMVMVectors_);
+        stats.endPass();
+        stats.addCounter("coalesced_sets_formed", coalescer_->getNumCoalescedSets());
         std::cout << "done." << std::endl;
     }
 
     // Linearization
     std::cout << "Linearizing graph... " << std::flush;
+    stats.beginPass("linearization");
     linearizer_ = new Linearizer(this, partitioner_, placer_);
+    stats.endPass();
+    stats.addCounter("mvm_guards_inserted", linearizer_->getNumMVMGuards());
+    stats.addCounter("copies_inserted", linearizer_->getNumCopies());
     std::cout << "done." << std::endl;
     if(options.printDebugInfo_) {
         printGraph(name_ + "-graph4-linearization.dot");
@@ -318,25 +344,110 @@ void ModelImpl::compile(CompilerOptions& options) {
 
     // Register allocation
     std::cout << "Register allocation... " << std::flush;
+    stats.beginPass("register allocation");
     registerAllocator_ = new RegisterAllocator
-        (this, partitioner_, placer_, memoryAllocator_, linearizer_);
+        (this, partitioner_, placer_, linearizer_);
+    stats.endPass();
+    stats.addCounter("spill_load_bytes", registerAllocator_->getNumLoadsFromSpilling());
+    stats.addCounter("spill_store_bytes", registerAllocator_->getNumStoresFromSpilling());
+    stats.addCounter("spilled_register_accesses", registerAllocator_->getNumSpilledRegAccesses());
+    stats.addCounter("spills_avoided", registerAllocator_->getNumSpillsAvoided());
     std::cout << "done." << std::endl;
     if(options.printDebugInfo_) {
         printGraph(name_ + "-graph5-register-allocation.dot");
     }
 
+    // Tile memory allocation
+    std::cout << "Tile memory allocation... " << std::flush;
+    stats.beginPass("tile memory allocation");
+    memoryAllocator_->allocateTileMemory(linearizer_);
+    stats.endPass();
+    stats.addCounter("peak_tile_memory_footprint", memoryAllocator_->getPeakTileMemoryFootprint());
+    std::cout << "done." << std::endl;
+
     // Code generation
     std::cout << "Code generation... " << std::flush;
+    stats.beginPass("code generation");
     codeGenerator_ = new CodeGenerator
         (this, placer_, memoryAllocator_, coalescer_, 
-        linearizer_, registerAllocator_);
+        linearizer_, registerAllocator_, options.codeFormat_,
+        cache.isEnabled() ? cache.getContainerFileName() : "");
+    stats.endPass();
+    std::cout << "done." << std::endl;
+
+    // Static estimation
+    std::cout << "Static estimation... " << std::flush;
+    stats.beginPass("static estimation");
+    estimator_ = new Estimator(this, placer_, linearizer_);
+    stats.endPass();
+    stats.addCounter("estimated_latency", estimator_->getLatency());
     std::cout << "done." << std::endl;
 
+    // Simulation
+    if(options.simulate_) {
+        std::cout << "Simulation... " << std::flush;
+        stats.beginPass("simulation");
+        simulator_ = new Simulator(this, placer_, linearizer_);
+        stats.endPass();
+        stats.addCounter("latency", simulator_->getLatency());
+        std::cout << "done." << std::endl;
+    }
+
     // Report
+    std::stringstream compileReport;
+    partitioner_->printReport(compileReport);
+    placer_->printReport(compileReport);
+    registerAllocator_->printReport(compileReport);
+    memoryAllocator_->printReport(compileReport);
+    if(cache.isEnabled()) {
+        if(simulator_ != NULL) {
+            simulator_->writePrograms(cache.getProgramsFileName());
+        }
+        cache.storeReport(compileReport.str());
+    }
+    writeReports(compileReport.str(), stats);
+
+}
+
+void ModelImpl::compileFromCache(CompilerOptions& options, CompilationCache& cache, CompilerStats& stats) {
+
+    // Code restoration
+    std::cout << "Code restoration... " << std::flush;
+    stats.beginPass("code restoration");
+    cache.restoreCode();
+    stats.endPass();
+    std::cout << "done." << std::endl;
+
+    // Simulation
+    if(options.simulate_) {
+        std::cout << "Simulation... " << std::flush;
+        stats.beginPass("simulation");
+        simulator_ = new Simulator(this, cache.getProgramsFileName());
+        stats.endPass();
+        stats.addCounter("latency", simulator_->getLatency());
+        std::cout << "done." << std::endl;
+    }
+
+    writeReports(cache.loadReport(), stats);
+
+}
+
+void ModelImpl::writeReports(std::string compileReport, CompilerStats& stats) {
+
     std::ofstream report(name_ + "-report.out");
-    partitioner_->printReport(report);
-    registerAllocator_->printReport(report);
+    report << compileReport;
+    if(estimator_ != NULL) {
+        estimator_->printReport(report);
+    }
+    if(simulator_ != NULL) {
+        simulator_->printReport(report);
+    }
     report.close();
 
+    // Per-pass statistics
+    std::ofstream statsFile(name_ + "-stats.json");
+    stats.printJSON(statsFile);
+    statsFile.close();
+
 }
 
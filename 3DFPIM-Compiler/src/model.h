@@ -25,6 +25,7 @@ class ModelImpl {
 
         std::string name_;
         ModelType modelType_;
+        HardwareConfig hardware_;
 
         std::list<Layer*> layers_;
         std::vector<InputVectorImpl*> inputVectors_;
@@ -38,6 +39,7 @@ class ModelImpl {
         std::vector<FCConstantMatrixImpl*> fcMatrices_;
         std::list<Operation*> operations_;
         std::vector<std::vector<MergedMVMSet*>*> coalesceableMVMVectors_;
+        Arena* arena_;
 
         Partitioner* partitioner_;
         Placer* placer_;
@@ -46,6 +48,11 @@ class ModelImpl {
         Linearizer* linearizer_;
         RegisterAllocator* registerAllocator_;
         CodeGenerator* codeGenerator_;
+        Estimator* estimator_;
+        Simulator* simulator_;
+
+        void compileFromCache(CompilerOptions& options, CompilationCache& cache, CompilerStats& stats);
+        void writeReports(std::string compileReport, CompilerStats& stats);
 
         // Debug information
         void printGraph(std::string fileName);
@@ -53,7 +60,7 @@ class ModelImpl {
     public:
 
         int op_count;
-        ModelImpl(std::string name);
+        ModelImpl(std::string name, HardwareConfig& hardware);
         ~ModelImpl();
 
         void addLayer(Layer* layer);
@@ -67,6 +74,8 @@ class ModelImpl {
         void addConvolutionalConstantMatrixImpl(ConvolutionalConstantMatrixImpl* mat);
         void addFCConstantMatrixImpl(FCConstantMatrixImpl* mat);
         int addOperation(Operation* op);
+        void deferOperations(std::vector<Operation*>* pending);
+        void commitOperations(std::vector<Operation*>& pending);
         void addCoalesceableMVMVector(std::vector<MergedMVMSet*>* coalesceableMVMVector);
 
         void unlink(std::list<Operation*>::iterator it);
@@ -76,6 +85,9 @@ class ModelImpl {
 
         std::string getName() { return name_; }
         ModelType getModelType() { return modelType_; }
+        Arena& getArena() { return *arena_; }
+        unsigned int getNOperations() { return operations_.size(); }
+        const HardwareConfig& getHardwareConfig() { return hardware_; }
 
         // Iterators
         std::list<Layer*>::iterator layer_begin() { return layers_.begin(); }
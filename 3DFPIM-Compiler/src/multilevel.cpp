@@ -0,0 +1,449 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <algorithm>
+#include <assert.h>
+#include <set>
+
+#include "3dfpim.h"
+
+#include "multilevel.h"
+
+// Coarsening stops at this many nodes per part, or once a level merges
+// too few nodes to be worth another level
+static const unsigned int COARSEST_NODES_PER_PART = 2;
+static const double MIN_COARSENING_RATIO = 0.95;
+
+// Refinement passes per level, and the moves a pass makes past its best cut
+static const unsigned int MAX_REFINEMENT_PASSES = 8;
+static const unsigned int MAX_FRUITLESS_MOVES = 64;
+
+// Attempts at partitioning the coarsest graph, each seeded differently
+static const unsigned int INITIAL_PARTITION_TRIALS = 4;
+
+static const unsigned int NONE = (unsigned int) -1;
+
+MultilevelPartitioner::MultilevelPartitioner(unsigned int nNodes, unsigned int capacity)
+    : nNodes_(nNodes), capacity_(capacity), edges_(nNodes)
+{
+    assert(capacity > 0 && "Partition capacity must be positive!");
+    nParts_ = (nNodes == 0) ? 0 : (nNodes - 1)/capacity + 1;
+}
+
+void MultilevelPartitioner::addEdge(unsigned int u, unsigned int v, unsigned int weight) {
+    assert(u < nNodes_ && v < nNodes_);
+    if(u != v) {
+        edges_[u][v] += weight;
+        edges_[v][u] += weight;
+    }
+}
+
+void MultilevelPartitioner::connectivity(Graph& graph, std::vector<unsigned int>& part,
+    unsigned int v, std::vector<std::pair<unsigned int, long long>>& conn) {
+
+    conn.clear();
+    conn.push_back(std::make_pair(part[v], 0));
+    for(unsigned int e = graph.xadj[v]; e < graph.xadj[v + 1]; ++e) {
+        unsigned int p = part[graph.adjncy[e]];
+        unsigned int i = 0;
+        while(i < conn.size() && conn[i].first != p) {
+            ++i;
+        }
+        if(i == conn.size()) {
+            conn.push_back(std::make_pair(p, 0));
+        }
+        conn[i].second += graph.adjwgt[e];
+    }
+}
+
+long long MultilevelPartitioner::cut(Graph& graph, std::vector<unsigned int>& part) {
+    long long cut = 0;
+    for(unsigned int v = 0; v < graph.nNodes(); ++v) {
+        for(unsigned int e = graph.xadj[v]; e < graph.xadj[v + 1]; ++e) {
+            if(part[graph.adjncy[e]] != part[v]) {
+                cut += graph.adjwgt[e];
+            }
+        }
+    }
+    return cut/2;
+}
+
+void MultilevelPartitioner::partition(std::vector<unsigned int>& result) {
+
+    result.assign(nNodes_, 0);
+    if(capacity_ == 1) {
+        // Every node is a part of its own
+        for(unsigned int v = 0; v < nNodes_; ++v) {
+            result[v] = v;
+        }
+        return;
+    }
+    if(nParts_ <= 1) {
+        return;
+    }
+
+    std::vector<Graph> levels(1);
+    Graph& graph = levels[0];
+    graph.xadj.push_back(0);
+    for(unsigned int v = 0; v < nNodes_; ++v) {
+        for(auto& edge : edges_[v]) {
+            graph.adjncy.push_back(edge.first);
+            graph.adjwgt.push_back(edge.second);
+        }
+        graph.xadj.push_back(graph.adjncy.size());
+        graph.vwgt.push_back(1);
+    }
+
+    // Coarsening
+    while(levels.back().nNodes() > COARSEST_NODES_PER_PART*nParts_) {
+        Graph coarse;
+        if(!coarsen(levels.back(), coarse)) {
+            break;
+        }
+        levels.push_back(std::move(coarse));
+    }
+
+    // Initial partitioning, keeping the best of differently seeded attempts
+    Graph& coarsest = levels.back();
+    std::vector<unsigned int> part;
+    long long bestCut = -1;
+    for(unsigned int trial = 0; trial < INITIAL_PARTITION_TRIALS; ++trial) {
+        std::vector<unsigned int> candidate;
+        initialPartition(coarsest, candidate, trial*coarsest.nNodes()/INITIAL_PARTITION_TRIALS);
+        rebalance(coarsest, candidate);
+        refine(coarsest, candidate);
+        long long candidateCut = cut(coarsest, candidate);
+        if(bestCut < 0 || candidateCut < bestCut) {
+            bestCut = candidateCut;
+            part.swap(candidate);
+        }
+    }
+
+    // Uncoarsening
+    for(unsigned int l = levels.size() - 1; l > 0; --l) {
+        std::vector<unsigned int> finer(levels[l - 1].nNodes());
+        for(unsigned int v = 0; v < finer.size(); ++v) {
+            finer[v] = part[levels[l - 1].cmap[v]];
+        }
+        part.swap(finer);
+        rebalance(levels[l - 1], part);
+        refine(levels[l - 1], part);
+    }
+
+    // Callers number nodes in model order, which partitions well on its own
+    // for chains of layers, so it competes with the multilevel result
+    std::vector<unsigned int> inOrder(nNodes_);
+    for(unsigned int v = 0; v < nNodes_; ++v) {
+        inOrder[v] = v/capacity_;
+    }
+    refine(levels[0], inOrder);
+    if(cut(levels[0], inOrder) < cut(levels[0], part)) {
+        part.swap(inOrder);
+    }
+    result.swap(part);
+
+}
+
+bool MultilevelPartitioner::coarsen(Graph& fine, Graph& coarse) {
+
+    // Heavy edge matching; light nodes go first so that they find a partner
+    // before their neighbors grow too heavy to merge with
+    unsigned int n = fine.nNodes();
+    std::vector<unsigned int> order(n);
+    for(unsigned int v = 0; v < n; ++v) {
+        order[v] = v;
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&](unsigned int a, unsigned int b) { return fine.vwgt[a] < fine.vwgt[b]; });
+
+    std::vector<unsigned int> match(n, NONE);
+    std::vector<std::pair<unsigned int, unsigned int>> members;
+    fine.cmap.assign(n, NONE);
+    for(unsigned int v : order) {
+        if(match[v] != NONE) {
+            continue;
+        }
+        unsigned int partner = v;
+        unsigned int heaviest = 0;
+        for(unsigned int e = fine.xadj[v]; e < fine.xadj[v + 1]; ++e) {
+            unsigned int u = fine.adjncy[e];
+            if(match[u] == NONE && fine.adjwgt[e] > heaviest
+                    && fine.vwgt[u] + fine.vwgt[v] <= capacity_) {
+                partner = u;
+                heaviest = fine.adjwgt[e];
+            }
+        }
+        match[v] = partner;
+        match[partner] = v;
+        fine.cmap[v] = fine.cmap[partner] = members.size();
+        members.push_back(std::make_pair(v, partner));
+    }
+    if(members.size() > MIN_COARSENING_RATIO*n) {
+        return false;
+    }
+
+    // Contract matched nodes, merging the edges they share a neighbor through
+    unsigned int nCoarse = members.size();
+    std::vector<unsigned int> slot(nCoarse, NONE);
+    coarse.xadj.push_back(0);
+    for(unsigned int c = 0; c < nCoarse; ++c) {
+        unsigned int start = coarse.adjncy.size();
+        unsigned int vwgt = 0;
+        unsigned int m[2] = { members[c].first, members[c].second };
+        for(unsigned int i = 0; i < (m[0] == m[1] ? 1 : 2); ++i) {
+            vwgt += fine.vwgt[m[i]];
+            for(unsigned int e = fine.xadj[m[i]]; e < fine.xadj[m[i] + 1]; ++e) {
+                unsigned int u = fine.cmap[fine.adjncy[e]];
+                if(u == c) {
+                    continue;
+                }
+                if(slot[u] == NONE) {
+                    slot[u] = coarse.adjncy.size();
+                    coarse.adjncy.push_back(u);
+                    coarse.adjwgt.push_back(0);
+                }
+                coarse.adjwgt[slot[u]] += fine.adjwgt[e];
+            }
+        }
+        for(unsigned int e = start; e < coarse.adjncy.size(); ++e) {
+            slot[coarse.adjncy[e]] = NONE;
+        }
+        coarse.xadj.push_back(coarse.adjncy.size());
+        coarse.vwgt.push_back(vwgt);
+    }
+    return true;
+
+}
+
+void MultilevelPartitioner::initialPartition
+    (Graph& graph, std::vector<unsigned int>& part, unsigned int first) {
+
+    // Heavy nodes are the hardest to fit, so they seed the parts; among
+    // nodes of equal weight, seeding starts from `first`
+    unsigned int n = graph.nNodes();
+    std::vector<unsigned int> order(n);
+    for(unsigned int v = 0; v < n; ++v) {
+        order[v] = (first + v)%n;
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&](unsigned int a, unsigned int b) { return graph.vwgt[a] > graph.vwgt[b]; });
+
+    // Grow one part at a time along its heaviest connection that still fits
+    part.assign(n, NONE);
+    std::vector<unsigned int> weight(nParts_, 0);
+    std::vector<long long> conn(n, 0);
+    unsigned int cursor = 0;
+    for(unsigned int p = 0; p < nParts_; ++p) {
+        std::vector<unsigned int> frontier;
+        while(weight[p] < capacity_) {
+            unsigned int next = NONE;
+            for(unsigned int u : frontier) {
+                if(part[u] == NONE && weight[p] + graph.vwgt[u] <= capacity_
+                        && (next == NONE || conn[u] > conn[next])) {
+                    next = u;
+                }
+            }
+            if(next == NONE) {
+                while(cursor < n && part[order[cursor]] != NONE) {
+                    ++cursor;
+                }
+                for(unsigned int i = cursor; i < n; ++i) {
+                    unsigned int u = order[i];
+                    if(part[u] == NONE && weight[p] + graph.vwgt[u] <= capacity_) {
+                        next = u;
+                        break;
+                    }
+                }
+            }
+            if(next == NONE) {
+                break;
+            }
+            part[next] = p;
+            weight[p] += graph.vwgt[next];
+            for(unsigned int e = graph.xadj[next]; e < graph.xadj[next + 1]; ++e) {
+                unsigned int u = graph.adjncy[e];
+                if(part[u] == NONE) {
+                    if(conn[u] == 0) {
+                        frontier.push_back(u);
+                    }
+                    conn[u] += graph.adjwgt[e];
+                }
+            }
+        }
+        for(unsigned int u : frontier) {
+            conn[u] = 0;
+        }
+    }
+
+    // Nodes too heavy to pack are left to rebalancing on finer levels
+    for(unsigned int v = 0; v < n; ++v) {
+        if(part[v] == NONE) {
+            unsigned int p = std::min_element(weight.begin(), weight.end()) - weight.begin();
+            part[v] = p;
+            weight[p] += graph.vwgt[v];
+        }
+    }
+
+}
+
+void MultilevelPartitioner::rebalance(Graph& graph, std::vector<unsigned int>& part) {
+
+    unsigned int n = graph.nNodes();
+    std::vector<unsigned int> weight(nParts_, 0);
+    for(unsigned int v = 0; v < n; ++v) {
+        weight[part[v]] += graph.vwgt[v];
+    }
+
+    // Move the node whose departure costs the least out of each overweight
+    // part, preferring parts it is connected to
+    std::vector<std::pair<unsigned int, long long>> conn;
+    for(unsigned int p = 0; p < nParts_; ++p) {
+        while(weight[p] > capacity_) {
+            unsigned int lightest = std::min_element(weight.begin(), weight.end()) - weight.begin();
+            unsigned int bestNode = NONE;
+            unsigned int bestPart = NONE;
+            long long bestGain = 0;
+            for(unsigned int v = 0; v < n; ++v) {
+                if(part[v] != p) {
+                    continue;
+                }
+                connectivity(graph, part, v, conn);
+                conn.push_back(std::make_pair(lightest, 0));
+                for(unsigned int i = 1; i < conn.size(); ++i) {
+                    unsigned int q = conn[i].first;
+                    long long gain = conn[i].second - conn[0].second;
+                    if(q != p && weight[q] + graph.vwgt[v] <= capacity_
+                            && (bestNode == NONE || gain > bestGain)) {
+                        bestNode = v;
+                        bestPart = q;
+                        bestGain = gain;
+                    }
+                }
+            }
+            if(bestNode == NONE) {
+                // Nothing fits at this level; a finer level splits the nodes
+                return;
+            }
+            part[bestNode] = bestPart;
+            weight[p] -= graph.vwgt[bestNode];
+            weight[bestPart] += graph.vwgt[bestNode];
+        }
+    }
+
+}
+
+void MultilevelPartitioner::refine(Graph& graph, std::vector<unsigned int>& part) {
+
+    unsigned int n = graph.nNodes();
+    std::vector<unsigned int> weight(nParts_, 0);
+    unsigned int maxVwgt = 0;
+    for(unsigned int v = 0; v < n; ++v) {
+        weight[part[v]] += graph.vwgt[v];
+        maxVwgt = std::max(maxVwgt, graph.vwgt[v]);
+    }
+    unsigned int nOverweight = 0;
+    for(unsigned int p = 0; p < nParts_; ++p) {
+        nOverweight += (weight[p] > capacity_);
+    }
+    if(nOverweight > 0) {
+        return;
+    }
+
+    // Moves may overfill a part by one node so that nodes can trade places,
+    // but only balanced states are kept
+    std::vector<std::pair<unsigned int, long long>> conn;
+    std::vector<long long> gain(n);
+    std::vector<bool> queued(n);
+    std::vector<bool> locked(n);
+    long long currentCut = cut(graph, part);
+    for(unsigned int pass = 0; pass < MAX_REFINEMENT_PASSES; ++pass) {
+
+        std::set<std::pair<long long, unsigned int>> queue;    /* (-gain, node) */
+        auto update = [&](unsigned int v) {
+            if(queued[v]) {
+                queue.erase(std::make_pair(-gain[v], v));
+                queued[v] = false;
+            }
+            connectivity(graph, part, v, conn);
+            if(locked[v] || conn.size() == 1) {
+                return;
+            }
+            long long best = conn[1].second;
+            for(unsigned int i = 2; i < conn.size(); ++i) {
+                best = std::max(best, conn[i].second);
+            }
+            gain[v] = best - conn[0].second;
+            queue.insert(std::make_pair(-gain[v], v));
+            queued[v] = true;
+        };
+        std::fill(queued.begin(), queued.end(), false);
+        std::fill(locked.begin(), locked.end(), false);
+        for(unsigned int v = 0; v < n; ++v) {
+            update(v);
+        }
+
+        long long startCut = currentCut;
+        long long bestCut = currentCut;
+        std::vector<std::pair<unsigned int, unsigned int>> moves;     /* (node, from) */
+        unsigned int bestMoves = 0;
+        while(!queue.empty() && moves.size() - bestMoves < MAX_FRUITLESS_MOVES) {
+            unsigned int v = queue.begin()->second;
+            queue.erase(queue.begin());
+            queued[v] = false;
+            locked[v] = true;
+
+            connectivity(graph, part, v, conn);
+            unsigned int from = part[v];
+            unsigned int to = NONE;
+            long long moveGain = 0;
+            for(unsigned int i = 1; i < conn.size(); ++i) {
+                unsigned int q = conn[i].first;
+                if(weight[q] + graph.vwgt[v] <= capacity_ + maxVwgt
+                        && (to == NONE || conn[i].second > moveGain)) {
+                    to = q;
+                    moveGain = conn[i].second;
+                }
+            }
+            if(to == NONE) {
+                continue;
+            }
+            moveGain -= conn[0].second;
+
+            nOverweight -= (weight[from] > capacity_) + (weight[to] > capacity_);
+            weight[from] -= graph.vwgt[v];
+            weight[to] += graph.vwgt[v];
+            nOverweight += (weight[from] > capacity_) + (weight[to] > capacity_);
+            part[v] = to;
+            currentCut -= moveGain;
+            moves.push_back(std::make_pair(v, from));
+            if(nOverweight == 0 && currentCut < bestCut) {
+                bestCut = currentCut;
+                bestMoves = moves.size();
+            }
+            for(unsigned int e = graph.xadj[v]; e < graph.xadj[v + 1]; ++e) {
+                update(graph.adjncy[e]);
+            }
+        }
+
+        // Roll back to the best balanced state of the pass
+        while(moves.size() > bestMoves) {
+            unsigned int v = moves.back().first;
+            weight[part[v]] -= graph.vwgt[v];
+            weight[moves.back().second] += graph.vwgt[v];
+            part[v] = moves.back().second;
+            moves.pop_back();
+        }
+        currentCut = bestCut;
+        nOverweight = 0;
+        if(bestCut == startCut) {
+            break;
+        }
+    }
+
+}
+
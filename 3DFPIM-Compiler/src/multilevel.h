@@ -0,0 +1,55 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <map>
+#include <vector>
+
+#include "common.h"
+
+// Multilevel k-way partitioner for the affinity graphs built by the
+// partitioner. Nodes are merged along heavy edges until the graph is small,
+// the coarsest graph is partitioned by greedy region growing, and the
+// partition is projected back and improved with Fiduccia-Mattheyses passes
+// at every level. No part holds more than `capacity` nodes, and the number
+// of parts is the smallest one that fits all nodes.
+class MultilevelPartitioner {
+
+    private:
+
+        struct Graph {
+            std::vector<unsigned int> xadj;     /* Neighbors of v are [xadj[v], xadj[v + 1]) */
+            std::vector<unsigned int> adjncy;
+            std::vector<unsigned int> adjwgt;
+            std::vector<unsigned int> vwgt;     /* Number of original nodes merged */
+            std::vector<unsigned int> cmap;     /* Node in the next coarser graph */
+            unsigned int nNodes() { return vwgt.size(); }
+        };
+
+        unsigned int nNodes_;
+        unsigned int capacity_;
+        unsigned int nParts_;
+        std::vector<std::map<unsigned int, unsigned int>> edges_;
+
+        void connectivity(Graph& graph, std::vector<unsigned int>& part, unsigned int v,
+            std::vector<std::pair<unsigned int, long long>>& conn);
+        long long cut(Graph& graph, std::vector<unsigned int>& part);
+        bool coarsen(Graph& fine, Graph& coarse);
+        void initialPartition(Graph& graph, std::vector<unsigned int>& part, unsigned int first);
+        void rebalance(Graph& graph, std::vector<unsigned int>& part);
+        void refine(Graph& graph, std::vector<unsigned int>& part);
+
+    public:
+
+        MultilevelPartitioner(unsigned int nNodes, unsigned int capacity);
+
+        void addEdge(unsigned int u, unsigned int v, unsigned int weight);
+        unsigned int getNParts() { return nParts_; }
+        void partition(std::vector<unsigned int>& result);
+
+};
+
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <cmath>
 
+#include "arena.h"
 #include "model.h"
 #include "operations.h"
 #include "tensors.h"
@@ -21,7 +22,7 @@ void OutputVector::operator=(Vector xparam) {
     for(unsigned int t = 0; t < x->nTiles(); ++t) {
         ProducerOperation* producer = x->getTile(t);
         OutputVectorTile* output = y->getTile(t);
-        new PseudoOutputOperation(producer->getModel(), producer, output);
+        new (producer->getModel()->getArena()) PseudoOutputOperation(producer->getModel(), producer, output);
     }
 }
 
@@ -37,7 +38,7 @@ void OutputImagePixelStream::operator=(ImagePixelStream xsparam) {
             for(unsigned int w = 0; w < xs->imageWidth(); ++w) {
                 ProducerOperation* x = xsTile->get(h, w);
                 OutputVectorTile* y = ysTile->get(h, w);
-                new PseudoOutputOperation(x->getModel(), x, y);
+                new (x->getModel()->getArena()) PseudoOutputOperation(x->getModel(), x, y);
             }
         }
     }
@@ -49,7 +50,7 @@ Vector::Vector(InputVector xparam) {
     y->checkCompatibility(x);
     for(unsigned int t = 0; t < x->nTiles(); ++t) {
         ProducerOperation* producer = 
-            new PseudoInputOperation(x->getModel(), x->getTile(t));
+            new (x->getModel()->getArena()) PseudoInputOperation(x->getModel(), x->getTile(t));
         y->setTile(t, producer);
     }
     impl_ = y;
@@ -72,7 +73,7 @@ ImagePixelStream::ImagePixelStream(InputImagePixelStream xsparam) {
         for(unsigned int h = 0; h < xs->imageHeight(); ++ h) {
             for(unsigned int w = 0; w < xs->imageWidth(); ++ w) {
                 InputVectorTile* x = xsTile->get(h, w);
-                ProducerOperation* y = new PseudoInputOperation(x->getModel(), x);
+                ProducerOperation* y = new (x->getModel()->getArena()) PseudoInputOperation(x->getModel(), x);
                 ysTile->add(h, w, y);
             }
         }
@@ -83,6 +84,7 @@ ImagePixelStream::ImagePixelStream(InputImagePixelStream xsparam) {
 // Concatenate stream of vectors for merged MVM operations
 ImagePixelStream* ConcatStream(ConvolutionalConstantMatrixImpl* M, ImagePixelStream xparam) {
     ImagePixelStreamImpl* xs = xparam.unwrap();
+    const unsigned int mvmuDim = xs->getModel()->getHardwareConfig().mvmuDim_;
 
     ImagePixelStreamImpl** ys_arr;
     ys_arr = new ImagePixelStreamImpl*[M->getNOutTiles()];
@@ -162,13 +164,13 @@ ImagePixelStream* ConcatStream(ConvolutionalConstantMatrixImpl* M, ImagePixelStr
                                         
                                         unsigned int length;
                                         if(t == xs->nTiles() - 1) {
-                                            length = (xs->nChannels() % MVMU_DIM == 0) ?
-                                                MVMU_DIM : xs->nChannels() % MVMU_DIM;
+                                            length = (xs->nChannels() % mvmuDim == 0) ?
+                                                mvmuDim : xs->nChannels() % mvmuDim;
                                         } else {
-                                            length = MVMU_DIM;
+                                            length = mvmuDim;
                                         }
                                         
-                                        unsigned int maxConcat = MVMU_DIM / length;
+                                        unsigned int maxConcat = mvmuDim / length;
                                         unsigned int t_new = 
                                             t * ys_arr[index]->kernelWidth() * ys_arr[index]->kernelHeight() +
                                             (kh * ys_arr[index]->kernelWidth() + kw) / maxConcat;
@@ -178,20 +180,20 @@ ImagePixelStream* ConcatStream(ConvolutionalConstantMatrixImpl* M, ImagePixelStr
                                             if(accum[ho][wo][t_new] == NULL){
                                                 accum[ho][wo][t_new] = xTile;
                                             } else{
-                                                accum[ho][wo][t_new] = new ALUVectorOperation
+                                                accum[ho][wo][t_new] = new (xs->getModel()->getArena()) ALUVectorOperation
                                                 (accum[ho][wo][t_new]->getModel(),
                                                 ALUVectorOperation::RESIZE,
                                                 accum[ho][wo][t_new], xTile);
                                             }
                                         } else{
                                             ProducerOperation* setOp = 
-                                                new SetImmediateOperation
+                                                new (M->getModel()->getArena()) SetImmediateOperation
                                                 (M->getModel(), 0, length); 
 
                                             if(accum[ho][wo][t_new] == NULL){
                                                 accum[ho][wo][t_new] = setOp;
                                             } else{
-                                                accum[ho][wo][t_new] = new ALUVectorOperation
+                                                accum[ho][wo][t_new] = new (xs->getModel()->getArena()) ALUVectorOperation
                                                 (accum[ho][wo][t_new]->getModel(),
                                                 ALUVectorOperation::RESIZE,
                                                 accum[ho][wo][t_new], setOp);
@@ -225,6 +227,7 @@ ImagePixelStream* ConcatStream(ConvolutionalConstantMatrixImpl* M, ImagePixelStr
 
 ImagePixelStream* ConcatStream(FCConstantMatrixImpl* M, ImagePixelStream xparam) {
     ImagePixelStreamImpl* xs = xparam.unwrap();
+    const unsigned int mvmuDim = xs->getModel()->getHardwareConfig().mvmuDim_;
 
     ImagePixelStreamImpl** ys_arr;
     ys_arr = new ImagePixelStreamImpl*[M->getNOutTiles()];
@@ -250,12 +253,12 @@ ImagePixelStream* ConcatStream(FCConstantMatrixImpl* M, ImagePixelStream xparam)
 
                     unsigned int length;
                     if(t == xs->nTiles() - 1) {
-                        length = (xs->nChannels() % MVMU_DIM == 0) ? MVMU_DIM : xs->nChannels() % MVMU_DIM;
+                        length = (xs->nChannels() % mvmuDim == 0) ? mvmuDim : xs->nChannels() % mvmuDim;
                     } else {
-                        length = MVMU_DIM;
+                        length = mvmuDim;
                     }
 
-                    unsigned int maxConcat = MVMU_DIM / length;
+                    unsigned int maxConcat = mvmuDim / length;
                     unsigned int t_new =
                         t * ys_arr[index]->kernelWidth() * ys_arr[index]->kernelHeight() +
                         (h * ys_arr[index]->kernelWidth() + w) / maxConcat;
@@ -263,7 +266,7 @@ ImagePixelStream* ConcatStream(FCConstantMatrixImpl* M, ImagePixelStream xparam)
                     if(accum[t_new] == NULL){
                         accum[t_new] = xTile;
                     } else{
-                        accum[t_new] = new ALUVectorOperation
+                        accum[t_new] = new (xs->getModel()->getArena()) ALUVectorOperation
                         (accum[t_new]->getModel(),
                         ALUVectorOperation::RESIZE,
                         accum[t_new], xTile);
@@ -290,7 +293,7 @@ Vector unaryOp(Vector xparam, ALUVectorOperation::OpCode op) {
     VectorImpl* y = new VectorImpl(x->getModel(), x->length());
     y->checkCompatibility(x);
     for(unsigned int t = 0; t < x->nTiles(); ++t) {
-        ProducerOperation* producer = new ALUVectorOperation(x->getModel(), op, x->getTile(t));
+        ProducerOperation* producer = new (x->getModel()->getArena()) ALUVectorOperation(x->getModel(), op, x->getTile(t));
         y->setTile(t, producer);
     }
     return Vector(y);
@@ -348,7 +351,7 @@ Vector binaryOp(Vector x1param, Vector x2param, ALUVectorOperation::OpCode op) {
     y->checkCompatibility(x2);
     for(unsigned int t = 0; t < x1->nTiles(); ++t) {
         ProducerOperation* producer = 
-            new ALUVectorOperation
+            new (x1->getModel()->getArena()) ALUVectorOperation
                 (x1->getModel(), op, x1->getTile(t), x2->getTile(t));
         y->setTile(t, producer);
     }
@@ -420,7 +423,7 @@ Vector immediateOp(Vector xparam, float imm, ALUVectorOperation::OpCode op) {
     VectorImpl* y = new VectorImpl(x->getModel(), x->length());
     y->checkCompatibility(x);
     for(unsigned int t = 0; t < x->nTiles(); ++t) {
-        ProducerOperation* producer = new ALUVectorOperation(x->getModel(), op, x->getTile(t), imm);
+        ProducerOperation* producer = new (x->getModel()->getArena()) ALUVectorOperation(x->getModel(), op, x->getTile(t), imm);
         y->setTile(t, producer);
     }
     return Vector(y);
@@ -446,7 +449,7 @@ ImagePixelStream sig(ImagePixelStream xsparam) {
             for(unsigned int w = 0; w < xs->imageWidth(); ++w) {
                 ProducerOperation* x = xsTile->get(h, w);
                 ProducerOperation* y = 
-                    new ALUVectorOperation(x->getModel(), ALUVectorOperation::SIG, x);
+                    new (x->getModel()->getArena()) ALUVectorOperation(x->getModel(), ALUVectorOperation::SIG, x);
                 ysTile->add(h, w, y);
             }
         }
@@ -470,7 +473,7 @@ ImagePixelStream noact(ImagePixelStream xsparam) {
             for(unsigned int w = 0; w < xs->imageWidth(); ++w) {
                 ProducerOperation* x = xsTile->get(h, w);
                 ProducerOperation* y = 
-                    new ALUVectorOperation(x->getModel(), ALUVectorOperation::NOACT, x);
+                    new (x->getModel()->getArena()) ALUVectorOperation(x->getModel(), ALUVectorOperation::NOACT, x);
                 ysTile->add(h, w, y);
             }
         }
@@ -506,7 +509,7 @@ ImagePixelStream maxpool(ImagePixelStream xsparam, unsigned int hspan, unsigned
                     accum[ho][wo][accumIdx] = xTile;
                 } else {
                     accum[ho][wo][accumIdx] = 
-                        new ALUVectorOperation
+                        new (xs->getModel()->getArena()) ALUVectorOperation
                         (accum[ho][wo][accumIdx - 1]->getModel(), 
                         ALUVectorOperation::MAX, 
                         accum[ho][wo][accumIdx - 1], xTile);
@@ -535,9 +538,9 @@ Vector operator*(ConstantMatrix Mparam, Vector xparam) {
 
     VectorImpl* y = new VectorImpl(model, M->height());
 
-    SlidingMergedMVMSet*** slidingSets = new SlidingMergedMVMSet**[M->nHeightTiles()];
+    SlidingMergedMVMSet*** slidingSets = model->getArena().allocateArray<SlidingMergedMVMSet**>(M->nHeightTiles());
     for(int h = 0; h < M->nHeightTiles(); ++h) {
-        slidingSets[h] = new SlidingMergedMVMSet*[M->nWidthTiles()];
+        slidingSets[h] = model->getArena().allocateArray<SlidingMergedMVMSet*>(M->nWidthTiles());
         for(int w_mat = 0; w_mat < M->nWidthTiles(); ++w_mat) {
             slidingSets[h][w_mat] = NULL;
         }
@@ -554,7 +557,7 @@ Vector operator*(ConstantMatrix Mparam, Vector xparam) {
             unsigned int w_size = (w_mat == M->nWidthTiles() - 1) ? M->nWidthRest() : M->nWidthDPT();
             ProducerOperation* concat[w_size]; 
 
-            MergedMVMSet* merge = new MergedMVMSet(model, M->getTile(h, w_mat)->height());
+            MergedMVMSet* merge = new (model->getArena()) MergedMVMSet(model, M->getTile(h, w_mat)->height());
 
             // for each iteration, concatenate the input tile
             for(unsigned int w_vec = 0; w_vec < w_size; ++w_vec) {
@@ -563,14 +566,14 @@ Vector operator*(ConstantMatrix Mparam, Vector xparam) {
                 int precision = int(std::ceil(log2(std::ceil(float(M->nWidthTiles()))))) + 4;
 
                 ProducerOperation* producer = concat[w_vec] = 
-                        new MVMOperation(model, M->getTile(h, w_mat), (w_vec == w_size - 1),
+                        new (model->getArena()) MVMOperation(model, M->getTile(h, w_mat), (w_vec == w_size - 1),
                         w_vec, w_size, precision, 0, x_arr[h]->getTile(tile_index), concatOp);
 
-                merge->add(dynamic_cast<MVMOperation*>(concat[w_vec]));
+                merge->add(opcast<MVMOperation>(concat[w_vec]));
             }
 
             if(slidingSets[h][w_mat] == NULL) {
-                slidingSets[h][w_mat] = new SlidingMergedMVMSet(1);
+                slidingSets[h][w_mat] = new (model->getArena()) SlidingMergedMVMSet(model, 1);
             }
             slidingSets[h][w_mat]->add(merge, 0);
 
@@ -580,7 +583,7 @@ Vector operator*(ConstantMatrix Mparam, Vector xparam) {
                 accum[w_mat] = concat[w_size - 1];
             } else {
                 accum[w_mat] = 
-                    new ALUVectorOperation
+                    new (model->getArena()) ALUVectorOperation
                     (model, ALUVectorOperation::ADD, 
                     concat[w_size - 1], accum[w_mat - 1]);
             }
@@ -618,7 +621,7 @@ ImagePixelStream operator+
                 ProducerOperation* x1 = xs1Tile->get(h, w);
                 ProducerOperation* x2 = xs2Tile->get(h, w);
 
-                ProducerOperation* y = new ALUVectorOperation
+                ProducerOperation* y = new (x1->getModel()->getArena()) ALUVectorOperation
                     (x1->getModel(), ALUVectorOperation::ADD, x1, x2);
 
                 ysTile->add(h, w, y);
@@ -689,13 +692,13 @@ ImagePixelStream operator* (ConvolutionalConstantMatrix Mparam, ImagePixelStream
     int maxHeight = 2 * (int(outImageHeight / (duplicateHeight * 2)) + int(0 * 2 < (outImageHeight % (duplicateHeight * 2))));
     int maxWidth = 2 * (int(outImageWidth / (duplicateWidth * 2)) + int(0 * 2 < (outImageWidth % (duplicateWidth * 2))));
 
-    SlidingMergedMVMSet***** slidingSets = new SlidingMergedMVMSet****[duplicateHeight];
+    SlidingMergedMVMSet***** slidingSets = model->getArena().allocateArray<SlidingMergedMVMSet****>(duplicateHeight);
     for(int dh = 0; dh < duplicateHeight; ++dh) {
-        slidingSets[dh] = new SlidingMergedMVMSet***[duplicateWidth];
+        slidingSets[dh] = model->getArena().allocateArray<SlidingMergedMVMSet***>(duplicateWidth);
         for(int dw = 0; dw < duplicateWidth; ++dw) {
-            slidingSets[dh][dw] = new SlidingMergedMVMSet**[M->getNOutTiles()];
+            slidingSets[dh][dw] = model->getArena().allocateArray<SlidingMergedMVMSet**>(M->getNOutTiles());
             for(int h = 0; h < M->getNOutTiles(); ++h) {
-                slidingSets[dh][dw][h] = new SlidingMergedMVMSet*[nInTiles];
+                slidingSets[dh][dw][h] = model->getArena().allocateArray<SlidingMergedMVMSet*>(nInTiles);
                 for(int w_mat = 0; w_mat < nInTiles; ++w_mat) {
                     slidingSets[dh][dw][h][w_mat] = NULL;
                 }
@@ -728,7 +731,7 @@ ImagePixelStream operator* (ConvolutionalConstantMatrix Mparam, ImagePixelStream
                                 unsigned int w_size = (w_mat == nInTiles - 1) ? nInRestDPT : nInDPT;
                                 ProducerOperation* concat[w_size]; 
 
-                                MergedMVMSet* merge = new MergedMVMSet(model, mat->height());
+                                MergedMVMSet* merge = new (model->getArena()) MergedMVMSet(model, mat->height());
                                 int sliding_id = hm * maxWidthVector[dw] + wm;
 
                                 if(sliding_id % 2 == 0) {
@@ -740,10 +743,10 @@ ImagePixelStream operator* (ConvolutionalConstantMatrix Mparam, ImagePixelStream
                                         int precision = int(std::ceil(log2(std::ceil(float(nInTiles))))) + 4;
 
                                         ProducerOperation* producer = concat[w_vec] =
-                                                new MVMOperation(model, mat, (w_vec == w_size - 1),
+                                                new (model->getArena()) MVMOperation(model, mat, (w_vec == w_size - 1),
                                                 w_vec, w_size, precision, sliding_id, pixel, concatOp);
 
-                                        merge->add(dynamic_cast<MVMOperation*>(producer));
+                                        merge->add(opcast<MVMOperation>(producer));
                                     }
                                 } else {
                                     for(int w_vec = w_size - 1; w_vec >= 0; --w_vec) {
@@ -754,15 +757,15 @@ ImagePixelStream operator* (ConvolutionalConstantMatrix Mparam, ImagePixelStream
                                         int precision = int(std::ceil(log2(std::ceil(float(nInTiles))))) + 4;
 
                                         ProducerOperation* producer = concat[w_vec] =
-                                                new MVMOperation(model, mat, (w_vec == 0),
+                                                new (model->getArena()) MVMOperation(model, mat, (w_vec == 0),
                                                 w_vec, w_size, precision, sliding_id, pixel, concatOp);
 
-                                        merge->add(dynamic_cast<MVMOperation*>(producer));
+                                        merge->add(opcast<MVMOperation>(producer));
                                     }
                                 }
 
                                 if(slidingSets[dh][dw][h][w_mat] == NULL) {
-                                    slidingSets[dh][dw][h][w_mat] = new SlidingMergedMVMSet(maxHeightVector[dh] * maxWidthVector[dw]);
+                                    slidingSets[dh][dw][h][w_mat] = new (model->getArena()) SlidingMergedMVMSet(model, maxHeightVector[dh] * maxWidthVector[dw]);
                                 }
                                 slidingSets[dh][dw][h][w_mat]->add(merge, sliding_id);
 
@@ -771,7 +774,7 @@ ImagePixelStream operator* (ConvolutionalConstantMatrix Mparam, ImagePixelStream
                                         accumStreamOut->add(ho, wo, concat[w_size-1]);
                                     } else {
                                         accumStreamOut->add
-                                            (ho, wo, new ALUVectorOperation
+                                            (ho, wo, new (model->getArena()) ALUVectorOperation
                                             (model, ALUVectorOperation::ADD, 
                                             concat[w_size-1], accumStreamIn->get(ho, wo)));
                                     }
@@ -780,7 +783,7 @@ ImagePixelStream operator* (ConvolutionalConstantMatrix Mparam, ImagePixelStream
                                         accumStreamOut->add(ho, wo, concat[0]);
                                     } else {
                                         accumStreamOut->add
-                                            (ho, wo, new ALUVectorOperation
+                                            (ho, wo, new (model->getArena()) ALUVectorOperation
                                             (model, ALUVectorOperation::ADD, 
                                             concat[0], accumStreamIn->get(ho, wo)));
                                     }
@@ -819,9 +822,9 @@ ImagePixelStream operator* (FCConstantMatrix Mparam, ImagePixelStream xsparam) {
             (model, 1, 1, 1, 1, M->getNOutChannels());
     }
 
-    SlidingMergedMVMSet*** slidingSets = new SlidingMergedMVMSet**[M->getNOutTiles()];
+    SlidingMergedMVMSet*** slidingSets = model->getArena().allocateArray<SlidingMergedMVMSet**>(M->getNOutTiles());
     for(int h = 0; h < M->getNOutTiles(); ++h) {
-        slidingSets[h] = new SlidingMergedMVMSet*[nInTiles];
+        slidingSets[h] = model->getArena().allocateArray<SlidingMergedMVMSet*>(nInTiles);
         for(int w_mat = 0; w_mat < nInTiles; ++w_mat) {
             slidingSets[h][w_mat] = NULL;
         }
@@ -841,7 +844,7 @@ ImagePixelStream operator* (FCConstantMatrix Mparam, ImagePixelStream xsparam) {
             unsigned int w_size = (w_mat == nInTiles - 1) ? nInRestDPT : nInDPT;
             ProducerOperation* concat[w_size]; 
 
-            MergedMVMSet* merge = new MergedMVMSet(model, mat->height());
+            MergedMVMSet* merge = new (model->getArena()) MergedMVMSet(model, mat->height());
 
             for(int w_vec = 0; w_vec < w_size; ++w_vec) {
                 unsigned int tileIdx = w_vec + w_mat * nInDPT;
@@ -851,14 +854,14 @@ ImagePixelStream operator* (FCConstantMatrix Mparam, ImagePixelStream xsparam) {
                 int precision = int(std::ceil(log2(std::ceil(float(nInTiles))))) + 4;
 
                 ProducerOperation* producer = concat[w_vec] = 
-                        new MVMOperation(model, mat, (w_vec == w_size - 1),
+                        new (model->getArena()) MVMOperation(model, mat, (w_vec == w_size - 1),
                         w_vec, w_size, precision, 0, pixel, concatOp);
 
-                merge->add(dynamic_cast<MVMOperation*>(producer));
+                merge->add(opcast<MVMOperation>(producer));
             }
 
             if(slidingSets[h][w_mat] == NULL) {
-                slidingSets[h][w_mat] = new SlidingMergedMVMSet(1);
+                slidingSets[h][w_mat] = new (model->getArena()) SlidingMergedMVMSet(model, 1);
             }
             slidingSets[h][w_mat]->add(merge, 0);
 
@@ -866,7 +869,7 @@ ImagePixelStream operator* (FCConstantMatrix Mparam, ImagePixelStream xsparam) {
                 accumStreamOut->add(0, 0, concat[w_size-1]);
             } else {
                 accumStreamOut->add
-                    (0, 0, new ALUVectorOperation
+                    (0, 0, new (model->getArena()) ALUVectorOperation
                     (model, ALUVectorOperation::ADD, 
                     concat[w_size-1], 
                     accumStreamIn->get(0, 0)));
@@ -879,8 +882,8 @@ ImagePixelStream operator* (FCConstantMatrix Mparam, ImagePixelStream xsparam) {
     return ImagePixelStream(ys[nInTiles - 1]);
 }
 
-Operation::Operation(ModelImpl* model, unsigned int length) : 
-    model_(model), length_(length) {
+Operation::Operation(ModelImpl* model, Kind kind, unsigned int length) : 
+    model_(model), kind_(kind), length_(length) {
     assert(model != NULL);
     id = model->addOperation(this);
 }
@@ -928,7 +931,7 @@ MVMOperation::MVMOperation
     int slideId,
     ProducerOperation* src1,
     ProducerOperation* src2) : 
-    Operation(model, mat->height()), 
+    Operation(model, MVM, mat->height()), 
     ConsumerOperation(src1, src2), 
     mat_(mat), mergedSet_(NULL), isLast_(isLast), 
     coalescedSet_(NULL), depth_(depth), nStack_(nStack), precision_(precision), slideId_(slideId){
@@ -946,7 +949,7 @@ ALUVectorOperation::ALUVectorOperation
     OpCode opCode, 
     ProducerOperation* src1, 
     ProducerOperation* src2) : 
-    Operation(model, src1->length()), 
+    Operation(model, ALU_VECTOR, src1->length()), 
     ConsumerOperation(src1, src2), opCode_(opCode), imm_(0.0f) {
 
     assert(!isImmediate());
@@ -971,7 +974,7 @@ ALUVectorOperation::ALUVectorOperation
             break;
         case RESIZE:
             length_ = src1->length() + src2->length();
-            assert(length_ <= MVMU_DIM && "Concatenated vector length exceeds the MVMU size");
+            assert(length_ <= model->getHardwareConfig().mvmuDim_ && "Concatenated vector length exceeds the MVMU size");
     }
 }
 
@@ -980,7 +983,7 @@ ALUVectorOperation::ALUVectorOperation
     OpCode opCode, 
     ProducerOperation* src1, 
     float imm) : 
-    Operation(model, src1->length()), 
+    Operation(model, ALU_VECTOR, src1->length()), 
     ConsumerOperation(src1), 
     opCode_(opCode), imm_(imm) {
 
@@ -990,39 +993,39 @@ ALUVectorOperation::ALUVectorOperation
 
 SetImmediateOperation::SetImmediateOperation
     (ModelImpl* model, unsigned int imm, unsigned int length) : 
-    Operation(model, length), imm_(imm) {
+    Operation(model, SET_IMMEDIATE, length), imm_(imm) {
 
 }
 
-CopyOperation::CopyOperation(ModelImpl* model, ProducerOperation* src) : Operation(model, src->length()), ConsumerOperation(src) {
+CopyOperation::CopyOperation(ModelImpl* model, ProducerOperation* src) : Operation(model, COPY, src->length()), ConsumerOperation(src) {
     assert(src != NULL);
 }
 
-LoadOperation::LoadOperation(ModelImpl* model, TileMemoryWriteOperation* src) : Operation(model, src->length()), TileMemoryReadOperation(src) {
+LoadOperation::LoadOperation(ModelImpl* model, TileMemoryWriteOperation* src) : Operation(model, LOAD, src->length()), TileMemoryReadOperation(src) {
 }
 
 MVMGuardOperation::MVMGuardOperation(ModelImpl* model, MVMOperation* mvm, TileMemoryWriteOperation* src)
-    : Operation(model, src->length()), mvm_(mvm), TileMemoryReadOperation(src) {
+    : Operation(model, MVM_GUARD, src->length()), mvm_(mvm), TileMemoryReadOperation(src) {
 }
 
-StoreOperation::StoreOperation(ModelImpl* model, ProducerOperation* src) : Operation(model, src->length()), ConsumerOperation(src) {
+StoreOperation::StoreOperation(ModelImpl* model, ProducerOperation* src) : Operation(model, STORE, src->length()), ConsumerOperation(src) {
     assert(src != NULL);
 }
 
-SendOperation::SendOperation(ModelImpl* model, TileMemoryWriteOperation* src) : Operation(model, src->length()), TileMemoryReadOperation(src), dst_(NULL) {
+SendOperation::SendOperation(ModelImpl* model, TileMemoryWriteOperation* src) : Operation(model, SEND, src->length()), TileMemoryReadOperation(src), dst_(NULL) {
 }
 
-ReceiveOperation::ReceiveOperation(ModelImpl* model, SendOperation* src) : Operation(model, src->length()), src_(src) {
+ReceiveOperation::ReceiveOperation(ModelImpl* model, SendOperation* src) : Operation(model, RECEIVE, src->length()), src_(src) {
     src->setDst(this);
 }
 
-WriteInputOperation::WriteInputOperation(ModelImpl* model, InputVectorTile* src) : Operation(model, src->length()), InputOperation(src) {
+WriteInputOperation::WriteInputOperation(ModelImpl* model, InputVectorTile* src) : Operation(model, WRITE_INPUT, src->length()), InputOperation(src) {
 }
 
 ReadOutputOperation::ReadOutputOperation
     (ModelImpl* model, TileMemoryWriteOperation* src, 
     OutputVectorTile* dst) : 
-    Operation(model, src->length()), 
+    Operation(model, READ_OUTPUT, src->length()), 
     TileMemoryReadOperation(src), 
     OutputOperation(dst) {
 
@@ -1031,14 +1034,14 @@ ReadOutputOperation::ReadOutputOperation
 
 PseudoInputOperation::PseudoInputOperation
     (ModelImpl* model, InputVectorTile* src) : 
-    Operation(model, src->length()), 
+    Operation(model, PSEUDO_INPUT, src->length()), 
     InputOperation(src) {
 
 }
 
 PseudoOutputOperation::PseudoOutputOperation
     (ModelImpl* model, ProducerOperation* op, OutputVectorTile* dst) : 
-    Operation(model, op->length()), ConsumerOperation(op), OutputOperation(dst) {
+    Operation(model, PSEUDO_OUTPUT, op->length()), ConsumerOperation(op), OutputOperation(dst) {
 
     assert(op != NULL && op->length() == dst->length());
 }
@@ -1189,6 +1192,13 @@ bool CoalescedMergedMVMSet::isComplete() {
     return true;
 }
 
+SlidingMergedMVMSet::SlidingMergedMVMSet(ModelImpl* model, int slide_size) : size_(slide_size) {
+    mvms_ = model->getArena().allocateArray<MergedMVMSet*>(size_);
+    for(unsigned int i = 0; i < size_; ++i) {
+        mvms_[i] = NULL;
+    }
+}
+
 void SlidingMergedMVMSet::add(MergedMVMSet* mvm, int slideId) {
     assert(mvms_[slideId] == NULL);
     mvms_[slideId] = mvm;
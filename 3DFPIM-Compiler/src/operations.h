@@ -6,6 +6,8 @@
 * LICENSE file.
 *******************************************************************************/
 
+#include <algorithm>
+#include <assert.h>
 #include <iostream>
 #include <set>
 #include <string>
@@ -15,14 +17,26 @@
 
 class Operation {
 
+    public:
+
+        // Concrete operation classes, so that passes can dispatch with a
+        // switch instead of a chain of dynamic_casts
+        enum Kind {
+            MVM, MERGED_MVM, ALU_VECTOR, SET_IMMEDIATE, COPY,                  /* Core compute */
+            LOAD, STORE, MVM_GUARD,                                             /* Core memory */
+            SEND, RECEIVE, WRITE_INPUT, READ_OUTPUT,                            /* Tile */
+            PSEUDO_INPUT, PSEUDO_OUTPUT                                         /* Pseudo */
+        };
+
     protected:
 
         ModelImpl* model_;
+        Kind kind_;
         unsigned int length_;
 
         Operation() { }
 
-        Operation(ModelImpl* model, unsigned int length);
+        Operation(ModelImpl* model, Kind kind, unsigned int length);
 
     public:
 
@@ -30,8 +44,18 @@ class Operation {
         virtual ~Operation() { }
 
         ModelImpl* getModel() const { return model_; }
+        Kind getKind() const { return kind_; }
         unsigned int length() const { return length_; }
 
+        // Cross casts to the interface classes. Operation is a virtual base,
+        // so these are the only way down from it without RTTI.
+        virtual ProducerOperation* asProducer() { return NULL; }
+        virtual ConsumerOperation* asConsumer() { return NULL; }
+        virtual TileMemoryWriteOperation* asTileMemoryWrite() { return NULL; }
+        virtual TileMemoryReadOperation* asTileMemoryRead() { return NULL; }
+        virtual CoreOperation* asCore() { return NULL; }
+        virtual TileOperation* asTile() { return NULL; }
+
         std::string printNodeName();
         virtual std::string printNodeStyle();
         virtual std::string printOperationType()=0;
@@ -39,20 +63,118 @@ class Operation {
 
 };
 
+// Checked downcast on the operation kind, returns NULL on a mismatch.
+// Each operation class provides a static castFrom(Operation*).
+template <class T>
+inline T* opcast(Operation* op) { return op != NULL ? T::castFrom(op) : NULL; }
+
+template <class T>
+inline bool isa(Operation* op) { return opcast<T>(op) != NULL; }
+
+// Membership over dense operation ids, for the visited marks of graph
+// traversals. Grows when operations are created during the traversal.
+class OperationSet {
+
+    private:
+
+        std::vector<bool> bits_;
+
+    public:
+
+        OperationSet(unsigned int capacity=0) : bits_(capacity) { }
+
+        bool count(Operation* op) const
+            { return op->id >= 0 && (unsigned int) op->id < bits_.size() && bits_[op->id]; }
+        void insert(Operation* op) {
+            assert(op->id >= 0 && "Uncommitted operations have no id!");
+            if((unsigned int) op->id >= bits_.size()) {
+                bits_.resize(2*(op->id + 1));
+            }
+            bits_[op->id] = true;
+        }
+
+};
+
+// The users of an operation, in address order as in a std::set. Most
+// operations have one or two users, so a sorted vector takes a fraction of
+// the memory of the tree nodes. Iterators step to the next larger user,
+// so users can be added or removed during a traversal as with a std::set.
+template <class T>
+class UserSet {
+
+    private:
+
+        std::vector<T*> users_;
+
+    public:
+
+        class iterator {
+
+            private:
+
+                const std::vector<T*>* users_;
+                size_t index_;
+                T* current_;
+
+            public:
+
+                iterator(const std::vector<T*>* users, size_t index)
+                    : users_(users), index_(index),
+                    current_(index < users->size() ? (*users)[index] : NULL) { }
+
+                T* operator*() const { return current_; }
+                bool operator==(const iterator& other) const { return current_ == other.current_; }
+                bool operator!=(const iterator& other) const { return current_ != other.current_; }
+                iterator& operator++() {
+                    if(index_ < users_->size() && (*users_)[index_] == current_) {
+                        ++index_;
+                    } else {
+                        // The current user moved or was erased
+                        index_ = std::upper_bound(users_->begin(), users_->end(), current_)
+                            - users_->begin();
+                    }
+                    current_ = (index_ < users_->size()) ? (*users_)[index_] : NULL;
+                    return *this;
+                }
+
+        };
+
+        void insert(T* user) {
+            auto it = std::lower_bound(users_.begin(), users_.end(), user);
+            if(it == users_.end() || *it != user) {
+                users_.insert(it, user);
+            }
+        }
+        void erase(T* user) {
+            auto it = std::lower_bound(users_.begin(), users_.end(), user);
+            if(it != users_.end() && *it == user) {
+                users_.erase(it);
+            }
+        }
+
+        unsigned int size() const { return users_.size(); }
+        iterator begin() const { return iterator(&users_, 0); }
+        iterator end() const { return iterator(&users_, users_.size()); }
+
+};
+
 class ProducerOperation : public virtual Operation {
 
     protected:
 
-        std::set<ConsumerOperation*> users_;
+        UserSet<ConsumerOperation> users_;
 
         ProducerOperation() { }
 
     public:
 
+        static ProducerOperation* castFrom(Operation* op) { return op->asProducer(); }
+        ProducerOperation* asProducer() { return this; }
+
         void addUser(ConsumerOperation* user) { users_.insert(user); }
         void removeUser(ConsumerOperation* user) { users_.erase(user); }
 
-        typedef std::set<ConsumerOperation*>::iterator user_iterator;
+        typedef UserSet<ConsumerOperation>::iterator user_iterator;
         user_iterator user_begin() { return users_.begin(); }
         user_iterator user_end() { return users_.end(); }
         unsigned int numUsers() { return users_.size(); }
@@ -71,6 +193,9 @@ class ConsumerOperation : public virtual Operation {
 
     public:
 
+        static ConsumerOperation* castFrom(Operation* op) { return op->asConsumer(); }
+        ConsumerOperation* asConsumer() { return this; }
+
         unsigned int numOperands() { return operands_.size(); }
         ProducerOperation* getOperand(unsigned int i) { return operands_[i]; }
         bool uses(ProducerOperation* op);
@@ -82,17 +207,20 @@ class TileMemoryWriteOperation : public virtual Operation {
 
     protected:
 
-        std::set<TileMemoryReadOperation*> users_;
+        UserSet<TileMemoryReadOperation> users_;
 
         TileMemoryWriteOperation() { }
 
     public:
 
+        static TileMemoryWriteOperation* castFrom(Operation* op) { return op->asTileMemoryWrite(); }
+        TileMemoryWriteOperation* asTileMemoryWrite() { return this; }
+
         unsigned int numUsers() { return users_.size(); }
         void addUser(TileMemoryReadOperation* user) { users_.insert(user); }
         void removeUser(TileMemoryReadOperation* user) { users_.erase(user); }
 
-        typedef std::set<TileMemoryReadOperation*>::iterator user_iterator;
+        typedef UserSet<TileMemoryReadOperation>::iterator user_iterator;
         user_iterator user_begin() { return users_.begin(); }
         user_iterator user_end() { return users_.end(); }
 
@@ -111,6 +239,9 @@ class TileMemoryReadOperation : public virtual Operation {
 
     public:
 
+        static TileMemoryReadOperation* castFrom(Operation* op) { return op->asTileMemoryRead(); }
+        TileMemoryReadOperation* asTileMemoryRead() { return this; }
+
         unsigned int numSrcs() { return srcs_.size(); }
         TileMemoryWriteOperation* getSrc(unsigned int i) { return srcs_[i]; }
         void replaceSrc(TileMemoryWriteOperation* old, TileMemoryWriteOperation* replacement);
@@ -151,13 +282,23 @@ class OutputOperation : public virtual Operation {
 
 class CoreOperation : public virtual Operation {
 
+    public:
+
+        static CoreOperation* castFrom(Operation* op) { return op->asCore(); }
+        CoreOperation* asCore() { return this; }
+
 };
 
 class TileOperation : public virtual Operation {
 
+    public:
+
+        static TileOperation* castFrom(Operation* op) { return op->asTile(); }
+        TileOperation* asTile() { return this; }
+
 };
 
-// An individual (MVMU_DIM x MVMU_DIM) MVM operation
+// An individual (mvmuDim x mvmuDim) MVM operation
 class MVMOperation : 
     public ProducerOperation, 
     public ConsumerOperation, 
@@ -177,12 +318,16 @@ class MVMOperation :
 
     public:
 
+        static MVMOperation* castFrom(Operation* op)
+            { return op->getKind() == MVM ? static_cast<MVMOperation*>(op->asProducer()) : NULL; }
+
         MVMOperation(ModelImpl* model, ConstantMatrixTile* mat, bool isLast, int depth,
             int nStack,
             int precision,
             int slideId,
             ProducerOperation* src1 = NULL, ProducerOperation* src2 = NULL);
         bool isMVMLast() { return isLast_; } 
+        ConstantMatrixTile* getConstantMatrixTile() { return mat_; }
         int getDepth() { return depth_; }
         int getNStack() { return nStack_; }
         int getPrecision() { return precision_; }
@@ -218,8 +363,11 @@ class MergedMVMSet :
     public:
         int mergedId;
 
+        static MergedMVMSet* castFrom(Operation* op)
+            { return op->getKind() == MERGED_MVM ? static_cast<MergedMVMSet*>(op->asProducer()) : NULL; }
+
         MergedMVMSet(ModelImpl* model, unsigned int length) : 
-            Operation(model, length) { 
+            Operation(model, MERGED_MVM, length) { 
 
             coalescedSet_ = NULL; 
             slidingSet_ = NULL;
@@ -260,7 +408,7 @@ class CoalescedMVMSet {
 
     public:
 
-        CoalescedMVMSet() : mvms_(N_CONSTANT_MVMUS_PER_CORE) { }
+        CoalescedMVMSet(unsigned int nMVMUs) : mvms_(nMVMUs) { }
 
         std::vector<MVMOperation*>::iterator begin() { return mvms_.begin(); }
         std::vector<MVMOperation*>::iterator end() { return mvms_.end(); }
@@ -272,7 +420,7 @@ class CoalescedMVMSet {
         bool isSetLeader(MVMOperation* mvm);
         unsigned int getSize() {
             int size = 0;
-            for(unsigned int i = 0; i < N_CONSTANT_MVMUS_PER_CORE; i++)
+            for(unsigned int i = 0; i < mvms_.size(); i++)
                 if(mvms_[i] != NULL) size++;
             return size;
         }
@@ -287,7 +435,7 @@ class CoalescedMergedMVMSet {
 
     public:
 
-        CoalescedMergedMVMSet() : mvms_(N_CONSTANT_MVMUS_PER_CORE) { }
+        CoalescedMergedMVMSet(unsigned int nMVMUs) : mvms_(nMVMUs) { }
 
         std::vector<MergedMVMSet*>::iterator begin() { return mvms_.begin(); }
         std::vector<MergedMVMSet*>::iterator end() { return mvms_.end(); }
@@ -307,14 +455,16 @@ class SlidingMergedMVMSet {
 
     private:
 
-        std::vector<MergedMVMSet*> mvms_;
+        // Kept in the model's arena, so the set needs no destructor
+        MergedMVMSet** mvms_;
+        unsigned int size_;
 
     public:
 
-        SlidingMergedMVMSet(int slide_size) : mvms_(slide_size) {};
+        SlidingMergedMVMSet(ModelImpl* model, int slide_size);
 
-        std::vector<MergedMVMSet*>::iterator begin() { return mvms_.begin(); }
-        std::vector<MergedMVMSet*>::iterator end() { return mvms_.end(); }
+        MergedMVMSet** begin() { return mvms_; }
+        MergedMVMSet** end() { return mvms_ + size_; }
         void add(MergedMVMSet* mvm, int slideId);
 
 };
@@ -346,6 +496,9 @@ class ALUVectorOperation :
 
     public:
 
+        static ALUVectorOperation* castFrom(Operation* op)
+            { return op->getKind() == ALU_VECTOR ? static_cast<ALUVectorOperation*>(op->asProducer()) : NULL; }
+
         ALUVectorOperation
             (ModelImpl* model, OpCode opCode, 
             ProducerOperation* src1=NULL, 
@@ -375,11 +528,15 @@ class SetImmediateOperation : public ProducerOperation, public CoreOperation {
 
     public:
 
+        static SetImmediateOperation* castFrom(Operation* op)
+            { return op->getKind() == SET_IMMEDIATE ? static_cast<SetImmediateOperation*>(op->asProducer()) : NULL; }
+
         SetImmediateOperation
             (ModelImpl* model, unsigned int imm, 
             unsigned int length=1);
 
         unsigned int getImmediate() { return imm_; }
+        void setImmediate(unsigned int imm) { imm_ = imm; }
 
         std::string printOperationType();
         void printNodeAndEdges(std::ostream& fout) 
@@ -394,6 +551,9 @@ class CopyOperation :
 
     public:
 
+        static CopyOperation* castFrom(Operation* op)
+            { return op->getKind() == COPY ? static_cast<CopyOperation*>(op->asProducer()) : NULL; }
+
         CopyOperation(ModelImpl* model, ProducerOperation* src);
 
         std::string printOperationType();
@@ -410,6 +570,9 @@ class LoadOperation :
 
     public:
 
+        static LoadOperation* castFrom(Operation* op)
+            { return op->getKind() == LOAD ? static_cast<LoadOperation*>(op->asProducer()) : NULL; }
+
         LoadOperation(ModelImpl* model, TileMemoryWriteOperation* src);
 
         void addTileMemoryAddressOperand(ProducerOperation* address);
@@ -428,6 +591,9 @@ class StoreOperation :
 
     public:
 
+        static StoreOperation* castFrom(Operation* op)
+            { return op->getKind() == STORE ? static_cast<StoreOperation*>(op->asConsumer()) : NULL; }
+
         StoreOperation(ModelImpl* model, ProducerOperation* src);
 
         void addTileMemoryAddressOperand(ProducerOperation* address);
@@ -450,6 +616,9 @@ class MVMGuardOperation :
 
     public:
 
+        static MVMGuardOperation* castFrom(Operation* op)
+            { return op->getKind() == MVM_GUARD ? static_cast<MVMGuardOperation*>(op->asConsumer()) : NULL; }
+
         MVMGuardOperation(ModelImpl* model, MVMOperation* mvm, TileMemoryWriteOperation* src);
 
         void addTileMemoryAddressOperand(ProducerOperation* address);
@@ -468,6 +637,9 @@ class SendOperation : public TileMemoryReadOperation, public TileOperation {
 
     public:
 
+        static SendOperation* castFrom(Operation* op)
+            { return op->getKind() == SEND ? static_cast<SendOperation*>(op->asTileMemoryRead()) : NULL; }
+
         SendOperation(ModelImpl* model, TileMemoryWriteOperation* src);
 
         ReceiveOperation* getDst() { return dst_; }
@@ -489,6 +661,9 @@ class ReceiveOperation :
 
     public:
 
+        static ReceiveOperation* castFrom(Operation* op)
+            { return op->getKind() == RECEIVE ? static_cast<ReceiveOperation*>(op->asTileMemoryWrite()) : NULL; }
+
         ReceiveOperation(ModelImpl* model, SendOperation* src);
 
         SendOperation* getSrc() { return src_; }
@@ -507,6 +682,9 @@ class WriteInputOperation :
 
     public:
 
+        static WriteInputOperation* castFrom(Operation* op)
+            { return op->getKind() == WRITE_INPUT ? static_cast<WriteInputOperation*>(op->asTileMemoryWrite()) : NULL; }
+
         WriteInputOperation(ModelImpl* model, InputVectorTile* src);
 
         std::string printOperationType();
@@ -521,6 +699,9 @@ class ReadOutputOperation :
 
     public:
 
+        static ReadOutputOperation* castFrom(Operation* op)
+            { return op->getKind() == READ_OUTPUT ? static_cast<ReadOutputOperation*>(op->asTileMemoryRead()) : NULL; }
+
         ReadOutputOperation
             (ModelImpl* model, TileMemoryWriteOperation* src, 
             OutputVectorTile* dst);
@@ -536,6 +717,9 @@ class PseudoInputOperation : public InputOperation, public ProducerOperation {
 
     public:
 
+        static PseudoInputOperation* castFrom(Operation* op)
+            { return op->getKind() == PSEUDO_INPUT ? static_cast<PseudoInputOperation*>(op->asProducer()) : NULL; }
+
         PseudoInputOperation(ModelImpl* model, InputVectorTile* src);
 
         std::string printOperationType();
@@ -547,6 +731,9 @@ class PseudoOutputOperation : public OutputOperation, public ConsumerOperation {
 
     public:
 
+        static PseudoOutputOperation* castFrom(Operation* op)
+            { return op->getKind() == PSEUDO_OUTPUT ? static_cast<PseudoOutputOperation*>(op->asConsumer()) : NULL; }
+
         PseudoOutputOperation(ModelImpl* model, ProducerOperation* src, OutputVectorTile* dst);
 
         std::string printOperationType();
@@ -13,7 +13,9 @@
 
 #include "3dfpim.h"
 
+#include "arena.h"
 #include "model.h"
+#include "multilevel.h"
 #include "operations.h"
 #include "partitioner.h"
 #include "tensors.h"
@@ -32,10 +34,10 @@ Partitioner::Partitioner(ModelImpl* model, CompilerOptions::GraphPartitioningSch
             assignVCoresInVMVMUOrder();
             assignVTilesInVMVMUOrder();
             break;
-        case CompilerOptions::GP_KAHIP: // FIXME: check whether KaHIP exists
-            assignVMVMUsInRowMajor(); // Doesn't matter which order is used because KaHIP will partition agnostically
-            assignVCoresWithKaHIP();
-            assignVTilesWithKaHIP();
+        case CompilerOptions::GP_MULTILEVEL:
+            assignVMVMUsInRowMajor(); // Doesn't matter which order is used because the graph is partitioned agnostically
+            assignVCoresWithMultilevel();
+            assignVTilesWithMultilevel();
             break;
         case CompilerOptions::GP_RANDOM:
             assignVMVMUsRandomly();
@@ -52,19 +54,28 @@ Partitioner::Partitioner(ModelImpl* model, CompilerOptions::GraphPartitioningSch
 
 void Partitioner::reassignVMVMU(ALUVectorOperation* op, unsigned int vMVMU) {
     assert(op->isResize());
-    op2vmvmu_[op] = vMVMU;
+    setVMVMU(op, vMVMU);
 }
 
 bool Partitioner::isVMVMUAssigned(Operation* op) {
-    return op2vmvmu_.count(op);
+    return op->id >= 0 && (unsigned int) op->id < op2vmvmu_.size() && op2vmvmu_[op->id] != -1;
+}
+
+void Partitioner::setVMVMU(Operation* op, unsigned int vMVMU) {
+    assert(op->id >= 0 && "Cannot assign virtual MVMU to an uncommitted operation!");
+    if((unsigned int) op->id >= op2vmvmu_.size()) {
+        // Operations are still inserted after this point, so leave room for them
+        op2vmvmu_.resize(2*std::max(model_->op_count, op->id + 1), -1);
+    }
+    op2vmvmu_[op->id] = vMVMU;
 }
 
 void Partitioner::assignVMVMU(Operation* op, unsigned int vMVMU) {
     assert((!isVMVMUAssigned(op)) && "Cannot reassign virtual MVMU!");
-    op2vmvmu_[op] = vMVMU;
-    if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(op))
+    setVMVMU(op, vMVMU);
+    if(MVMOperation* mvm = opcast<MVMOperation>(op))
         if(mvm->isMVMLast())
-            op2vmvmu_[mvm->getMergedSet()] = vMVMU;
+            setVMVMU(mvm->getMergedSet(), vMVMU);
 }
 
 void Partitioner::cloneAssignment(Operation* cloneFrom, Operation* cloneTo) {
@@ -75,7 +86,7 @@ void Partitioner::cloneAssignment(Operation* cloneFrom, Operation* cloneTo) {
 
 unsigned int Partitioner::getVMVMU(ConstantMatrixTile* tile) {
     assert(cmat2vmvmu_.count(tile) && "Virtual MVMU not assigned!");
-    return cmat2vmvmu_[tile];
+    return cmat2vmvmu_.at(tile);
 }
 
 unsigned int Partitioner::getVCore(ConstantMatrixTile* tile) {
@@ -88,7 +99,7 @@ unsigned int Partitioner::getVTile(ConstantMatrixTile* tile) {
 
 unsigned int Partitioner::getVMVMU(Operation* op) {
     assert(isVMVMUAssigned(op) && "Virtual MVMU not assigned!");
-    return op2vmvmu_[op];
+    return op2vmvmu_[op->id];
 }
 
 unsigned int Partitioner::getVCore(Operation* op) {
@@ -240,7 +251,7 @@ void Partitioner::assignVMVMUsAndSpreadAffinity() {
     // Resolve assignment for operations with operands from different virtual MVMUs
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(op)) {
+        if(ConsumerOperation* consumer = opcast<ConsumerOperation>(op)) {
             if(!isVMVMUAssigned(consumer)) {
                 for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                     ProducerOperation* operand = consumer->getOperand(o);
@@ -249,7 +260,7 @@ void Partitioner::assignVMVMUsAndSpreadAffinity() {
                         //       Currently assigning to MVMU of first operand that is assigned (if any).
                         cloneAssignment(operand, consumer);
                         spreadVMVMUAffinityToOperands(consumer, false, -1);
-                        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(consumer)) {
+                        if(ProducerOperation* producer = opcast<ProducerOperation>(consumer)) {
                             spreadVMVMUAffinityToUsers(producer);
                         }
                         break;
@@ -261,7 +272,7 @@ void Partitioner::assignVMVMUsAndSpreadAffinity() {
 
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(op)) {
+        if(MVMOperation* mvm = opcast<MVMOperation>(op)) {
             unsigned int vMVMU = getVMVMU(mvm);
             spreadVMVMUAffinityToOperands(mvm, true, vMVMU);
         }
@@ -272,17 +283,17 @@ void Partitioner::spreadVMVMUAffinityToOperands(ConsumerOperation* op, bool resi
     for(unsigned int o = 0; o < op->numOperands(); ++o) {
         ProducerOperation* producer = op->getOperand(o);
         if(resize){
-            if(ALUVectorOperation* alu = dynamic_cast<ALUVectorOperation*>(producer)){
+            if(ALUVectorOperation* alu = opcast<ALUVectorOperation>(producer)){
                 if(alu->isResize()){
                     reassignVMVMU(alu, vMVMU);
                     if(ConsumerOperation* consumer = 
-                        dynamic_cast<ConsumerOperation*>(producer)) {
+                        opcast<ConsumerOperation>(producer)) {
                         
                         spreadVMVMUAffinityToOperands(consumer, resize, vMVMU);
                     }
                 }
             }
-        } else if(!isVMVMUAssigned(producer) && !dynamic_cast<MVMOperation*>(producer)) {
+        } else if(!isVMVMUAssigned(producer) && !opcast<MVMOperation>(producer)) {
             bool allUsersAssigned = true;
             for(auto u = producer->user_begin(); u != producer->user_end(); ++u) {
                 ConsumerOperation* consumer = *u;
@@ -295,7 +306,7 @@ void Partitioner::spreadVMVMUAffinityToOperands(ConsumerOperation* op, bool resi
                 // TODO: Heuristic for which MVMU to select if users assigned to different MVMUs.
                 //       Currently just assigning to same MVMU as last user processed.
                 cloneAssignment(op, producer);
-                if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(producer)) {
+                if(ConsumerOperation* consumer = opcast<ConsumerOperation>(producer)) {
                     spreadVMVMUAffinityToOperands(consumer, resize, vMVMU);
                 }
             }
@@ -307,10 +318,10 @@ void Partitioner::spreadVMVMUAffinityToUsers(ProducerOperation* op) {
     for(auto u = op->user_begin(); u != op->user_end(); ++u) {
         ConsumerOperation* consumer = *u;
         if(!isVMVMUAssigned(consumer) && 
-                !dynamic_cast<MVMOperation*>(consumer)) {
+                !opcast<MVMOperation>(consumer)) {
 
             bool isResize = false;
-            if(ALUVectorOperation* alu = dynamic_cast<ALUVectorOperation*>(consumer))
+            if(ALUVectorOperation* alu = opcast<ALUVectorOperation>(consumer))
                 if(alu->isResize()) isResize = true;
 
             bool allOperandsAssigned = true;
@@ -325,7 +336,7 @@ void Partitioner::spreadVMVMUAffinityToUsers(ProducerOperation* op) {
                 // TODO: Heuristic for which MVMU to select if operands assigned to different MVMUs.
                 //       Currently just assigning to same MVMU as last operand processed.
                 cloneAssignment(op, consumer);
-                if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(consumer)) {
+                if(ProducerOperation* producer = opcast<ProducerOperation>(consumer)) {
                     spreadVMVMUAffinityToUsers(producer);
                 }
             }
@@ -343,7 +354,7 @@ void Partitioner::assignVCoresInVMVMUOrder() {
     vmvmu2vcore_[1] = 1;
 
     // Assign virtual MVMUs to virtual cores in order
-    unsigned int nMVMUSPerCore = N_CONSTANT_MVMUS_PER_CORE;
+    unsigned int nMVMUSPerCore = model_->getHardwareConfig().nConstantMVMUsPerCore_;
     nVCores_ += (nVMVMUs_ - 2 - 1)/nMVMUSPerCore + 1; 
     // -2 accounts for virtual MVMUs 0 and 1 which are reserved for input and output
 
@@ -363,123 +374,72 @@ void Partitioner::assignVTilesInVMVMUOrder() {
     vcore2vtile_[1] = 1;
 
     // Assign virtual cores to virtual tiles in order
-    nVTiles_ += (nVCores_ - 2 - 1)/N_CORES_PER_TILE + 1; // -2 accounts for virtual cores 0 and 1 which are reserved for input and output
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    nVTiles_ += (nVCores_ - 2 - 1)/nCoresPerTile + 1; // -2 accounts for virtual cores 0 and 1 which are reserved for input and output
     for(unsigned int vCore = 2; vCore < nVCores_; ++vCore) {
-        vcore2vtile_[vCore] = (vCore - 2)/N_CORES_PER_TILE + 2;;
-    }
-
-}
-
-void partitionGraphWithKaHIP
-    (unsigned int numNodes, 
-    unsigned int numEdges, 
-    unsigned int numNodesPerPartition, 
-    std::vector<std::pair<unsigned int, unsigned int>>* edges, 
-    std::vector<unsigned int>& result) {
-
-    // Output graph file
-    std::ofstream graphOut("kahip_input.graph", std::ofstream::out);
-    graphOut << numNodes << " " << numEdges << " 11" << std::endl;
-    for(unsigned int node = 0; node < numNodes; ++node) {
-        graphOut << "1 "; // All nodes have weight 1
-        for(auto edge : edges[node]) {
-            graphOut << edge.first + 1 /* destination node */ << " " << edge.second /* edge weight */ << " ";
-        }
-        graphOut << std::endl;
-    }
-    graphOut.close();
-
-    // Execute KaHIP command
-    std::stringstream cmd; 
-    unsigned int numPartitions = (numNodes - 1)/numNodesPerPartition + 1;
-    double imbalance = (double)(numPartitions*numNodesPerPartition)/((double)(numNodes)) - 1;
-    cmd << "kaffpaE ./kahip_input.graph --k=" << numPartitions << " --imbalance="<< imbalance
-        << " --preconfiguration=strong --output_filename=kahip_partition_result"; 
-    system(cmd.str().c_str());
-
-    // Input result file
-    std::ifstream resultIn("kahip_partition_result", std::ifstream::in);
-    for(unsigned int node = 0; node < numNodes; ++node) {
-        resultIn >> result[node];
+        vcore2vtile_[vCore] = (vCore - 2)/nCoresPerTile + 2;;
     }
-    resultIn.close();
 
 }
 
-void Partitioner::assignVCoresWithKaHIP() {
-
-    // Build graph
-    unsigned int numNodes = nVMVMUs_ - 2;
-    unsigned int numEdges = 0;
-    std::vector<std::pair<unsigned int, unsigned int>> edges[numNodes];
+// A producer sends its vector once to each other node that uses it
+void Partitioner::addAffinityEdges(MultilevelPartitioner& graph, bool vCores) {
+    std::vector<unsigned int> dsts;
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(op)) {
-            unsigned int producerNodeID = getVMVMU(producer) - 2;
+        if(ProducerOperation* producer = opcast<ProducerOperation>(op)) {
+            unsigned int src = vCores ? getVCore(producer) : getVMVMU(producer);
+            if(src < 2) {
+                continue;
+            }
+            dsts.clear();
             for(auto u = producer->user_begin(); u != producer->user_end(); ++u) {
                 ConsumerOperation* consumer = *u;
-                unsigned int consumerNodeID = getVMVMU(consumer) - 2;
-                if(producerNodeID != consumerNodeID) {
-                    edges[producerNodeID].push_back(std::make_pair(consumerNodeID, producer->length()));
-                    edges[consumerNodeID].push_back(std::make_pair(producerNodeID, producer->length()));
-                    ++numEdges;
+                unsigned int dst = vCores ? getVCore(consumer) : getVMVMU(consumer);
+                if(dst >= 2 && dst != src
+                        && std::find(dsts.begin(), dsts.end(), dst) == dsts.end()) {
+                    dsts.push_back(dst);
+                    graph.addEdge(src - 2, dst - 2, producer->length());
                 }
             }
         }
     }
+}
 
-    // Call KaHIP
-    unsigned int nMVMUSPerCore = N_CONSTANT_MVMUS_PER_CORE;
-    unsigned int numNodesPerPartition = nMVMUSPerCore;
-    std::vector<unsigned int> result(numNodes);
-    partitionGraphWithKaHIP(numNodes, numEdges, numNodesPerPartition, edges, result);
+void Partitioner::assignVCoresWithMultilevel() {
+
+    // Partition virtual MVMUs, except for the reserved input and output ones
+    MultilevelPartitioner graph(nVMVMUs_ - 2,
+        model_->getHardwareConfig().nConstantMVMUsPerCore_);
+    addAffinityEdges(graph, false);
+    std::vector<unsigned int> result;
+    graph.partition(result);
 
     // Process result
-    unsigned int numPartitions = (numNodes - 1)/numNodesPerPartition + 1;
-    nVCores_ = numPartitions + 2;
+    nVCores_ = graph.getNParts() + 2;
     vmvmu2vcore_.resize(nVMVMUs_);
     vmvmu2vcore_[0] = 0;
     vmvmu2vcore_[1] = 1;
-    for(unsigned int node = 0; node < numNodes; ++node) {
+    for(unsigned int node = 0; node < result.size(); ++node) {
         vmvmu2vcore_[node + 2] = result[node] + 2;
     }
 
 }
 
-void Partitioner::assignVTilesWithKaHIP() {
+void Partitioner::assignVTilesWithMultilevel() {
 
-    // Build graph
-    unsigned int numNodes = nVCores_ - 2;
-    unsigned int numEdges = 0;
-    std::vector<std::pair<unsigned int, unsigned int>> edges[numNodes];
-    for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
-        Operation* op = *it;
-        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(op)) {
-            unsigned int producerNodeID = getVCore(producer) - 2;
-            for(auto u = producer->user_begin(); u != producer->user_end(); ++u) {
-                ConsumerOperation* consumer = *u;
-                unsigned int consumerNodeID = getVCore(producer) - 2;
-                if(producerNodeID != consumerNodeID) {
-                    edges[producerNodeID].push_back(std::make_pair(consumerNodeID, producer->length()));
-                    edges[consumerNodeID].push_back(std::make_pair(producerNodeID, producer->length()));
-                    ++numEdges;
-                }
-            }
-        }
-    }
-
-    // Call KaHIP
-    unsigned int numNodesPerPartition = N_CORES_PER_TILE;
-    std::vector<unsigned int> result(numNodes);
-    partitionGraphWithKaHIP(numNodes, numEdges, numNodesPerPartition, edges, result);
+    // Partition virtual cores, except for the reserved input and output ones
+    MultilevelPartitioner graph(nVCores_ - 2, model_->getHardwareConfig().nCoresPerTile_);
+    addAffinityEdges(graph, true);
+    std::vector<unsigned int> result;
+    graph.partition(result);
 
     // Process result
-    unsigned int numPartitions = (numNodes - 1)/numNodesPerPartition + 1;
-    nVTiles_ = numPartitions + 2;
+    nVTiles_ = graph.getNParts() + 2;
     vcore2vtile_.resize(nVCores_);
     vcore2vtile_[0] = 0;
     vcore2vtile_[1] = 1;
-    for(unsigned int node = 0; node < numNodes; ++node) {
+    for(unsigned int node = 0; node < result.size(); ++node) {
         vcore2vtile_[node + 2] = result[node] + 2;
     }
 
@@ -490,8 +450,8 @@ void Partitioner::insertLoadsAndStores() {
     // Insert loads and stores across cores
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;        
-        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(op)) {
-            if(!dynamic_cast<PseudoInputOperation*>(op)) {
+        if(ProducerOperation* producer = opcast<ProducerOperation>(op)) {
+            if(!opcast<PseudoInputOperation>(op)) {
                 StoreOperation* store = NULL;
                 std::map<unsigned int, LoadOperation*> loads;
                 for(auto u = producer->user_begin(); u != producer->user_end(); ) {
@@ -499,12 +459,12 @@ void Partitioner::insertLoadsAndStores() {
                     ++u; // replaceOperand may remove consumer from producer's users
                     if(getVCore(producer) != getVCore(consumer)) {
                         if(store == NULL) {
-                            store = new StoreOperation(model_, producer);
+                            store = new (model_->getArena()) StoreOperation(model_, producer);
                             numStores_ += store->length();
                             cloneAssignment(producer, store);
                         }
                         if(loads[getVCore(consumer)] == NULL) {
-                            LoadOperation* load = new LoadOperation(model_, store);
+                            LoadOperation* load = new (model_->getArena()) LoadOperation(model_, store);
                             numLoads_ += load->length();
                             cloneAssignment(consumer, load);
                             loads[getVCore(consumer)] = load;
@@ -522,17 +482,17 @@ void Partitioner::insertSendsAndRecives() {
     // Insert sends and receives across tiles
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(StoreOperation* store = dynamic_cast<StoreOperation*>(op)) {
+        if(StoreOperation* store = opcast<StoreOperation>(op)) {
             std::map<unsigned int, ReceiveOperation*> recvs;
             for(auto u = store->user_begin(); u != store->user_end(); ) {
                 TileMemoryReadOperation* read = *u;
                 ++u; // replaceSrc may remove read from store's users
                 if(getVTile(store) != getVTile(read)) {
                     if(recvs[getVTile(read)] == NULL) {
-                        SendOperation* send = new SendOperation(model_, store);
+                        SendOperation* send = new (model_->getArena()) SendOperation(model_, store);
                         numSends_ += send->length();
                         cloneAssignment(store, send);
-                        ReceiveOperation* recv = new ReceiveOperation(model_, send);
+                        ReceiveOperation* recv = new (model_->getArena()) ReceiveOperation(model_, send);
                         numReceives_ += recv->length();
                         cloneAssignment(read, recv);
                         recvs[getVTile(read)] = recv;
@@ -555,7 +515,7 @@ void Partitioner::insertInputAndOutput() {
         Operation* op = *it;
         std::list<Operation*>::iterator curr_it = it;
         ++it; // op might get removed from the graph
-        if(PseudoInputOperation* pseudoInput = dynamic_cast<PseudoInputOperation*>(op)) {
+        if(PseudoInputOperation* pseudoInput = opcast<PseudoInputOperation>(op)) {
             InputVectorTile* src = pseudoInput->getSrc();
             for(auto u = pseudoInput->user_begin(); u != pseudoInput->user_end(); ) {
                 ConsumerOperation* consumer = *u;
@@ -563,19 +523,19 @@ void Partitioner::insertInputAndOutput() {
                 if(loads[src][getVCore(consumer)] == NULL) {
                     if(recvs[src][getVTile(consumer)] == NULL) {
                         if(inputs[src] == NULL) {
-                            WriteInputOperation* input = new WriteInputOperation(model_, src);
+                            WriteInputOperation* input = new (model_->getArena()) WriteInputOperation(model_, src);
                             assignVMVMU(input, 0);
                             inputs[src] = input;
                         }
-                        SendOperation* send = new SendOperation(model_, inputs[src]);
+                        SendOperation* send = new (model_->getArena()) SendOperation(model_, inputs[src]);
                         numSends_ += send->length();
                         cloneAssignment(inputs[src], send);
-                        ReceiveOperation* recv = new ReceiveOperation(model_, send);
+                        ReceiveOperation* recv = new (model_->getArena()) ReceiveOperation(model_, send);
                         numReceives_ += recv->length();
                         cloneAssignment(consumer, recv);
                         recvs[src][getVTile(consumer)] = recv;
                     }
-                    LoadOperation* load = new LoadOperation(model_, recvs[src][getVTile(consumer)]);
+                    LoadOperation* load = new (model_->getArena()) LoadOperation(model_, recvs[src][getVTile(consumer)]);
                     numLoads_ += load->length();
                     cloneAssignment(consumer, load);
                     loads[src][getVCore(consumer)] = load;
@@ -583,20 +543,20 @@ void Partitioner::insertInputAndOutput() {
                 consumer->replaceOperand(pseudoInput, loads[src][getVCore(consumer)]);
             }
             unlink(curr_it);
-        } else if(PseudoOutputOperation* pseudoOutput = dynamic_cast<PseudoOutputOperation*>(op)) {
+        } else if(PseudoOutputOperation* pseudoOutput = opcast<PseudoOutputOperation>(op)) {
             OutputVectorTile* dst = pseudoOutput->getDst();
             for(unsigned int o = 0; o < pseudoOutput->numOperands(); ++o) {
                 ProducerOperation* producer = pseudoOutput->getOperand(o);
-                StoreOperation* store = new StoreOperation(model_, producer);
+                StoreOperation* store = new (model_->getArena()) StoreOperation(model_, producer);
                 numStores_ += store->length();
                 cloneAssignment(pseudoOutput, store);
-                SendOperation* send = new SendOperation(model_, store);
+                SendOperation* send = new (model_->getArena()) SendOperation(model_, store);
                 numSends_ += send->length();
                 cloneAssignment(pseudoOutput, send);
-                ReceiveOperation* recv = new ReceiveOperation(model_, send);
+                ReceiveOperation* recv = new (model_->getArena()) ReceiveOperation(model_, send);
                 numReceives_ += recv->length();
                 assignVMVMU(recv, 1);
-                ReadOutputOperation* output = new ReadOutputOperation(model_, recv, dst);
+                ReadOutputOperation* output = new (model_->getArena()) ReadOutputOperation(model_, recv, dst);
                 cloneAssignment(recv, output);
                 producer->removeUser(pseudoOutput);
             }
@@ -611,12 +571,12 @@ void Partitioner::insertCopies() {
     // Insert copy operations across producers and consumers that use different register spaces
     for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
         Operation* op = *it;
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(op)) {
-            bool isMatrixOperation = (dynamic_cast<MVMOperation*>(consumer) != NULL);
+        if(ConsumerOperation* consumer = opcast<ConsumerOperation>(op)) {
+            bool isMatrixOperation = (opcast<MVMOperation>(consumer) != NULL);
             if(isMatrixOperation) {
                 for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                     ProducerOperation* producer = consumer->getOperand(o);
-                    ALUVectorOperation* pALU = dynamic_cast<ALUVectorOperation*>(producer);
+                    ALUVectorOperation* pALU = opcast<ALUVectorOperation>(producer);
 
                     if(pALU != NULL && pALU->isResize()) { // the producer of MVM is resizeOp
                         ALUVectorOperation* resizeOp = pALU;
@@ -625,7 +585,7 @@ void Partitioner::insertCopies() {
                             bool isLastResize = true;
                             for(int ro = resizeOp->numOperands()-1; ro >= 0; --ro) {
                                 ProducerOperation* rProducer = resizeOp->getOperand(ro);
-                                ALUVectorOperation* rpALU = dynamic_cast<ALUVectorOperation*>(rProducer);
+                                ALUVectorOperation* rpALU = opcast<ALUVectorOperation>(rProducer);
 
                                 if(rpALU != NULL && rpALU->isResize()) {
                                     resizeOp = rpALU;
@@ -633,7 +593,8 @@ void Partitioner::insertCopies() {
                                     break;
                                 } else {
                                     if(rProducer->numUsers() > 1) {
-                                        CopyOperation* copy = new CopyOperation(model_, rProducer);
+                                        CopyOperation* copy = new (model_->getArena()) CopyOperation(model_, rProducer);
+                                        ++numCopies_;
                                         cloneAssignment(resizeOp, copy);
                                         resizeOp->replaceOperand(rProducer, copy);
                                     }
@@ -644,18 +605,20 @@ void Partitioner::insertCopies() {
                             }
                         }
                     } else { // the producer of MVM is not resizeOp
-                        bool producerIsMatrixOperation = (dynamic_cast<MVMOperation*>(producer) != NULL);
+                        bool producerIsMatrixOperation = (opcast<MVMOperation>(producer) != NULL);
                         bool producerHasMultipleUsers = (producer->numUsers() > 1);
 
                         // add copy operator for mvm-other connections
                         if(producerHasMultipleUsers) {
-                            CopyOperation* copy = new CopyOperation(model_, producer);
+                            CopyOperation* copy = new (model_->getArena()) CopyOperation(model_, producer);
+                            ++numCopies_;
                             cloneAssignment(consumer, copy);
                             consumer->replaceOperand(producer, copy);
                         } else if(producerIsMatrixOperation){
-                            MVMOperation* matOp = dynamic_cast<MVMOperation*>(producer);
+                            MVMOperation* matOp = opcast<MVMOperation>(producer);
                             if(matOp->isMVMLast()){
-                                CopyOperation* copy = new CopyOperation(model_, producer);
+                                CopyOperation* copy = new (model_->getArena()) CopyOperation(model_, producer);
+                                ++numCopies_;
                                 cloneAssignment(consumer, copy);
                                 consumer->replaceOperand(producer, copy);
                             }
@@ -669,7 +632,9 @@ void Partitioner::insertCopies() {
 }
 
 void Partitioner::unlink(std::list<Operation*>::iterator it) {
-    op2vmvmu_.erase(*it);
+    if(isVMVMUAssigned(*it)) {
+        op2vmvmu_[(*it)->id] = -1;
+    }
     model_->unlink(it);
 }
 
@@ -687,7 +652,7 @@ std::string Partitioner::printAssignment(Operation* op) {
     return ss.str();
 }
 
-void Partitioner::printReport(std::ofstream& report) {
+void Partitioner::printReport(std::ostream& report) {
     switch(gp_) {
         case CompilerOptions::GP_ROW_MAJOR:
             report << "graph partitioning scheme = row major" << std::endl;
@@ -695,8 +660,8 @@ void Partitioner::printReport(std::ofstream& report) {
         case CompilerOptions::GP_COL_MAJOR:
             report << "graph partitioning scheme = column major" << std::endl;
             break;
-        case CompilerOptions::GP_KAHIP: // FIXME: check whether KaHIP exists
-            report << "graph partitioning scheme = KaHIP" << std::endl;
+        case CompilerOptions::GP_MULTILEVEL:
+            report << "graph partitioning scheme = multilevel" << std::endl;
             break;
         case CompilerOptions::GP_RANDOM:
             report << "graph partitioning scheme = random" << std::endl;
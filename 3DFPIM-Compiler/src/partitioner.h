@@ -26,12 +26,13 @@ class Partitioner {
         unsigned int nVTiles_;
 
         std::vector<ConstantMatrixTile*> cmatTiles_;
-        std::map<Operation*, unsigned int> op2vmvmu_;
+        std::vector<int> op2vmvmu_;     /* Indexed by operation id, -1 if unassigned */
         std::map<ConstantMatrixTile*, unsigned int> cmat2vmvmu_;
         std::vector<unsigned int> vmvmu2vcore_;
         std::vector<unsigned int> vcore2vtile_;
 
         bool isVMVMUAssigned(Operation* op);
+        void setVMVMU(Operation* op, unsigned int vMVMU);
         void assignVMVMU(Operation* op, unsigned int vMVMU);
         void reassignVMVMU(ALUVectorOperation* op, unsigned int vMVMU);
         void assignVMVMUsAndSpreadAffinity();
@@ -42,14 +43,16 @@ class Partitioner {
         unsigned int numStores_ = 0;
         unsigned int numSends_ = 0;
         unsigned int numReceives_ = 0;
+        unsigned int numCopies_ = 0;
 
         void assignVMVMUsInRowMajor();
         void assignVMVMUsInColMajor();
         void assignVMVMUsRandomly();
         void assignVCoresInVMVMUOrder();
-        void assignVCoresWithKaHIP(); 
+        void assignVCoresWithMultilevel();
         void assignVTilesInVMVMUOrder();
-        void assignVTilesWithKaHIP();
+        void assignVTilesWithMultilevel();
+        void addAffinityEdges(MultilevelPartitioner& graph, bool vCores);
 
         void insertLoadsAndStores();
         void insertSendsAndRecives();
@@ -76,8 +79,14 @@ class Partitioner {
 
         void cloneAssignment(Operation* cloneFrom, Operation* cloneTo);
 
+        unsigned int getNumLoads() { return numLoads_; }
+        unsigned int getNumStores() { return numStores_; }
+        unsigned int getNumSends() { return numSends_; }
+        unsigned int getNumReceives() { return numReceives_; }
+        unsigned int getNumCopies() { return numCopies_; }
+
         std::string printAssignment(Operation* op);
-        void printReport(std::ofstream& report);
+        void printReport(std::ostream& report);
 
 };
 
@@ -6,8 +6,13 @@
 * LICENSE file.
 *******************************************************************************/
 
+#include <algorithm>
 #include <assert.h>
+#include <climits>
+#include <iostream>
+#include <map>
 #include <sstream>
+#include <stdlib.h>
 
 #include "3dfpim.h"
 
@@ -16,6 +21,212 @@
 #include "partitioner.h"
 #include "placer.h"
 
+// Bytes sent between each pair of virtual tiles, in both directions
+typedef std::vector<std::map<unsigned int, unsigned long long>> TileTraffic;
+
+static const unsigned int MAX_SWAP_PASSES = 16;
+
+// Dimension-ordered routing takes the Manhattan distance on the mesh
+static unsigned int hops(unsigned int meshWidth, unsigned int pTile1, unsigned int pTile2) {
+    return abs((int) (pTile1%meshWidth) - (int) (pTile2%meshWidth))
+        + abs((int) (pTile1/meshWidth) - (int) (pTile2/meshWidth));
+}
+
+static unsigned long long hopBytes(unsigned int meshWidth,
+    TileTraffic& traffic, std::vector<unsigned int>& placement) {
+
+    unsigned long long total = 0;
+    for(unsigned int vTile = 0; vTile < traffic.size(); ++vTile) {
+        for(auto& t : traffic[vTile]) {
+            total += t.second*hops(meshWidth, placement[vTile], placement[t.first]);
+        }
+    }
+    return total/2;
+}
+
+// Hop-weighted bytes between vTile placed on pTile and all other tiles
+// except `skip`, whose placement is about to change
+static unsigned long long hopBytes(unsigned int meshWidth, TileTraffic& traffic,
+    std::vector<unsigned int>& placement, unsigned int vTile, 
+    unsigned int pTile, unsigned int skip) {
+
+    unsigned long long total = 0;
+    for(auto& t : traffic[vTile]) {
+        if(t.first != skip) {
+            total += t.second*hops(meshWidth, pTile, placement[t.first]);
+        }
+    }
+    return total;
+}
+
+// Place the tile that talks most to the placed ones next, on the free mesh
+// position closest to its partners. Any of the nPositions positions of the
+// mesh can be taken, so small models are not confined to the first row. The
+// first nReserved tiles keep their position.
+static void placeGreedily(unsigned int meshWidth, unsigned int nPositions,
+    unsigned int nReserved, TileTraffic& traffic, std::vector<unsigned int>& placement) {
+
+    unsigned int nTiles = traffic.size();
+    std::vector<bool> placed(nTiles, false);
+    std::vector<bool> occupied(nPositions, false);
+    std::vector<unsigned long long> attraction(nTiles, 0);
+    placement.assign(nTiles, 0);
+    for(unsigned int vTile = 0; vTile < nTiles; ++vTile) {
+        unsigned int next = vTile;
+        if(vTile >= nReserved) {
+            next = nTiles;
+            for(unsigned int v = nReserved; v < nTiles; ++v) {
+                if(!placed[v] && (next == nTiles || attraction[v] > attraction[next])) {
+                    next = v;
+                }
+            }
+        }
+        unsigned int pTile = next;
+        if(next >= nReserved) {
+            unsigned long long best = 0;
+            pTile = nPositions;
+            for(unsigned int p = nReserved; p < nPositions; ++p) {
+                if(occupied[p]) {
+                    continue;
+                }
+                unsigned long long cost = 0;
+                for(auto& t : traffic[next]) {
+                    if(placed[t.first]) {
+                        cost += t.second*hops(meshWidth, p, placement[t.first]);
+                    }
+                }
+                if(pTile == nPositions || cost < best) {
+                    pTile = p;
+                    best = cost;
+                }
+            }
+        }
+        placement[next] = pTile;
+        placed[next] = true;
+        occupied[pTile] = true;
+        for(auto& t : traffic[next]) {
+            attraction[t.first] += t.second;
+        }
+    }
+
+}
+
+// Move tiles to other mesh positions, swapping with the tile there if any,
+// while that lowers the hop-weighted bytes
+static void improveBySwapping(unsigned int meshWidth, unsigned int nPositions,
+    unsigned int nReserved, TileTraffic& traffic, std::vector<unsigned int>& placement) {
+
+    unsigned int nTiles = traffic.size();
+    std::vector<unsigned int> occupant(nPositions, nTiles);
+    for(unsigned int vTile = 0; vTile < nTiles; ++vTile) {
+        occupant[placement[vTile]] = vTile;
+    }
+    bool improved = true;
+    for(unsigned int pass = 0; pass < MAX_SWAP_PASSES && improved; ++pass) {
+        improved = false;
+        for(unsigned int a = nReserved; a < nTiles; ++a) {
+            for(unsigned int pb = nReserved; pb < nPositions; ++pb) {
+                unsigned int pa = placement[a];
+                unsigned int b = occupant[pb];
+                if(pb == pa || (b != nTiles && b < a)) {
+                    // Pairs of tiles are tried once
+                    continue;
+                }
+                long long before = hopBytes(meshWidth, traffic, placement, a, pa, b);
+                long long after = hopBytes(meshWidth, traffic, placement, a, pb, b);
+                if(b != nTiles) {
+                    before += hopBytes(meshWidth, traffic, placement, b, pb, a);
+                    after += hopBytes(meshWidth, traffic, placement, b, pa, a);
+                }
+                if(after < before) {
+                    placement[a] = pb;
+                    occupant[pb] = a;
+                    occupant[pa] = b;
+                    if(b != nTiles) {
+                        placement[b] = pa;
+                    }
+                    improved = true;
+                }
+            }
+        }
+    }
+
+}
+
+// Cut the tiles, in the given order, into at most nChips consecutive groups
+// of at most `capacity` tiles, minimizing the bytes sent between groups. The
+// first two tiles stay together.
+static std::vector<std::vector<unsigned int>> assignChips(TileTraffic& traffic,
+    std::vector<unsigned int>& order, unsigned int capacity, unsigned int nChips) {
+
+    const unsigned int nTiles = order.size();
+    assert(nTiles <= capacity*nChips && "The tiles do not fit in the chips");
+    std::vector<unsigned int> position(nTiles);
+    for(unsigned int p = 0; p < nTiles; ++p) {
+        position[order[p]] = p;
+    }
+    std::vector<unsigned long long> toEarlier(nTiles, 0);
+    for(unsigned int p = 0; p < nTiles; ++p) {
+        for(auto& t : traffic[order[p]]) {
+            if(position[t.first] < p) {
+                toEarlier[p] += t.second;
+            }
+        }
+    }
+
+    // cost[k][end] is the fewest crossing bytes with k groups covering
+    // the positions before end, and begin[k][end] where the last one starts
+    std::vector<std::vector<unsigned long long>> cost(nChips + 1,
+        std::vector<unsigned long long>(nTiles + 1, ULLONG_MAX));
+    std::vector<std::vector<unsigned int>> begin(nChips + 1,
+        std::vector<unsigned int>(nTiles + 1, 0));
+    cost[0][0] = 0;
+    for(unsigned int end = 1; end <= nTiles; ++end) {
+        // Bytes between the positions [b, end) and the ones before b
+        unsigned long long crossing = 0;
+        for(unsigned int b = end; b-- > 0 && end - b <= capacity; ) {
+            crossing += toEarlier[b];
+            for(auto& t : traffic[order[b]]) {
+                if(position[t.first] > b && position[t.first] < end) {
+                    crossing -= t.second;
+                }
+            }
+            if(b == 1) {
+                continue;
+            }
+            for(unsigned int k = 1; k <= nChips; ++k) {
+                if(cost[k - 1][b] != ULLONG_MAX && cost[k - 1][b] + crossing < cost[k][end]) {
+                    cost[k][end] = cost[k - 1][b] + crossing;
+                    begin[k][end] = b;
+                }
+            }
+        }
+    }
+
+    // Fewer chips win ties
+    unsigned int nGroups = 1;
+    for(unsigned int k = 1; k <= nChips; ++k) {
+        if(cost[k][nTiles] < cost[nGroups][nTiles]) {
+            nGroups = k;
+        }
+    }
+    assert(cost[nGroups][nTiles] != ULLONG_MAX);
+
+    std::vector<unsigned int> cut(nGroups + 1, nTiles);
+    for(unsigned int k = nGroups; k > 0; --k) {
+        cut[k - 1] = begin[k][cut[k]];
+    }
+
+    std::vector<std::vector<unsigned int>> groups(nGroups);
+    for(unsigned int k = 0; k < nGroups; ++k) {
+        for(unsigned int p = cut[k]; p < cut[k + 1]; ++p) {
+            groups[k].push_back(order[p]);
+        }
+    }
+    return groups;
+
+}
+
 Placer::Placer(ModelImpl* model,Partitioner* partitioner)
     : model_(model), partitioner_(partitioner)
 {
@@ -26,30 +237,138 @@ Placer::Placer(ModelImpl* model,Partitioner* partitioner)
 
 void Placer::assignPTiles() {
 
-    // Assign virtual tiles to physical tiles
+    // Collect the traffic between virtual tiles from the send/receive pairs
     nPTiles_ = partitioner_->getNVTiles();
-    vtile2ptile_.resize(partitioner_->getNVTiles());
-    vtile2ptile_[0] = 0; // Reserve tile 0 for sending inputs
-    vtile2ptile_[1] = 1; // Reserve tile 1 for receiving outputs
-    for(unsigned int vTile = 2; vTile < partitioner_->getNVTiles(); ++vTile) {
-        // TODO: implement a more intelligent virtual to physical tile assignment
-        unsigned int pTile = vTile;
-        vtile2ptile_[vTile] = pTile;
+    TileTraffic traffic(nPTiles_);
+    std::vector<unsigned int> firstMVM(nPTiles_, UINT_MAX);
+    for(auto it = model_->op_begin(); it != model_->op_end(); ++it) {
+        if(MVMOperation* mvm = opcast<MVMOperation>(*it)) {
+            unsigned int vTile = partitioner_->getVTile(mvm);
+            firstMVM[vTile] = std::min(firstMVM[vTile], (unsigned int) mvm->id);
+        }
+        if(SendOperation* send = opcast<SendOperation>(*it)) {
+            unsigned int src = partitioner_->getVTile(send);
+            unsigned int dst = partitioner_->getVTile(send->getDst());
+            if(src != dst) {
+                traffic[src][dst] += send->length();
+                traffic[dst][src] += send->length();
+            }
+        }
+    }
+
+    // Split the tiles across chips when one chip cannot hold them all
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    const unsigned int meshWidth = hardware.meshWidth_;
+    if(nPTiles_ > hardware.nMaxTiles()) {
+        std::cerr << "Placement failed: the model needs " << nPTiles_ << " tiles, or "
+            << (nPTiles_ - 1)/hardware.nTilesPerChip() + 1 << " chip(s) of "
+            << hardware.nTilesPerChip() << " tiles, but N_CHIPS is "
+            << hardware.nChips_ << std::endl;
+        assert(0 && "Placement failed: not enough chips");
+    }
+    std::vector<std::vector<unsigned int>> chipVTiles;
+    if(nPTiles_ <= hardware.nTilesPerChip() || hardware.nChips_ == 1) {
+        chipVTiles.resize(1);
+        for(unsigned int vTile = 0; vTile < nPTiles_; ++vTile) {
+            chipVTiles[0].push_back(vTile);
+        }
+    } else {
+        // Tiles 0 and 1 first, then the others in the order the network uses them
+        std::vector<unsigned int> order;
+        for(unsigned int vTile = 0; vTile < nPTiles_; ++vTile) {
+            order.push_back(vTile);
+        }
+        std::stable_sort(order.begin() + 2, order.end(),
+            [&](unsigned int a, unsigned int b) { return firstMVM[a] < firstMVM[b]; });
+        chipVTiles = assignChips(traffic, order, hardware.nTilesPerChip(), hardware.nChips_);
+    }
+
+    // Assign virtual tiles to positions on the mesh of each chip, minimizing
+    // the hop-weighted bytes. Positions 0 and 1 stay reserved for sending
+    // inputs and receiving outputs. Both the greedy placement and the
+    // in-order one are improved by moving tiles, and the better of the two is
+    // kept. The tiles of a chip then take consecutive physical tile ids in
+    // row-major order of their positions, since the later passes index
+    // tiles densely; getMeshPosition gives the position of each.
+    const unsigned int nPositions = hardware.nTilesPerChip();
+    nChips_ = chipVTiles.size();
+    vtile2ptile_.assign(nPTiles_, 0);
+    ptile2chip_.clear();
+    ptile2mesh_.clear();
+    hopBytes_ = 0;
+    inOrderHopBytes_ = 0;
+    std::vector<unsigned int> vtile2chip(nPTiles_);
+    for(unsigned int chip = 0; chip < nChips_; ++chip) {
+
+        std::vector<unsigned int>& vTiles = chipVTiles[chip];
+        std::map<unsigned int, unsigned int> local;
+        for(unsigned int l = 0; l < vTiles.size(); ++l) {
+            local[vTiles[l]] = l;
+        }
+        TileTraffic chipTraffic(vTiles.size());
+        for(unsigned int l = 0; l < vTiles.size(); ++l) {
+            for(auto& t : traffic[vTiles[l]]) {
+                auto partner = local.find(t.first);
+                if(partner != local.end()) {
+                    chipTraffic[l][partner->second] = t.second;
+                }
+            }
+        }
+
+        const unsigned int nReserved = (chip == 0) ? 2 : 0;
+        std::vector<unsigned int> inOrder(vTiles.size());
+        for(unsigned int l = 0; l < vTiles.size(); ++l) {
+            inOrder[l] = l;
+        }
+        std::vector<unsigned int> placement;
+        inOrderHopBytes_ += hopBytes(meshWidth, chipTraffic, inOrder);
+        improveBySwapping(meshWidth, nPositions, nReserved, chipTraffic, inOrder);
+        placeGreedily(meshWidth, nPositions, nReserved, chipTraffic, placement);
+        improveBySwapping(meshWidth, nPositions, nReserved, chipTraffic, placement);
+        if(hopBytes(meshWidth, chipTraffic, inOrder) < hopBytes(meshWidth, chipTraffic, placement)) {
+            placement.swap(inOrder);
+        }
+        hopBytes_ += hopBytes(meshWidth, chipTraffic, placement);
+
+        std::vector<unsigned int> positions(placement);
+        std::sort(positions.begin(), positions.end());
+        const unsigned int offset = ptile2chip_.size();
+        for(unsigned int l = 0; l < vTiles.size(); ++l) {
+            vtile2ptile_[vTiles[l]] = offset + (std::lower_bound(positions.begin(),
+                positions.end(), placement[l]) - positions.begin());
+            vtile2chip[vTiles[l]] = chip;
+        }
+        for(unsigned int position : positions) {
+            ptile2chip_.push_back(chip);
+            ptile2mesh_.push_back(position);
+        }
+
     }
 
+    interChipBytes_ = 0;
+    for(unsigned int vTile = 0; vTile < nPTiles_; ++vTile) {
+        for(auto& t : traffic[vTile]) {
+            if(vtile2chip[vTile] != vtile2chip[t.first]) {
+                interChipBytes_ += t.second;
+            }
+        }
+    }
+    interChipBytes_ /= 2;
+
 }
 
 void Placer::assignPCores() {
 
     // Assign virtual cores to physical cores
-    nPCores_ = nPTiles_*N_CORES_PER_TILE;
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    nPCores_ = nPTiles_*nCoresPerTile;
     vcore2pcore_.resize(partitioner_->getNVCores());
     std::vector<unsigned int> nPCoresPerPTile(nPTiles_);
     for(unsigned int vCore = 0; vCore < partitioner_->getNVCores(); ++vCore) {
         unsigned int vTile = partitioner_->getVTile(vCore);
         unsigned int pTile = vtile2ptile_[vTile];
         unsigned int pCore = nPCoresPerPTile[pTile]++;
-        assert(pCore < N_CORES_PER_TILE);
+        assert(pCore < nCoresPerTile);
         vcore2pcore_[vCore] = pCore;
     }
 
@@ -58,7 +377,8 @@ void Placer::assignPCores() {
 void Placer::assignPMVMUs() {
 
     // Assign virtual MVMUs to physical MVMUs
-    unsigned int nMVMUSPerCore = N_CONSTANT_MVMUS_PER_CORE;
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    unsigned int nMVMUSPerCore = model_->getHardwareConfig().nConstantMVMUsPerCore_;
     nPMVMUs_ = nPCores_*nMVMUSPerCore;
     vmvmu2pmvmu_.resize(partitioner_->getNVMVMUs());
     std::vector<unsigned int> nPMVMUsPerPCore(nPCores_);
@@ -67,8 +387,8 @@ void Placer::assignPMVMUs() {
         unsigned int pCore = vcore2pcore_[vCore];
         unsigned int vTile = partitioner_->getVTile(vCore);
         unsigned int pTile = vtile2ptile_[vTile];
-        unsigned int pMVMU = nPMVMUsPerPCore[pTile*N_CORES_PER_TILE + pCore];
-        nPMVMUsPerPCore[pTile*N_CORES_PER_TILE + pCore] += 1;
+        unsigned int pMVMU = nPMVMUsPerPCore[pTile*nCoresPerTile + pCore];
+        nPMVMUsPerPCore[pTile*nCoresPerTile + pCore] += 1;
         assert(pMVMU < nMVMUSPerCore);
         vmvmu2pmvmu_[vMVMU] = pMVMU;
     }
@@ -113,3 +433,26 @@ std::string Placer::printAssignment(Operation* op) {
     return ss.str();
 }
 
+void Placer::printReport(std::ostream& report) {
+    report << "# hop-weighted send bytes = " << hopBytes_ << std::endl;
+    report << "# hop-weighted send bytes with in-order placement = "
+        << inOrderHopBytes_ << std::endl;
+    if(model_->getHardwareConfig().nChips_ > 1) {
+        report << "# chips = " << nChips_ << std::endl;
+        report << "# inter-chip send bytes = " << interChipBytes_ << std::endl;
+        unsigned int first = 0;
+        for(unsigned int pTile = 1; pTile <= nPTiles_; ++pTile) {
+            if(pTile == nPTiles_ || ptile2chip_[pTile] != ptile2chip_[first]) {
+                report << "chip " << ptile2chip_[first] << ": tiles "
+                    << first << "-" << pTile - 1 << std::endl;
+                first = pTile;
+            }
+        }
+    }
+    const unsigned int meshWidth = model_->getHardwareConfig().meshWidth_;
+    for(unsigned int pTile = 0; pTile < nPTiles_; ++pTile) {
+        report << "tile " << pTile << ": mesh position ("
+            << ptile2mesh_[pTile]%meshWidth << ", " << ptile2mesh_[pTile]/meshWidth << ")" << std::endl;
+    }
+}
+
@@ -6,6 +6,10 @@
 * LICENSE file.
 *******************************************************************************/
 
+#include <fstream>
+#include <string>
+#include <vector>
+
 #include "common.h"
 
 class Placer {
@@ -23,6 +27,14 @@ class Placer {
         std::vector<unsigned int> vcore2pcore_;
         std::vector<unsigned int> vmvmu2pmvmu_;
 
+        unsigned long long hopBytes_;           /* Send bytes weighted by mesh hops */
+        unsigned long long inOrderHopBytes_;    /* The same with vTile N on pTile N */
+
+        unsigned int nChips_;                   /* Chips the tiles span */
+        std::vector<unsigned int> ptile2chip_;
+        std::vector<unsigned int> ptile2mesh_;  /* Row-major position on its chip's mesh */
+        unsigned long long interChipBytes_;     /* Send bytes between chips */
+
         void assignPTiles();
         void assignPCores();
         void assignPMVMUs();
@@ -34,6 +46,9 @@ class Placer {
         unsigned int getNPMVMUs() { return nPMVMUs_; }
         unsigned int getNPCores() { return nPCores_; }
         unsigned int getNPTiles() { return nPTiles_; }
+        unsigned int getNChips() { return nChips_; }
+        unsigned int getChip(unsigned int pTile) { return ptile2chip_[pTile]; }
+        unsigned int getMeshPosition(unsigned int pTile) { return ptile2mesh_[pTile]; }
         unsigned int getPMVMU(ConstantMatrixTile* tile);
         unsigned int getPTile(ConstantMatrixTile* tile);
         unsigned int getPCore(ConstantMatrixTile* tile);
@@ -42,6 +57,7 @@ class Placer {
         unsigned int getPCore(Operation* op);
 
         std::string printAssignment(Operation* op);
+        void printReport(std::ostream& report);
 
 };
 
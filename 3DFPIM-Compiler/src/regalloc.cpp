@@ -14,14 +14,14 @@
 *******************************************************************************/
 
 #include <assert.h>
-#include <bitset>
 #include <sstream>
 #include <algorithm>
 
 #include "3dfpim.h"
 
+#include "allocator.h"
+#include "arena.h"
 #include "linearizer.h"
-#include "memalloc.h"
 #include "model.h"
 #include "operations.h"
 #include "partitioner.h"
@@ -34,136 +34,96 @@
 
 #include <chrono>
 
-class CoreAllocator {
-
-    private:
-
-        std::bitset<REGISTERS_PER_CORE> memPool_;
+// Operations created while allocating a core are kept here instead of
+// being registered with the model and partitioner, so cores can be
+// allocated concurrently. Committing the cores in order gives the same ids
+// as allocating them one after another.
+class CoreAllocationState {
 
     public:
 
-        static const unsigned int OUT_OF_REGISTERS = REGISTERS_PER_CORE;
+        std::vector<Operation*> pendingOperations;
+        std::map<ProducerOperation*, unsigned int> pendingRegisters;
+        std::vector<std::pair<Operation*, Operation*>> clonedAssignments;
+
+        unsigned int numLoadsFromSpilling = 0;
+        unsigned int numStoresFromSpilling = 0;
+        unsigned int numUnspilledRegAccesses = 0;
+        unsigned int numSpilledRegAccesses = 0;
+        unsigned int numRematerializations = 0;
 
-        unsigned int allocate(unsigned int size);
-        void free(unsigned int pos, unsigned int size);
+        // Values rematerialized instead of spilled
+        std::vector<ProducerOperation*> rematerialized;
 
 };
 
-class SpillTracker {
+// Live ranges of the values held in data registers on one core. A core
+// program is straight-line code, so a value is live from its definition to
+// its last use. Values are numbered densely in the order they are first
+// used, and the values live during allocation are a bitvector over those
+// numbers, with a list of the live numbers to find spill candidates.
+class CoreLiveness {
 
     private:
 
-        std::map<ProducerOperation*, StoreOperation*> producer2spill;
-        std::map<ProducerOperation*, LoadOperation*> producer2reload;
-        std::map<LoadOperation*, ProducerOperation*> reload2producer;
+        std::vector<bool> isLive_;
+        std::vector<unsigned int> livePosition_;
+        std::vector<unsigned int> liveValues_;
+        std::vector<ProducerOperation*> values_;
+        std::vector<unsigned int> lastUse_;         /* Position of the last use in the core program */
 
     public:
 
-        bool isSpilled(ProducerOperation* producer) 
-            { return producer2spill.count(producer); }
-        bool hasLiveNowReload(ProducerOperation* producer) 
-            { return producer2reload.count(producer); }
-        bool isLiveNowReload(LoadOperation* load) 
-            { return reload2producer.count(load); }
-
-        StoreOperation* getSpillOperation
-            (ProducerOperation* producer);
-        LoadOperation* getLiveNowReload
-            (ProducerOperation* producer);
-        ProducerOperation* getOriginalProducer
-            (LoadOperation* load);
-
-        void setSpillOperation
-            (ProducerOperation* producer, StoreOperation* store);
-        void setLiveNowReload
-            (ProducerOperation* producer, LoadOperation* load);
-        void killLiveNowReload
-            (LoadOperation* load);
-
-        std::map<ProducerOperation*, LoadOperation*>::iterator 
-            reloads_begin() { return producer2reload.begin(); }
-        std::map<ProducerOperation*, LoadOperation*>::iterator 
-            reloads_end() { return producer2reload.end(); }
-
-};
-
-unsigned int CoreAllocator::allocate(unsigned int size) {
-    for(unsigned int i = 0; i <= REGISTER_FILE_SIZE - size; ++i) {
-        unsigned int j;
-        for(j = i; j < i + size; ++j) {
-            if(memPool_[j]) {
-                break;
-            }
+        unsigned int addValue(ProducerOperation* producer) {
+            values_.push_back(producer);
+            lastUse_.push_back(0);
+            isLive_.push_back(false);
+            livePosition_.push_back(0);
+            return values_.size() - 1;
         }
-        if(j == i + size) {
-            for(unsigned int k = i; k < j; ++k) {
-                memPool_.set(k);
-            }
-            return REGISTER_FILE_START_ADDRESS + i;
-        } else {
-            i = j;
+        void addUse(int value, unsigned int position) { lastUse_[value] = position; }
+        bool isLiveAfter(int value, unsigned int position)
+            { return value >= 0 && lastUse_[value] > position; }
+
+        bool isLive(int value) { return value >= 0 && isLive_[value]; }
+        void setLive(int value) {
+            isLive_[value] = true;
+            livePosition_[value] = liveValues_.size();
+            liveValues_.push_back(value);
+        }
+        void setDead(int value) {
+            isLive_[value] = false;
+            unsigned int last = liveValues_.back();
+            liveValues_[livePosition_[value]] = last;
+            livePosition_[last] = livePosition_[value];
+            liveValues_.pop_back();
         }
-    }
-    return OUT_OF_REGISTERS;
-}
-
-void CoreAllocator::free(unsigned int reg, unsigned int size) {
-    unsigned int pos = reg - REGISTER_FILE_START_ADDRESS;
-    for(unsigned int i = pos; i < pos + size; ++i) {
-        assert(memPool_[i] && "Attempt to free unallocated registers!");
-        memPool_.reset(i);
-    }
-}
-
-StoreOperation* SpillTracker::getSpillOperation(ProducerOperation* producer) {
-    assert(isSpilled(producer));
-    return producer2spill[producer];
-}
-
-LoadOperation* SpillTracker::getLiveNowReload(ProducerOperation* producer) {
-    assert(hasLiveNowReload(producer));
-    return producer2reload[producer];
-}
-
-ProducerOperation* SpillTracker::getOriginalProducer(LoadOperation* load) {
-    assert(isLiveNowReload(load));
-    return reload2producer[load];
-}
-
-void SpillTracker::setSpillOperation
-    (ProducerOperation* producer, StoreOperation* store) {
-    
-    assert(!producer2spill.count(producer) && "Register allocation error: spilling a register that has already been spilled!");
-    producer2spill[producer] = store;
-}
 
-void SpillTracker::setLiveNowReload
-    (ProducerOperation* producer, LoadOperation* load) {
-    
-    assert(!hasLiveNowReload(producer) && "Register allocation error: reloading a spilled register that has already been reloaded!");
-    producer2reload[producer] = load;
-    reload2producer[load] = producer;
-}
+        // The live values in address order, the order spill candidates were
+        // always tried in
+        std::vector<ProducerOperation*> getLiveValues() {
+            std::vector<ProducerOperation*> live;
+            for(unsigned int value : liveValues_) {
+                live.push_back(values_[value]);
+            }
+            std::sort(live.begin(), live.end());
+            return live;
+        }
 
-void SpillTracker::killLiveNowReload(LoadOperation* load) {
-    // check if a load to producer exist
-    assert(isLiveNowReload(load));
-    ProducerOperation* producer = reload2producer[load];
-    producer2reload.erase(producer);
-    reload2producer.erase(load);
-}
+};
 
 RegisterAllocator::RegisterAllocator
     (ModelImpl* model, Partitioner* partitioner, 
-    Placer* placer, MemoryAllocator* memoryAllocator, Linearizer* linearizer)
+    Placer* placer, Linearizer* linearizer)
     : model_(model), partitioner_(partitioner), 
-    placer_(placer), memoryAllocator_(memoryAllocator), linearizer_(linearizer)
+    placer_(placer), linearizer_(linearizer)
 {
     // times two => for optimistic allocation
     op2reg_size = model->op_count * 2;
     op2reg_ = new int [op2reg_size];
     for(int i = 0; i < op2reg_size; i++)
         op2reg_[i] = -1;
+    valueNumber_.assign(model->op_count, -1);
     registerAllocation();
 }
 
@@ -189,22 +149,23 @@ void RegisterAllocator::assignReservedInputRegister(ProducerOperation* producer)
         "Cannot assign reserved input registers to matrix operations that write to reserved output registers!");
     assert(producer->numUsers() == 1 && "Producer serving a matrix operation can only have one user");
 
+    const HardwareConfig& hardware = model_->getHardwareConfig();
     ConsumerOperation* consumer = *(producer->user_begin());
     unsigned int reg;
-    if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(consumer)) {
-        reg = INPUT_REGISTERS_START_ADDRESS + 
-            placer_->getPMVMU(mvm)*MVMU_DIM;
-    } else if(ALUVectorOperation* alu = dynamic_cast<ALUVectorOperation*>(consumer)) {
+    if(MVMOperation* mvm = opcast<MVMOperation>(consumer)) {
+        reg = hardware.inputRegistersStartAddress() + 
+            placer_->getPMVMU(mvm)*hardware.mvmuDim_;
+    } else if(ALUVectorOperation* alu = opcast<ALUVectorOperation>(consumer)) {
         if (alu->isResize()) {
             // first operand
             if (producer == alu->getOperand(0)) {
-                reg = INPUT_REGISTERS_START_ADDRESS +
-                    placer_->getPMVMU(alu)*MVMU_DIM;
+                reg = hardware.inputRegistersStartAddress() +
+                    placer_->getPMVMU(alu)*hardware.mvmuDim_;
             }
             // second operand
             else {
-                reg = INPUT_REGISTERS_START_ADDRESS +
-                    placer_->getPMVMU(alu)*MVMU_DIM +
+                reg = hardware.inputRegistersStartAddress() +
+                    placer_->getPMVMU(alu)*hardware.mvmuDim_ +
                     alu->length() - producer->length();
             }
         }
@@ -219,12 +180,13 @@ void RegisterAllocator::assignReservedOutputRegister
     
     assert(writesToReservedOutputRegister(producer) && 
         "Cannot assign reserved output registers to non-matrix operations");
+    const HardwareConfig& hardware = model_->getHardwareConfig();
     unsigned int reg;
     if(MVMOperation* mvm = 
-        dynamic_cast<MVMOperation*>(producer)) {
+        opcast<MVMOperation>(producer)) {
         
-        reg = OUTPUT_REGISTERS_START_ADDRESS + 
-            placer_->getPMVMU(mvm)*MVMU_DIM;
+        reg = hardware.outputRegistersStartAddress() + 
+            placer_->getPMVMU(mvm)*hardware.mvmuDim_;
     } else {
         assert(0 && "Cannot assign reserved output register to producer that is not a matrix operation");
     }
@@ -234,17 +196,17 @@ void RegisterAllocator::assignReservedOutputRegister
 bool RegisterAllocator::readsFromReservedInputRegister
     (ConsumerOperation* consumer) {
 
-    return (dynamic_cast<MVMOperation*>(consumer) != NULL);
+    return (opcast<MVMOperation>(consumer) != NULL);
 }
 
 bool RegisterAllocator::writesToReservedOutputRegister
     (ProducerOperation* producer) {
     
-    return (dynamic_cast<MVMOperation*>(producer) != NULL);
+    return (opcast<MVMOperation>(producer) != NULL);
 }
 
 bool RegisterAllocator::producerDoesNotWriteToRegister(ProducerOperation* producer) {
-    if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(producer)){
+    if(MVMOperation* mvm = opcast<MVMOperation>(producer)){
         if(!mvm->isMVMLast()) return true;
     }
     return false;
@@ -255,23 +217,81 @@ unsigned int RegisterAllocator::getRegister(ProducerOperation* producer) {
     return op2reg_[producer->id];
 }
 
+int RegisterAllocator::getValueNumber(ProducerOperation* producer) {
+    // Spill code created during allocation has no id and is never numbered
+    if(producer->id < 0 || producer->id >= (int) valueNumber_.size()) {
+        return -1;
+    }
+    return valueNumber_[producer->id];
+}
+
+void RegisterAllocator::assignRegister
+    (ProducerOperation* producer, unsigned int reg, CoreAllocationState& state) {
+
+    if(producer->id < 0) {
+        assert(!state.pendingRegisters.count(producer) && "Cannot reassign register");
+        state.pendingRegisters[producer] = reg;
+    } else {
+        assignRegister(producer, reg);
+    }
+}
+
+unsigned int RegisterAllocator::getRegister
+    (ProducerOperation* producer, CoreAllocationState& state) {
+
+    if(producer->id < 0) {
+        assert(state.pendingRegisters.count(producer) && "Register has not been assigned!");
+        return state.pendingRegisters[producer];
+    }
+    return getRegister(producer);
+}
+
 void RegisterAllocator::registerAllocation() {
-    // Allocate registers
-    for(unsigned int pTile = 0; pTile < placer_->getNPTiles(); ++pTile) {
-        for(unsigned int pCore = 0; pCore < N_CORES_PER_TILE; ++pCore) {
-            allocateReservedInputRegisters(pTile, pCore);
-            allocateReservedOutputRegisters(pTile, pCore);
-            allocateDataRegisters(pTile, pCore);
-        }
+    // Allocate registers; cores never share registers, so they are allocated
+    // concurrently and their spill code is committed in core order
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    unsigned int nCores = placer_->getNPTiles()*nCoresPerTile;
+    std::vector<CoreAllocationState> states(nCores);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(unsigned int core = 0; core < nCores; ++core) {
+        unsigned int pTile = core/nCoresPerTile;
+        unsigned int pCore = core%nCoresPerTile;
+        model_->deferOperations(&states[core].pendingOperations);
+        allocateReservedInputRegisters(pTile, pCore);
+        allocateReservedOutputRegisters(pTile, pCore);
+        allocateDataRegisters(pTile, pCore, states[core]);
+        model_->deferOperations(NULL);
+    }
+
+    for(CoreAllocationState& state : states) {
+        commit(state);
     }
 
 }
 
+void RegisterAllocator::commit(CoreAllocationState& state) {
+    model_->commitOperations(state.pendingOperations);
+    for(auto& clone : state.clonedAssignments) {
+        partitioner_->cloneAssignment(clone.first, clone.second);
+    }
+    for(auto& reg : state.pendingRegisters) {
+        assignRegister(reg.first, reg.second);
+    }
+    numLoadsFromSpilling_ += state.numLoadsFromSpilling;
+    numStoresFromSpilling_ += state.numStoresFromSpilling;
+    numUnspilledRegAccesses_ += state.numUnspilledRegAccesses;
+    numSpilledRegAccesses_ += state.numSpilledRegAccesses;
+    numSpillsAvoided_ += state.rematerialized.size();
+    numRematerializations_ += state.numRematerializations;
+}
+
 void RegisterAllocator::allocateReservedInputRegisters
     (unsigned int pTile, unsigned int pCore) {
     
-    // Assign reserved input registers and ensure no overlap in live ranges
-    std::set<ProducerOperation*> liveNow;
+    // Assign reserved input registers and ensure no overlap in live ranges;
+    // a producer is live while it occupies its register
+    std::vector<ProducerOperation*> occupant(model_->getHardwareConfig().registersPerCore(), NULL);
     std::list<CoreOperation*>& coreOperationList = 
         linearizer_->getCoreOperationList(pTile, pCore);
     
@@ -280,39 +300,40 @@ void RegisterAllocator::allocateReservedInputRegisters
     for(auto op = coreOperationList.rbegin(); 
         op != coreOperationList.rend(); ++op) {
         // if producer => remove from the liveness
-        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(*op)) {
-            liveNow.erase(producer);
+        if(ProducerOperation* producer = opcast<ProducerOperation>(*op)) {
+            if(isRegisterAssigned(producer) && occupant[getRegister(producer)] == producer) {
+                occupant[getRegister(producer)] = NULL;
+            }
         }
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(*op)) {
+        if(ConsumerOperation* consumer = opcast<ConsumerOperation>(*op)) {
             // if the consumer is MVM op.
             if(readsFromReservedInputRegister(consumer)) {
                 for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                     ProducerOperation* producer = consumer->getOperand(o);
-                    if(!liveNow.count(producer) && !isResize(producer)) {
+                    bool isLive = isRegisterAssigned(producer)
+                        && occupant[getRegister(producer)] == producer;
+                    if(!isLive && !isResize(producer)) {
 
                         // do not affect live range if it is non-last MVM
-                        if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(producer)){
+                        if(MVMOperation* mvm = opcast<MVMOperation>(producer)){
                             if(!mvm->isMVMLast()) continue;
                         }
 
-                        liveNow.insert(producer);
                         assignReservedInputRegister(producer);
-                        for(ProducerOperation* p : liveNow) {
-                            if(p != producer && getRegister(p) == 
-                                getRegister(producer)) {
-                                // NOTE: The linearizer ensures that there are no live range conflicts by placing matrix operation operands immediately before they are consumed
-                                assert(0 && "Register allocation error: conflict detected in live ranges of operations using the same reserved input registers!");
-                            }
+                        if(occupant[getRegister(producer)] != NULL) {
+                            // NOTE: The linearizer ensures that there are no live range conflicts by placing matrix operation operands immediately before they are consumed
+                            assert(0 && "Register allocation error: conflict detected in live ranges of operations using the same reserved input registers!");
                         }
+                        occupant[getRegister(producer)] = producer;
                     }
                 }
             }
         }
 
         // allocate input registers to mvmOp-feeding operations
-        if (ProducerOperation* producer = dynamic_cast<ProducerOperation*>(*op)) {
+        if (ProducerOperation* producer = opcast<ProducerOperation>(*op)) {
             for (auto u = producer->user_begin(); u != producer->user_end(); ++u) {
-                if (ALUVectorOperation* alu = dynamic_cast<ALUVectorOperation*>(*u)) {
+                if (ALUVectorOperation* alu = opcast<ALUVectorOperation>(*u)) {
                     if (alu->isResize()) {
                         assignReservedInputRegister(producer);
                     }
@@ -325,37 +346,38 @@ void RegisterAllocator::allocateReservedInputRegisters
 void RegisterAllocator::allocateReservedOutputRegisters
     (unsigned int pTile, unsigned int pCore) {
     
-    // Assign reserved output registers and ensure no overlap in live ranges
-    std::set<ProducerOperation*> liveNow;
+    // Assign reserved output registers and ensure no overlap in live ranges;
+    // a producer is live while it occupies its register
+    std::vector<ProducerOperation*> occupant(model_->getHardwareConfig().registersPerCore(), NULL);
     std::list<CoreOperation*>& coreOperationList = 
         linearizer_->getCoreOperationList(pTile, pCore);
     
     for(auto op = coreOperationList.rbegin(); 
         op != coreOperationList.rend(); ++op) {
 
-        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(*op)) {
-            liveNow.erase(producer);
+        if(ProducerOperation* producer = opcast<ProducerOperation>(*op)) {
+            if(isRegisterAssigned(producer) && occupant[getRegister(producer)] == producer) {
+                occupant[getRegister(producer)] = NULL;
+            }
         }
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(*op)) {
+        if(ConsumerOperation* consumer = opcast<ConsumerOperation>(*op)) {
             for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                 ProducerOperation* producer = consumer->getOperand(o);
                 // if the producer is MVM
-                if(MVMOperation* mvm = dynamic_cast<MVMOperation*>(producer)){
+                if(MVMOperation* mvm = opcast<MVMOperation>(producer)){
                     if(!mvm->isMVMLast()) continue;
                 }
                 if(writesToReservedOutputRegister(producer)) {
-                    if(!liveNow.count(producer)) {
-                        liveNow.insert(producer);
+                    if(!isRegisterAssigned(producer) || occupant[getRegister(producer)] != producer) {
                         assignReservedOutputRegister(producer);
-                        for(ProducerOperation* p : liveNow) {
-                            if(p != producer && getRegister(p) == getRegister(producer)) {
-                                // NOTE: The linearizer ensures that there are no 
-                                // live range conflicts by placing matrix operation 
-                                // consumers immediately after they are produced
-                                assert(0 && "Register allocation error: conflict detected in live ranges of \
-                                        operations using the same reserved output registers!");
-                            }
+                        if(occupant[getRegister(producer)] != NULL) {
+                            // NOTE: The linearizer ensures that there are no 
+                            // live range conflicts by placing matrix operation 
+                            // consumers immediately after they are produced
+                            assert(0 && "Register allocation error: conflict detected in live ranges of \
+                                    operations using the same reserved output registers!");
                         }
+                        occupant[getRegister(producer)] = producer;
                     }
                 }
             }
@@ -363,105 +385,50 @@ void RegisterAllocator::allocateReservedOutputRegisters
     }
 }
 
-void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int pCore) {
+void RegisterAllocator::analyzeLiveness
+    (std::list<CoreOperation*>& coreOperationList, CoreLiveness& liveness) {
 
-    // Live range analysis
-    std::list<CoreOperation*>& coreOperationList = 
-        linearizer_->getCoreOperationList(pTile, pCore);
-
-    int listSize = coreOperationList.size() + 1;
-
-    // set of pointers
-    ProducerOperation*** liveIn = new ProducerOperation** [listSize];
-    int* liveIn_count = new int [listSize];
-
-    for(int i = 0; i < listSize; i++){
-        liveIn_count[i] = 0;
-    }
-    
-    int scale_init = 100000;
-    int scale_factor = scale_init;
-
-    int currOpId = coreOperationList.size() - 1;
-    int nextOpId = coreOperationList.size();
-
-    for(auto op = coreOperationList.rbegin(); op != coreOperationList.rend(); ++op) {
-
-        while(listSize / scale_factor <= liveIn_count[nextOpId]) scale_factor /= 10;
-
-        liveIn[currOpId] = new ProducerOperation* [listSize / scale_factor];
-
-        auto array_end = std::copy(liveIn[nextOpId]
-            , liveIn[nextOpId] 
-            + liveIn_count[nextOpId]
-            , liveIn[currOpId]);
-
-        // remove a producer when necessary
-        if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(*op)){
-            array_end = std::remove(liveIn[currOpId]
-                , liveIn[currOpId] + liveIn_count[nextOpId]
-                , producer);
+    // Number the values read from data registers and find their last uses
+    unsigned int position = 0;
+    for(auto op = coreOperationList.begin(); op != coreOperationList.end(); ++op, ++position) {
+        ConsumerOperation* consumer = opcast<ConsumerOperation>(*op);
+        if(consumer == NULL || readsFromReservedInputRegister(consumer)) {
+            continue;
         }
-        liveIn_count[currOpId] = std::distance(liveIn[currOpId], array_end);
-        
-        // Add operations consumed by the operation
-        bool scale_en = false;
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(*op)) {
-            // if not mvm operation
-            if(!readsFromReservedInputRegister(consumer)) {
-                // then we iterate over the mvm operations
-                for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
-                    ProducerOperation* producer = consumer->getOperand(o);
-                    // not mvm operation
-                    if(!writesToReservedOutputRegister(producer) && !isResize(producer)) {
-                        // livePtr
-                        bool exist = false;
-                        for(int i = 0; i < liveIn_count[currOpId]; i++){
-                            if(liveIn[currOpId][i] == producer){
-                               exist = true;
-                               break;
-                            }
-                        }
-                        if(!exist){
-                            liveIn[currOpId][liveIn_count[currOpId]++] = producer;
-                        }
-                        // if the size exceeds the threshold => scale the array
-                        if(liveIn_count[currOpId] == listSize / scale_factor){
-                            scale_en = true;
-                            break;
-                        }
-                    }
+        for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
+            ProducerOperation* producer = consumer->getOperand(o);
+            if(!writesToReservedOutputRegister(producer) && !isResize(producer)) {
+                int value = getValueNumber(producer);
+                if(value < 0) {
+                    assert(producer->id >= 0 && "Cannot number an operation without an id");
+                    value = valueNumber_[producer->id] = liveness.addValue(producer);
                 }
+                liveness.addUse(value, position);
             }
         }
-
-        if(scale_en) {
-            scale_factor /= 10;
-            delete [] liveIn[currOpId];
-            liveIn_count[currOpId] = 0;
-            --op;
-            continue;
-        }
-        nextOpId = currOpId--;
-        scale_factor = scale_init;
     }
-        
+}
+
+void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int pCore, CoreAllocationState& state) {
+
+    // Live range analysis
+    std::list<CoreOperation*>& coreOperationList = 
+        linearizer_->getCoreOperationList(pTile, pCore);
+    CoreLiveness liveness;
+    analyzeLiveness(coreOperationList, liveness);
+
     // Allocate data registers
-    CoreAllocator allocator;
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    CoreAllocator allocator(hardware.registerFileStartAddress(), hardware.registerFileSize_);
     SpillTracker spillTracker;
-    std::set<ProducerOperation*> liveNow;
     unsigned int spillAddressReg = allocator.allocate(1);
     
-    currOpId = 0;
-    nextOpId = 1;
+    // Operations inserted for spilling are not visited, so the position
+    // stays that of the original program the liveness was computed on
+    unsigned int currOpId = 0;
     for(auto op = coreOperationList.begin(); op != coreOperationList.end(); ++op) {
-        // check if the size overflows
-        nextOpId = currOpId + 1;
-
-        ProducerOperation** liveOut = liveIn[nextOpId];
-        int liveOut_count = liveIn_count[nextOpId];
 
-        if(ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(*op)) {
+        if(ConsumerOperation* consumer = opcast<ConsumerOperation>(*op)) {
             // iterate over the consumers!
             // find only the consumer which does not read from reserved ones
             if(!readsFromReservedInputRegister(consumer)) {
@@ -474,11 +441,50 @@ void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int p
                         // if the producer is live + has been reloaded
                         // do not require additional thing
                         // it is already live and nothing special
-                        if(liveNow.count(producer) || 
+                        if(liveness.isLive(getValueNumber(producer)) || 
                             spillTracker.isLiveNowReload
-                            (dynamic_cast<LoadOperation*>(producer))) {
+                            (opcast<LoadOperation>(producer)) ||
+                            spillTracker.isLiveNowRematerialization(producer)) {
                             
-                            numUnspilledRegAccesses_ += producer->length();
+                            state.numUnspilledRegAccesses += producer->length();
+
+                        // Rematerialized operands are recomputed instead of reloaded
+                        } else if(spillTracker.isRematerialized(producer)) {
+                            ++state.numRematerializations;
+                            ProducerOperation* rematerialization;
+                            SetImmediateOperation* seti = NULL;
+                            if(SetImmediateOperation* constant = opcast<SetImmediateOperation>(producer)) {
+                                state.numUnspilledRegAccesses += producer->length();
+                                rematerialization = new (model_->getArena())
+                                    SetImmediateOperation(model_, constant->getImmediate(), constant->length());
+                            } else {
+                                // Load again from the tile memory the value was loaded from;
+                                // the address is filled in by tile memory allocation
+                                state.numSpilledRegAccesses += producer->length();
+                                LoadOperation* original = opcast<LoadOperation>(producer);
+                                seti = new (model_->getArena()) SetImmediateOperation(model_, 0);
+                                state.clonedAssignments.push_back(std::make_pair(producer, seti));
+                                assignRegister(seti, spillAddressReg, state);
+                                LoadOperation* load;
+                                // The source may be read by other cores allocated concurrently
+                                #pragma omp critical (regalloc)
+                                load = new (model_->getArena()) LoadOperation(model_, original->getSrc(0));
+                                state.numLoadsFromSpilling += load->length();
+                                load->addTileMemoryAddressOperand(seti);
+                                rematerialization = load;
+                            }
+                            state.clonedAssignments.push_back(std::make_pair(producer, rematerialization));
+                            unsigned int reg = 
+                                allocateRegistersWithSpilling
+                                (rematerialization->length(), state, allocator, liveness, 
+                                spillTracker, spillAddressReg, coreOperationList, op);
+                            assignRegister(rematerialization, reg, state);
+                            consumer->replaceOperand(producer, rematerialization);
+                            if(seti != NULL) {
+                                coreOperationList.insert(op, seti);
+                            }
+                            coreOperationList.insert(op, opcast<CoreOperation>(rematerialization));
+                            spillTracker.setLiveNowRematerialization(rematerialization);
 
                         // it indicates that the producer is not live
                         // or is spilled ...
@@ -490,40 +496,39 @@ void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int p
                             // i.e., the producer is not load & producer is not live
                             if(spillTracker.hasLiveNowReload(producer)) {
                                 // If already reloaded, reuse reload
-                                numUnspilledRegAccesses_ += producer->length();
+                                state.numUnspilledRegAccesses += producer->length();
                                 LoadOperation* load = 
                                     spillTracker.getLiveNowReload(producer);
                                 consumer->replaceOperand(producer, load);
                             // not to be reloaded
                             } else {
                                 // Reload from spilled register
-                                numSpilledRegAccesses_ += producer->length();
+                                state.numSpilledRegAccesses += producer->length();
 
                                 // retrieve spill operation for the module
                                 StoreOperation* spillOp = 
                                     spillTracker.getSpillOperation(producer);
+                                // The address is filled in by tile memory allocation
                                 SetImmediateOperation* seti = 
-                                    new SetImmediateOperation
-                                    (model_, memoryAllocator_->
-                                    getTileMemoryAddress(spillOp));
-                                partitioner_->cloneAssignment(producer, seti);
-                                assignRegister(seti, spillAddressReg);
+                                    new (model_->getArena()) SetImmediateOperation(model_, 0);
+                                state.clonedAssignments.push_back(std::make_pair(producer, seti));
+                                assignRegister(seti, spillAddressReg, state);
 
                                 // new load operation 
                                 // for the spilled (store) operation
-                                LoadOperation* load = new LoadOperation(model_, spillOp);
+                                LoadOperation* load = new (model_->getArena()) LoadOperation(model_, spillOp);
 
 
-                                numLoadsFromSpilling_ += load->length();
+                                state.numLoadsFromSpilling += load->length();
                                 load->addTileMemoryAddressOperand(seti);
-                                partitioner_->cloneAssignment(producer, load);
+                                state.clonedAssignments.push_back(std::make_pair(producer, load));
 
                                 // allocate register for the load operation
                                 unsigned int reg = 
                                     allocateRegistersWithSpilling
-                                    (load->length(), allocator, liveNow, 
+                                    (load->length(), state, allocator, liveness, 
                                     spillTracker, spillAddressReg, coreOperationList, op);
-                                assignRegister(load, reg);
+                                assignRegister(load, reg, state);
 
                                 consumer->replaceOperand(producer, load);
                                 coreOperationList.insert(op, seti);
@@ -540,38 +545,30 @@ void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int p
                 for(unsigned int o = 0; o < consumer->numOperands(); ++o) {
                     ProducerOperation* producer = consumer->getOperand(o);
                     if(!writesToReservedOutputRegister(producer) && !isResize(producer)) {
-                        if(liveNow.count(producer)) {
-                            // iterate over the live In
-                            bool exist = false;
-                            for(int i = 0; i < liveOut_count; i++){
-                                if(liveOut[i] == producer){
-                                   exist = true;
-                                   break;
-                                }
-                            }
-                            if(!exist){
-                                liveNow.erase(producer);
-                                allocator.free(getRegister(producer), producer->length());
+                        int value = getValueNumber(producer);
+                        if(liveness.isLive(value)) {
+                            if(!liveness.isLiveAfter(value, currOpId)) {
+                                liveness.setDead(value);
+                                allocator.free(getRegister(producer, state), producer->length());
                             }
                         }
+                        else if(spillTracker.isLiveNowRematerialization(producer)) {
+                            // Rematerializations are freed right after the operation they were made for
+                            spillTracker.killLiveNowRematerialization(producer);
+                            allocator.free(getRegister(producer, state), producer->length());
+                        }
                         else if(LoadOperation* load = 
-                            dynamic_cast<LoadOperation*>(producer)) {
+                            opcast<LoadOperation>(producer)) {
                             
                             assert(spillTracker.isLiveNowReload(load));
                             ProducerOperation* originalProducer = 
                                 spillTracker.getOriginalProducer(load);
 
-                            // iterate over the live In
-                            bool exist = false;
-                            for(int i = 0; i < liveOut_count; i++){
-                                if(liveOut[i] == producer){
-                                   exist = true;
-                                   break;
-                                }
-                            }
-                            if(!exist){
+                            // Reloads have no value number, so they are freed
+                            // right after the operation they were made for
+                            if(!liveness.isLiveAfter(getValueNumber(load), currOpId)) {
                                 spillTracker.killLiveNowReload(load);
-                                allocator.free(getRegister(load), load->length());
+                                allocator.free(getRegister(load, state), load->length());
                             }
                         } 
                         else {
@@ -584,24 +581,17 @@ void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int p
 
         // Allocate register for new operation
         if(ProducerOperation* producer = 
-            dynamic_cast<ProducerOperation*>(*op)) {
-
-            // iterate over the live In
-            bool exist = false;
-            for(int i = 0; i < liveOut_count; i++){
-                if(liveOut[i] == producer){
-                   exist = true;
-                   break;
-                }
-            }
-            if(exist){
+            opcast<ProducerOperation>(*op)) {
+
+            int value = getValueNumber(producer);
+            if(liveness.isLiveAfter(value, currOpId)) {
                 unsigned int reg = 
                     allocateRegistersWithSpilling
-                    (producer->length(), allocator, 
-                    liveNow, spillTracker, 
+                    (producer->length(), state, allocator, 
+                    liveness, spillTracker, 
                     spillAddressReg, coreOperationList, op);
-                assignRegister(producer, reg);
-                liveNow.insert(producer);
+                assignRegister(producer, reg, state);
+                liveness.setLive(value);
             } else {
                 // Producer already assigned to a reserved input or output register
                 assert(isRegisterAssigned(producer) || 
@@ -611,23 +601,32 @@ void RegisterAllocator::allocateDataRegisters(unsigned int pTile, unsigned int p
         currOpId++;
     }
 
-    int max = 0;
-    for(int i = 0; i < listSize - 1; i++){
-        if(max < liveIn_count[i])
-            max = liveIn_count[i];
+    // Values rematerialized at all their uses no longer need the original
+    std::set<Operation*> unused;
+    for(ProducerOperation* producer : state.rematerialized) {
+        if(producer->numUsers() == 0) {
+            unused.insert(producer);
+            if(LoadOperation* load = opcast<LoadOperation>(producer)) {
+                // Nor its address, and its source is read one time less
+                ProducerOperation* address = load->getOperand(0);
+                if(address->numUsers() == 1) {
+                    unused.insert(address);
+                }
+                #pragma omp critical (regalloc)
+                load->getSrc(0)->removeUser(load);
+            }
+        }
     }
-
-    for(int i = 0; i < listSize - 1; i++){
-        delete [] liveIn[i];
+    if(!unused.empty()) {
+        coreOperationList.remove_if([&unused](CoreOperation* op) { return unused.count(op); });
     }
-    delete [] liveIn;
-    delete [] liveIn_count;
 }
 
 unsigned int RegisterAllocator::allocateRegistersWithSpilling
     (unsigned int length, 
+    CoreAllocationState& state,
     CoreAllocator& allocator, 
-    std::set<ProducerOperation*>& liveNow, 
+    CoreLiveness& liveness, 
     SpillTracker& spillTracker, 
     unsigned int spillAddressReg, 
     std::list<CoreOperation*>& coreOperationList, 
@@ -635,7 +634,7 @@ unsigned int RegisterAllocator::allocateRegistersWithSpilling
 
 
     // TODO: Better heuristic for which is the best register to free (e.g., the one which will be used the latest into the future)
-    ConsumerOperation* consumer = dynamic_cast<ConsumerOperation*>(*op);
+    ConsumerOperation* consumer = opcast<ConsumerOperation>(*op);
     unsigned int reg = allocator.allocate(length);
     if(reg != CoreAllocator::OUT_OF_REGISTERS) {
         return reg;
@@ -651,7 +650,7 @@ unsigned int RegisterAllocator::allocateRegistersWithSpilling
             if(consumer == NULL || !consumer->uses(producerToKill) && 
                     !consumer->uses(reloadToKill)) {
                 removeLoad.insert(reloadToKill);
-                allocator.free(getRegister(reloadToKill), reloadToKill->length());
+                allocator.free(getRegister(reloadToKill, state), reloadToKill->length());
                 reg = allocator.allocate(length);
                 if(reg != CoreAllocator::OUT_OF_REGISTERS) {
                     break;
@@ -668,27 +667,36 @@ unsigned int RegisterAllocator::allocateRegistersWithSpilling
         // If unable to kill enough reloads, 
         // then spill live operations that are not used by this operation
         std::set<ProducerOperation*> removeList;
-        for(ProducerOperation* spillCandidate : liveNow) {
+        for(ProducerOperation* spillCandidate : liveness.getLiveValues()) {
             if(consumer == NULL || !consumer->uses(spillCandidate)) {
                 assert(spillCandidate != NULL);
-                unsigned int vTileIndex = partitioner_->getVTile(spillCandidate);
-                unsigned int spillLength = spillCandidate->length();
-                unsigned int address = memoryAllocator_->memalloc(vTileIndex, spillLength);
+                removeList.insert(spillCandidate);
+                if(isRematerializable(spillCandidate)) {
+                    // Constants and loaded values are cheaper to set or load
+                    // again at each later use than to store and reload
+                    spillTracker.setRematerialized(spillCandidate);
+                    state.rematerialized.push_back(spillCandidate);
+                    allocator.free(getRegister(spillCandidate, state), spillCandidate->length());
+                    reg = allocator.allocate(length);
+                    if(reg != CoreAllocator::OUT_OF_REGISTERS) {
+                        break;
+                    }
+                    continue;
+                }
+                // The spill slot is allocated with the rest of tile memory
                 SetImmediateOperation* setiStore = 
-                    new SetImmediateOperation(model_, address);
-                partitioner_->cloneAssignment(spillCandidate, setiStore);
-                assignRegister(setiStore, spillAddressReg);
-                StoreOperation* store = new StoreOperation(model_, spillCandidate);
-                numStoresFromSpilling_ += store->length();
-                partitioner_->cloneAssignment(spillCandidate, store);
-                memoryAllocator_->assignTileMemoryAddress(store, address);
+                    new (model_->getArena()) SetImmediateOperation(model_, 0);
+                state.clonedAssignments.push_back(std::make_pair(spillCandidate, setiStore));
+                assignRegister(setiStore, spillAddressReg, state);
+                StoreOperation* store = new (model_->getArena()) StoreOperation(model_, spillCandidate);
+                state.numStoresFromSpilling += store->length();
+                state.clonedAssignments.push_back(std::make_pair(spillCandidate, store));
                 store->addTileMemoryAddressOperand(setiStore);
                 coreOperationList.insert(op, setiStore);
                 coreOperationList.insert(op, store);
-                removeList.insert(spillCandidate);
 
                 spillTracker.setSpillOperation(spillCandidate, store);
-                allocator.free(getRegister(spillCandidate), spillCandidate->length());
+                allocator.free(getRegister(spillCandidate, state), spillCandidate->length());
                 reg = allocator.allocate(length);
                 if(reg != CoreAllocator::OUT_OF_REGISTERS) {
                     break;
@@ -698,7 +706,7 @@ unsigned int RegisterAllocator::allocateRegistersWithSpilling
 
         // remove late
         for(ProducerOperation* remove : removeList)
-            liveNow.erase(remove);
+            liveness.setDead(getValueNumber(remove));
 
         // then check functionality
         if(reg != CoreAllocator::OUT_OF_REGISTERS)
@@ -710,10 +718,14 @@ unsigned int RegisterAllocator::allocateRegistersWithSpilling
 
 }
 
+bool RegisterAllocator::isRematerializable(ProducerOperation* producer) {
+    return isa<SetImmediateOperation>(producer) || isa<LoadOperation>(producer);
+}
+
 bool RegisterAllocator::isResize(Operation* op) {
     bool isResize = false;
 
-    if (ALUVectorOperation* alu = dynamic_cast<ALUVectorOperation*>(op)) {
+    if (ALUVectorOperation* alu = opcast<ALUVectorOperation>(op)) {
         if (alu->isResize()) {
             isResize = true;
         }
@@ -722,18 +734,20 @@ bool RegisterAllocator::isResize(Operation* op) {
     return isResize;
 }
 
-void RegisterAllocator::printReport(std::ofstream& report) {
+void RegisterAllocator::printReport(std::ostream& report) {
     report << "# load bytes from spilling = " << numLoadsFromSpilling_ << std::endl;
     report << "# store bytes from spilling = " << numStoresFromSpilling_ << std::endl;
     report << "# load + store bytes from spilling = " << numLoadsFromSpilling_ + numStoresFromSpilling_ << std::endl;
     report << "# unspilled register accesses = " << numUnspilledRegAccesses_ << std::endl;
     report << "# spilled register accesses = " << numSpilledRegAccesses_ << std::endl;
     report << "% spilled register accesses = " << 100.0*numSpilledRegAccesses_/(numSpilledRegAccesses_ + numUnspilledRegAccesses_) << "%" << std::endl;
+    report << "# spills avoided by rematerialization = " << numSpillsAvoided_
+        << " (" << numRematerializations_ << " values set or loaded again)" << std::endl;
 }
 
 std::string RegisterAllocator::printAssignment(Operation* op) {
     std::stringstream ss;
-    if(ProducerOperation* producer = dynamic_cast<ProducerOperation*>(op)) {
+    if(ProducerOperation* producer = opcast<ProducerOperation>(op)) {
         if(isRegisterAssigned(producer)) {
             ss << "\nregister = " << getRegister(producer);
         }
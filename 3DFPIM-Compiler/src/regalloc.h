@@ -17,9 +17,13 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common.h"
 
+class CoreAllocationState;
+class CoreLiveness;
+
 class RegisterAllocator {
 
     private:
@@ -27,48 +31,64 @@ class RegisterAllocator {
         ModelImpl* model_;
         Partitioner* partitioner_;
         Placer* placer_;
-        MemoryAllocator* memoryAllocator_;
         Linearizer* linearizer_;
 
         int* op2reg_;
         int op2reg_size;
 
+        // Per-core number of each value held in a data register, by operation id
+        std::vector<int> valueNumber_;
+
         unsigned int numLoadsFromSpilling_ = 0;
         unsigned int numStoresFromSpilling_ = 0;
         unsigned int numUnspilledRegAccesses_ = 0;
         unsigned int numSpilledRegAccesses_ = 0;
+        unsigned int numSpillsAvoided_ = 0;
+        unsigned int numRematerializations_ = 0;
 
         void assignRegister(ProducerOperation* producer, unsigned int reg);
+        void assignRegister(ProducerOperation* producer, unsigned int reg, CoreAllocationState& state);
+        unsigned int getRegister(ProducerOperation* producer, CoreAllocationState& state);
         void assignReservedInputRegister(ProducerOperation* producer);
         void assignReservedOutputRegister(ProducerOperation* producer);
         bool readsFromReservedInputRegister(ConsumerOperation* consumer);
         bool writesToReservedOutputRegister(ProducerOperation* producer);
         bool producerDoesNotWriteToRegister(ProducerOperation* producer);
         bool isRegisterAssigned(ProducerOperation* producer);
+        int getValueNumber(ProducerOperation* producer);
+        void analyzeLiveness(std::list<CoreOperation*>& coreOperationList, CoreLiveness& liveness);
         void registerAllocation();
         void allocateReservedInputRegisters(unsigned int pTile, unsigned int pCore);
         void allocateReservedOutputRegisters(unsigned int pTile, unsigned int pCore);
-        void allocateDataRegisters(unsigned int pTile, unsigned int pCore);
+        void allocateDataRegisters(unsigned int pTile, unsigned int pCore, CoreAllocationState& state);
+        void commit(CoreAllocationState& state);
         unsigned int allocateRegistersWithSpilling
             (unsigned int length, 
+            CoreAllocationState& state,
             CoreAllocator& allocator, 
-            std::set<ProducerOperation*>& liveNow, 
+            CoreLiveness& liveness, 
             SpillTracker& spillTracker, 
             unsigned int spillAddressReg, 
             std::list<CoreOperation*>& coreOperationList, 
             std::list<CoreOperation*>::iterator& op);
+        bool isRematerializable(ProducerOperation* producer);
         bool isResize(Operation* op);
 
     public:
 
         RegisterAllocator(ModelImpl* model, 
             Partitioner* partitioner, Placer* placer, 
-            MemoryAllocator* memoryAllocator, Linearizer* linearizer);
+            Linearizer* linearizer);
 
         ~RegisterAllocator();
         unsigned int getRegister(ProducerOperation* producer);
 
-        void printReport(std::ofstream& report);
+        unsigned int getNumLoadsFromSpilling() { return numLoadsFromSpilling_; }
+        unsigned int getNumStoresFromSpilling() { return numStoresFromSpilling_; }
+        unsigned int getNumSpilledRegAccesses() { return numSpilledRegAccesses_; }
+        unsigned int getNumSpillsAvoided() { return numSpillsAvoided_; }
+
+        void printReport(std::ostream& report);
         std::string printAssignment(Operation* op);
 
 };
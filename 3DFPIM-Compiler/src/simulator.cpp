@@ -0,0 +1,344 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+#include "3dfpim.h"
+
+#include "linearizer.h"
+#include "model.h"
+#include "operations.h"
+#include "placer.h"
+#include "simulator.h"
+
+// Number of cycles needed to move a vector through a port of the given width
+unsigned int Simulator::getTransferCycles(unsigned int length, unsigned int maxWidth) {
+    unsigned int width;
+    for(width = maxWidth; !(length%width == 0); --width);
+    return length/width;
+}
+
+// Sends between chips take the chip-to-chip link instead of the mesh
+unsigned int Simulator::getNetworkCycles(const HardwareConfig& hardware, unsigned int length, bool crossesChip) {
+    if(crossesChip) {
+        return hardware.nocLatency_ + hardware.chipLinkLatency_
+            + getTransferCycles(length, hardware.chipLinkWidth_);
+    }
+    return hardware.nocLatency_ + getTransferCycles(length, hardware.maxSendRecvWidth_);
+}
+
+unsigned int Simulator::getALUCycles(const HardwareConfig& hardware, unsigned int length) {
+    return ((length - 1)/hardware.aluWidth_ + 1)*hardware.aluLatency_;
+}
+
+// A stack of the merged set is either reused from the previous sliding window
+// or shifted in, and the accumulated result is converted by the ADC at the end
+unsigned int Simulator::getMVMCycles(const HardwareConfig& hardware, bool reusesStack, bool isLast) {
+    unsigned int cycles = hardware.prechargeLatency_;
+    if(reusesStack) {
+        cycles += hardware.stackReuseLatency_;
+    } else {
+        cycles += hardware.stackShiftLatency_;
+    }
+    if(isLast) {
+        cycles += hardware.adcLatency_;
+    }
+    return cycles;
+}
+
+static const char* kindNames[] = {
+    "MVM", "MergedMVM", "ALU", "Set", "Copy", "Load", "Store", "Guard",
+    "Send", "Receive", "WriteInput", "ReadOutput", "PseudoInput", "PseudoOutput"
+};
+
+bool Simulator::reusesStack(MVMOperation* mvm) {
+    return mvm->numOperands() == 1 && mvm->getSlideId() != 0;
+}
+
+int Simulator::getDependency(Operation* op) {
+    switch(op->getKind()) {
+        case Operation::RECEIVE:
+            return opcast<ReceiveOperation>(op)->getSrc()->id;
+        case Operation::WRITE_INPUT:
+            return -1;
+        default:
+            if(TileMemoryReadOperation* read = opcast<TileMemoryReadOperation>(op)) {
+                assert(read->numSrcs() == 1);
+                return read->getSrc(0)->id;
+            }
+    }
+    return -1;
+}
+
+Simulator::Simulator(ModelImpl* model, Placer* placer, Linearizer* linearizer)
+    : model_(model)
+{
+    loadPrograms(placer, linearizer);
+    simulate();
+}
+
+Simulator::Simulator(ModelImpl* model, std::string programsFileName)
+    : model_(model)
+{
+    readPrograms(programsFileName);
+    simulate();
+}
+
+unsigned int Simulator::getPTile(unsigned int unit) {
+    if(unit < nCores_) {
+        return unit/model_->getHardwareConfig().nCoresPerTile_;
+    } else {
+        return unit - nCores_;
+    }
+}
+
+void Simulator::loadPrograms(Placer* placer, Linearizer* linearizer) {
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    nCores_ = placer->getNPCores();
+    nUnits_ = nCores_ + placer->getNPTiles();
+    nOperations_ = model_->op_count;
+    programs_.resize(nUnits_);
+    for(unsigned int unit = 0; unit < nUnits_; ++unit) {
+        unsigned int pTile = getPTile(unit);
+        std::vector<Operation*> program;
+        if(unit < nCores_) {
+            std::list<CoreOperation*>& coreOperationList =
+                linearizer->getCoreOperationList(pTile, unit%nCoresPerTile);
+            program.assign(coreOperationList.begin(), coreOperationList.end());
+        } else {
+            std::list<TileOperation*>& tileOperationList =
+                linearizer->getTileOperationList(pTile);
+            program.assign(tileOperationList.begin(), tileOperationList.end());
+        }
+        programs_[unit].resize(program.size());
+        for(unsigned int i = 0; i < program.size(); ++i) {
+            Operation* op = program[i];
+            SimulatorOperation& simOp = programs_[unit][i];
+            memset(&simOp, 0, sizeof(simOp));
+            simOp.kind = op->getKind();
+            simOp.length = op->length();
+            simOp.id = op->id;
+            simOp.dependency = getDependency(op);
+            if(MVMOperation* mvm = opcast<MVMOperation>(op)) {
+                simOp.reusesStack = reusesStack(mvm);
+                simOp.isMVMLast = mvm->isMVMLast();
+            }
+            if(SendOperation* send = opcast<SendOperation>(op)) {
+                simOp.crossesChip = placer->getChip(pTile)
+                    != placer->getChip(placer->getPTile(send->getDst()));
+            }
+        }
+    }
+}
+
+void Simulator::writePrograms(std::string fileName) {
+    std::ofstream out(fileName, std::ios::binary);
+    assert(out.good() && "Cannot open simulator programs file");
+    uint32_t header[3] = { nCores_, nUnits_, nOperations_ };
+    out.write((const char*) header, sizeof(header));
+    for(auto& program : programs_) {
+        uint64_t size = program.size();
+        out.write((const char*) &size, sizeof(size));
+        out.write((const char*) program.data(), size*sizeof(SimulatorOperation));
+    }
+    out.close();
+}
+
+void Simulator::readPrograms(std::string fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    assert(in.good() && "Cannot open simulator programs file");
+    uint32_t header[3];
+    in.read((char*) header, sizeof(header));
+    nCores_ = header[0];
+    nUnits_ = header[1];
+    nOperations_ = header[2];
+    programs_.resize(nUnits_);
+    for(auto& program : programs_) {
+        uint64_t size;
+        in.read((char*) &size, sizeof(size));
+        program.resize(size);
+        in.read((char*) program.data(), size*sizeof(SimulatorOperation));
+    }
+    assert(in.good() && "Truncated simulator programs file");
+}
+
+unsigned long long Simulator::accessTileMemory
+    (unsigned int pTile, unsigned long long start, unsigned int cycles) {
+
+    // The tile memory port is shared by all cores and the tile control unit
+    if(edramFree_[pTile] > start) {
+        start = edramFree_[pTile];
+    }
+    edramFree_[pTile] = start + cycles;
+    return start + cycles + model_->getHardwareConfig().edramLatency_;
+}
+
+void Simulator::simulate() {
+
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    pc_.resize(nUnits_);
+    time_.resize(nUnits_);
+    busy_.resize(nUnits_);
+    mvmuBusy_.resize(nUnits_);
+    edramFree_.resize(nUnits_ - nCores_);
+    finish_.assign(nOperations_, -1);
+
+    // Units are scheduled in order of their local time so that accesses to
+    // the shared tile memory are served in the order they are issued
+    typedef std::pair<unsigned long long, unsigned int> Event;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    for(unsigned int unit = 0; unit < nUnits_; ++unit) {
+        if(!programs_[unit].empty()) {
+            events.push(Event(0, unit));
+        }
+    }
+    while(!events.empty()) {
+        unsigned int unit = events.top().second;
+        events.pop();
+        if(issue(unit)) {
+            if(pc_[unit] < programs_[unit].size()) {
+                events.push(Event(time_[unit], unit));
+            }
+        }
+        for(unsigned int waiter : woken_) {
+            events.push(Event(time_[waiter], waiter));
+        }
+        woken_.clear();
+    }
+
+    for(unsigned int unit = 0; unit < nUnits_; ++unit) {
+        if(pc_[unit] != programs_[unit].size()) {
+            std::cerr << "Simulation deadlock: tile " << getPTile(unit);
+            if(unit < nCores_) {
+                std::cerr << " core " << unit%nCoresPerTile;
+            }
+            std::cerr << " is blocked on " << kindNames[programs_[unit][pc_[unit]].kind]
+                << " (operation " << programs_[unit][pc_[unit]].id << ")" << std::endl;
+            assert(0 && "Simulation deadlock!");
+        }
+        if(time_[unit] > latency_) {
+            latency_ = time_[unit];
+        }
+    }
+
+}
+
+bool Simulator::issue(unsigned int unit) {
+
+    SimulatorOperation& op = programs_[unit][pc_[unit]];
+    unsigned long long start = time_[unit];
+
+    // Wait for the data in tile memory (or on the network) to be ready
+    int dependency = op.dependency;
+    if(dependency >= 0) {
+        if(finish_[dependency] < 0) {
+            waiters_[dependency].push_back(unit);
+            return false;
+        }
+        if((unsigned long long) finish_[dependency] > start) {
+            start = finish_[dependency];
+        }
+    }
+
+    const HardwareConfig& hardware = model_->getHardwareConfig();
+    unsigned int pTile = getPTile(unit);
+    unsigned long long end = start;
+    switch(op.kind) {
+        case Operation::MVM:
+            end = start + getMVMCycles(hardware, op.reusesStack, op.isMVMLast);
+            mvmuBusy_[unit] += end - start;
+            complete(op.id, end);
+            break;
+        case Operation::ALU_VECTOR:
+        case Operation::SET_IMMEDIATE:
+        case Operation::COPY:
+            end = start + getALUCycles(hardware, op.length);
+            complete(op.id, end);
+            break;
+        case Operation::LOAD:
+        case Operation::STORE:
+            end = accessTileMemory(pTile, start,
+                getTransferCycles(op.length, hardware.maxLoadStoreWidth_));
+            complete(op.id, end);
+            break;
+        case Operation::MVM_GUARD:
+            end = start + hardware.edramLatency_;
+            complete(op.id, end);
+            break;
+        case Operation::SEND:
+            // The tile control unit is released once the data leaves the tile
+            end = accessTileMemory(pTile, start,
+                getTransferCycles(op.length, hardware.maxLoadStoreWidth_));
+            complete(op.id, end + getNetworkCycles(hardware, op.length, op.crossesChip));
+            break;
+        case Operation::RECEIVE:
+            end = accessTileMemory(pTile, start,
+                getTransferCycles(op.length, hardware.maxLoadStoreWidth_));
+            complete(op.id, end);
+            break;
+        case Operation::WRITE_INPUT:
+        case Operation::READ_OUTPUT:
+            complete(op.id, start);
+            break;
+        default:
+            assert(0 && "Unsupported operation for simulation!");
+    }
+
+    busy_[unit] += end - start;
+    time_[unit] = end;
+    ++pc_[unit];
+    return true;
+}
+
+void Simulator::complete(int id, unsigned long long time) {
+    assert(id >= 0 && id < (int) finish_.size());
+    finish_[id] = time;
+    auto w = waiters_.find(id);
+    if(w != waiters_.end()) {
+        woken_.insert(woken_.end(), w->second.begin(), w->second.end());
+        waiters_.erase(w);
+    }
+}
+
+void Simulator::printReport(std::ostream& report) {
+    const unsigned int nCoresPerTile = model_->getHardwareConfig().nCoresPerTile_;
+    unsigned int bottleneck = 0;
+    unsigned long long totalBusy = 0;
+    unsigned int nActiveCores = 0;
+    for(unsigned int unit = 0; unit < nCores_; ++unit) {
+        if(busy_[unit] > busy_[bottleneck]) {
+            bottleneck = unit;
+        }
+        if(!programs_[unit].empty()) {
+            totalBusy += busy_[unit];
+            ++nActiveCores;
+        }
+    }
+    report << "# simulated cycles per inference = " << latency_ << std::endl;
+    report << "bottleneck core = tile " << bottleneck/nCoresPerTile
+        << " core " << bottleneck%nCoresPerTile << std::endl;
+    report << "# bottleneck core busy cycles = " << busy_[bottleneck] << std::endl;
+    if(latency_ > 0 && nActiveCores > 0) {
+        report << "% average core utilization = "
+            << 100.0*totalBusy/nActiveCores/latency_ << "%" << std::endl;
+    }
+    for(unsigned int unit = 0; unit < nCores_; ++unit) {
+        if(!programs_[unit].empty()) {
+            report << "tile " << unit/nCoresPerTile
+                << " core " << unit%nCoresPerTile
+                << ": busy cycles = " << busy_[unit]
+                << ", MVMU cycles = " << mvmuBusy_[unit]
+                << ", utilization = " << 100.0*busy_[unit]/latency_ << "%" << std::endl;
+        }
+    }
+}
+
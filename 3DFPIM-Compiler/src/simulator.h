@@ -0,0 +1,82 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <fstream>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+// Event-driven simulation of the linearized core and tile programs.
+// Every core and tile executes its program in order; a unit blocks on
+// tile memory reads until the corresponding write (or send) has completed.
+// The programs keep only what the timing model needs, so they can be saved
+// with the compiled code and simulated again without the operation graph.
+class Simulator {
+
+    private:
+
+        struct SimulatorOperation {
+            uint8_t kind;               /* Operation::Kind */
+            uint8_t reusesStack;        /* MVM whose stack stays from the previous window */
+            uint8_t isMVMLast;
+            uint8_t crossesChip;        /* Send to a tile on another chip */
+            uint32_t length;
+            int32_t id;
+            int32_t dependency;         /* Operation whose result this one waits for, -1 if none */
+        };
+
+        ModelImpl* model_;
+
+        unsigned int nCores_;
+        unsigned int nUnits_;
+        unsigned int nOperations_;      /* Upper bound of operation ids */
+
+        std::vector<std::vector<SimulatorOperation>> programs_;
+        std::vector<unsigned int> pc_;
+        std::vector<unsigned long long> time_;
+        std::vector<unsigned long long> busy_;
+        std::vector<unsigned long long> mvmuBusy_;
+        std::vector<unsigned long long> edramFree_;
+        std::vector<long long> finish_;
+        std::map<int, std::vector<unsigned int>> waiters_;
+        std::vector<unsigned int> woken_;
+
+        unsigned long long latency_ = 0;
+
+        void loadPrograms(Placer* placer, Linearizer* linearizer);
+        void readPrograms(std::string fileName);
+        void simulate();
+        bool issue(unsigned int unit);
+        void complete(int id, unsigned long long time);
+        unsigned int getPTile(unsigned int unit);
+        unsigned long long accessTileMemory
+            (unsigned int pTile, unsigned long long start, unsigned int cycles);
+
+    public:
+
+        Simulator(ModelImpl* model, Placer* placer, Linearizer* linearizer);
+        Simulator(ModelImpl* model, std::string programsFileName);
+
+        // Per-operation timing model, shared with the static estimator
+        static unsigned int getTransferCycles(unsigned int length, unsigned int maxWidth);
+        static unsigned int getNetworkCycles(const HardwareConfig& hardware, unsigned int length, bool crossesChip);
+        static unsigned int getALUCycles(const HardwareConfig& hardware, unsigned int length);
+        static unsigned int getMVMCycles(const HardwareConfig& hardware, bool reusesStack, bool isLast);
+        static bool reusesStack(MVMOperation* mvm);
+        static int getDependency(Operation* op);
+
+        unsigned long long getLatency() { return latency_; }
+
+        void writePrograms(std::string fileName);
+        void printReport(std::ostream& report);
+
+};
+
@@ -0,0 +1,87 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <assert.h>
+#include <sys/resource.h>
+
+#include "3dfpim.h"
+
+#include "model.h"
+#include "stats.h"
+
+static std::string quote(std::string s) {
+    std::string quoted = "\"";
+    for(char c : s) {
+        if(c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+CompilerStats::CompilerStats(ModelImpl* model) : model_(model) {
+}
+
+long CompilerStats::getPeakRSS() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void CompilerStats::beginPass(std::string name) {
+    PassStats pass;
+    pass.name = name;
+    pass.nOperationsBefore = model_->getNOperations();
+    passes_.push_back(pass);
+    passPeakRSS_ = getPeakRSS();
+    passStart_ = std::chrono::steady_clock::now();
+}
+
+void CompilerStats::endPass() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - passStart_;
+    assert(!passes_.empty());
+    PassStats& pass = passes_.back();
+    pass.seconds = elapsed.count();
+    pass.peakRSSDelta = getPeakRSS() - passPeakRSS_;
+    pass.nOperationsAfter = model_->getNOperations();
+}
+
+void CompilerStats::addCounter(std::string name, unsigned long long value) {
+    assert(!passes_.empty());
+    passes_.back().counters.push_back(std::make_pair(name, value));
+}
+
+void CompilerStats::printJSON(std::ostream& out) {
+    double seconds = 0;
+    out << "{" << std::endl;
+    out << "  \"model\": " << quote(model_->getName()) << "," << std::endl;
+    out << "  \"passes\": [" << std::endl;
+    for(unsigned int p = 0; p < passes_.size(); ++p) {
+        PassStats& pass = passes_[p];
+        out << "    {" << std::endl;
+        out << "      \"name\": " << quote(pass.name) << "," << std::endl;
+        out << "      \"seconds\": " << pass.seconds << "," << std::endl;
+        out << "      \"peak_rss_delta_kb\": " << pass.peakRSSDelta << "," << std::endl;
+        out << "      \"operations_before\": " << pass.nOperationsBefore << "," << std::endl;
+        out << "      \"operations_after\": " << pass.nOperationsAfter << "," << std::endl;
+        out << "      \"counters\": {";
+        for(unsigned int c = 0; c < pass.counters.size(); ++c) {
+            out << (c == 0 ? "" : ",") << std::endl;
+            out << "        " << quote(pass.counters[c].first) << ": " << pass.counters[c].second;
+        }
+        out << (pass.counters.empty() ? "}" : "\n      }") << std::endl;
+        out << "    }" << (p + 1 < passes_.size() ? "," : "") << std::endl;
+        seconds += pass.seconds;
+    }
+    out << "  ]," << std::endl;
+    out << "  \"total_seconds\": " << seconds << "," << std::endl;
+    out << "  \"peak_rss_kb\": " << getPeakRSS() << std::endl;
+    out << "}" << std::endl;
+}
+
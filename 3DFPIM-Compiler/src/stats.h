@@ -0,0 +1,50 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+// Records the wall time, peak memory growth and graph size of every compiler
+// pass, along with counters each pass reports, and prints them as JSON.
+class CompilerStats {
+
+    private:
+
+        struct PassStats {
+            std::string name;
+            double seconds;
+            long peakRSSDelta;          /* KB */
+            unsigned int nOperationsBefore;
+            unsigned int nOperationsAfter;
+            std::vector<std::pair<std::string, unsigned long long>> counters;
+        };
+
+        ModelImpl* model_;
+        std::vector<PassStats> passes_;
+        std::chrono::steady_clock::time_point passStart_;
+        long passPeakRSS_;
+
+        static long getPeakRSS();
+
+    public:
+
+        CompilerStats(ModelImpl* model);
+
+        void beginPass(std::string name);
+        void endPass();
+        void addCounter(std::string name, unsigned long long value);
+
+        void printJSON(std::ostream& out);
+
+};
+
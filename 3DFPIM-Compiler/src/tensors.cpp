@@ -9,6 +9,7 @@
 #include <assert.h>
 #include <sstream>
 
+#include "arena.h"
 #include "model.h"
 #include "common.h"
 #include "operations.h"
@@ -32,30 +33,47 @@ Layer::Layer
     nOutChannels_(nOutChannels),
     isFC_(isFC)
 {
+    const HardwareConfig& hardware = model.unwrap()->getHardwareConfig();
     unsigned int nCompleteTile, nConcatTile;
 
-    nCompleteTile = (nInChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-    if(nInChannels_ % MVMU_DIM != 0) {
-        unsigned int maxConcat = MVMU_DIM / (nInChannels_ % MVMU_DIM);
+    nCompleteTile = (nInChannels_ / hardware.mvmuDim_) * kernelWidth_ * kernelHeight_;
+    if(nInChannels_ % hardware.mvmuDim_ != 0) {
+        unsigned int maxConcat = hardware.mvmuDim_ / (nInChannels_ % hardware.mvmuDim_);
         nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
     } else {
         nConcatTile = 0;
     }
 
-    nStack_ = std::min(nCompleteTile + nConcatTile, (unsigned int)MVMU_DPT);
+    nInStack_ = nCompleteTile + nConcatTile;
+    nStack_ = std::min(nInStack_, hardware.mvmuDpt_);
+    duplicateWidth_ = 1;
+    duplicateHeight_ = 1;
 
+    stackLoad_ = hardware.stackShiftLatency_ + hardware.prechargeLatency_ * DACScaling;
     load_ = outImageWidth * outImageHeight
-            * ((nStack_ - 1) * (STACK_SHIFT_LATENCY + PRECHARGE_LATENCY * DACScaling)
-            + STACK_REUSE_LATENCY + PRECHARGE_LATENCY * DACScaling
-            + ADC_LATENCY);
+            * ((nStack_ - 1) * stackLoad_
+            + hardware.stackReuseLatency_ + hardware.prechargeLatency_ * DACScaling
+            + hardware.adcLatency_);
 
     model.unwrap()->addLayer(this);
 };
 
 unsigned int Layer::getNMVMU()
 {
-    unsigned int nInMVMUs = (nStack_ - 1) / MVMU_DPT + 1;
-    unsigned int nOutMVMUs = (nOutChannels_ - 1) / MVMU_DIM + 1;
+    const HardwareConfig& hardware = model_.unwrap()->getHardwareConfig();
+    unsigned int nInMVMUs = (nStack_ - 1) / hardware.mvmuDpt_ + 1;
+    unsigned int nOutMVMUs = (nOutChannels_ - 1) / hardware.mvmuDim_ + 1;
+
+    return nInMVMUs * nOutMVMUs;
+}
+
+// Every output tile of an FC layer takes as many MVMUs as the input stacks
+// need at the spread depth
+unsigned int Layer::getNFCMVMU(unsigned int split)
+{
+    const HardwareConfig& hardware = model_.unwrap()->getHardwareConfig();
+    unsigned int nInMVMUs = (nInStack_ - 1) / getFCDepth(split) + 1;
+    unsigned int nOutMVMUs = (nOutChannels_ - 1) / hardware.mvmuDim_ + 1;
 
     return nInMVMUs * nOutMVMUs;
 }
@@ -64,12 +82,12 @@ int Layer::setDuplicate
     (unsigned int duplicateWidth,
     unsigned int duplicateHeight)
 {
+    duplicateWidth_ = duplicateWidth;
+    duplicateHeight_ = duplicateHeight;
+
     if (isFC_) {
-        duplicateWidth_ = 1;
-        duplicateHeight_ = 1;
-    } else {
-        duplicateWidth_ = duplicateWidth;
-        duplicateHeight_ = duplicateHeight;
+        return duplicateWidth_ >= 1 && duplicateWidth_ <= getMaxFCSplit()
+            && duplicateHeight_ == 1;
     }
 
     if(duplicateWidth_ > outImageWidth_
@@ -219,11 +237,11 @@ InputVectorImpl::InputVectorImpl
 {
     tiles_.resize(nTiles());
     for(unsigned int i = 0; i < nTiles(); ++i) {
-        unsigned int tileSize = MVMU_DIM;
-        if(i == nTiles() - 1 && length%MVMU_DIM > 0) {
-            tileSize = length%MVMU_DIM;
+        unsigned int tileSize = hardware_->mvmuDim_;
+        if(i == nTiles() - 1 && length%hardware_->mvmuDim_ > 0) {
+            tileSize = length%hardware_->mvmuDim_;
         }
-        tiles_[i] = new InputVectorTile
+        tiles_[i] = new (model->getArena()) InputVectorTile
             (model, name + "[" + std::to_string(i) + "]", tileSize);
     }
     model->addInputVectorImpl(this);
@@ -243,7 +261,7 @@ InputImagePixelStreamTile::InputImagePixelStreamTile
     for(unsigned int h = 0; h < imageHeight; ++h) {
         stream_[h].resize(imageWidth);
         for(unsigned int w = 0; w < imageWidth; ++w) {
-            stream_[h][w] = new InputVectorTile
+            stream_[h][w] = new (model->getArena()) InputVectorTile
                 (model, name + "[" + std::to_string(h) + "][" + std::to_string(w) + "]",
                 nChannels);
         }
@@ -261,20 +279,20 @@ InputImagePixelStreamImpl::InputImagePixelStreamImpl
     kernelWidth, kernelHeight, nChannels)
 {
     tiles_.resize(nTiles());
-    unsigned int nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
+    unsigned int nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
     for(unsigned int i = 0; i < nTiles(); ++i) {
         unsigned int tileSize;
         if(i < nCompleteTile) {
-            tileSize = MVMU_DIM;
+            tileSize = hardware_->mvmuDim_;
         } else {
-            unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
-            tileSize = maxConcat * (nChannels_ % MVMU_DIM);
+            unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
+            tileSize = maxConcat * (nChannels_ % hardware_->mvmuDim_);
             if(i == nTiles() - 1 && (kernelWidth_ * kernelHeight_) % maxConcat > 0) {
                 tileSize = ((kernelWidth_ * kernelHeight_) % maxConcat)
-                            * (nChannels_ % MVMU_DIM);
+                            * (nChannels_ % hardware_->mvmuDim_);
             }
         }
-        tiles_[i] = new InputImagePixelStreamTile
+        tiles_[i] = new (model->getArena()) InputImagePixelStreamTile
             (model, name + "[" + std::to_string(i) + "]", 
             imageWidth, imageHeight, 
             kernelWidth, kernelHeight,
@@ -289,11 +307,11 @@ OutputVectorImpl::OutputVectorImpl
 {
     tiles_.resize(nTiles());
     for(unsigned int i = 0; i < nTiles(); ++i) {
-        unsigned int tileSize = MVMU_DIM;
-        if(i == nTiles() - 1 && length%MVMU_DIM > 0) {
-            tileSize = length%MVMU_DIM;
+        unsigned int tileSize = hardware_->mvmuDim_;
+        if(i == nTiles() - 1 && length%hardware_->mvmuDim_ > 0) {
+            tileSize = length%hardware_->mvmuDim_;
         }
-        tiles_[i] = new OutputVectorTile
+        tiles_[i] = new (model->getArena()) OutputVectorTile
             (model, name + "[" + std::to_string(i) + "]", tileSize);
     }
     model->addOutputVectorImpl(this);
@@ -313,7 +331,7 @@ OutputImagePixelStreamTile::OutputImagePixelStreamTile
     for(unsigned int h = 0; h < imageHeight; ++h) {
         stream_[h].resize(imageWidth);
         for(unsigned int w = 0; w < imageWidth; ++w) {
-            stream_[h][w] = new OutputVectorTile
+            stream_[h][w] = new (model->getArena()) OutputVectorTile
                 (model, name + "[" + std::to_string(h) + "][" + std::to_string(w) + "]",
                 nChannels);
         }
@@ -331,20 +349,20 @@ OutputImagePixelStreamImpl::OutputImagePixelStreamImpl
     kernelWidth, kernelHeight, nChannels)
 {
     tiles_.resize(nTiles());
-    unsigned int nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
+    unsigned int nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
     for(unsigned int i = 0; i < nTiles(); ++i) {
         unsigned int tileSize;
         if(i < nCompleteTile) {
-            tileSize = MVMU_DIM;
+            tileSize = hardware_->mvmuDim_;
         } else {
-            unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
-            tileSize = maxConcat * (nChannels_ % MVMU_DIM);
+            unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
+            tileSize = maxConcat * (nChannels_ % hardware_->mvmuDim_);
             if(i == nTiles() - 1 && (kernelWidth_ * kernelHeight_) % maxConcat > 0) {
                 tileSize = ((kernelWidth_ * kernelHeight_) % maxConcat)
-                            * (nChannels_ % MVMU_DIM);
+                            * (nChannels_ % hardware_->mvmuDim_);
             }
         }
-        tiles_[i] = new OutputImagePixelStreamTile
+        tiles_[i] = new (model->getArena()) OutputImagePixelStreamTile
             (model, name + "[" + std::to_string(i) + "]", 
             imageWidth, imageHeight, 
             kernelWidth, kernelHeight,
@@ -360,18 +378,18 @@ ConstantMatrixImpl::ConstantMatrixImpl
 {
     tiles_.resize(nHeightTiles());
     for(unsigned int h = 0; h < nHeightTiles(); ++h) {
-        unsigned int tileHeight = MVMU_DIM;
-        if(h == nHeightTiles() - 1 && height%MVMU_DIM > 0) {
-            tileHeight = height%MVMU_DIM;
+        unsigned int tileHeight = hardware_->mvmuDim_;
+        if(h == nHeightTiles() - 1 && height%hardware_->mvmuDim_ > 0) {
+            tileHeight = height%hardware_->mvmuDim_;
         }
         tiles_[h].resize(nWidthTiles());
         for(unsigned int w = 0; w < nWidthTiles(); ++w) {
-            unsigned int tileWidth = MVMU_DIM * MVMU_DPT;
-            if(w == nWidthTiles() - 1 && width%(MVMU_DIM * MVMU_DPT) > 0) {
-                tileWidth = width%(MVMU_DIM * MVMU_DPT);
+            unsigned int tileWidth = hardware_->mvmuDim_ * hardware_->mvmuDpt_;
+            if(w == nWidthTiles() - 1 && width%(hardware_->mvmuDim_ * hardware_->mvmuDpt_) > 0) {
+                tileWidth = width%(hardware_->mvmuDim_ * hardware_->mvmuDpt_);
             }
             tiles_[h][w] = 
-                new ConstantMatrixTile
+                new (model->getArena()) ConstantMatrixTile
                 (model, name + "[" + std::to_string(h) + "][" + std::to_string(w) + "]",
                 tileWidth, tileHeight, nHeightTiles() * nWidthTiles());
         }
@@ -405,16 +423,16 @@ ConvolutionalConstantMatrixImpl::ConvolutionalConstantMatrixImpl
         for(unsigned int dw = 0; dw < getDuplicateWidth(); ++dw) {
             tiles_[dh][dw].resize(getNOutTiles());
             for(unsigned int h = 0; h < getNOutTiles(); h++){
-                unsigned int tileHeight = MVMU_DIM;
-                if(h == getNOutTiles() - 1 && nOutChannels%MVMU_DIM > 0) {
-                    tileHeight = nOutChannels%MVMU_DIM;
+                unsigned int tileHeight = hardware_->mvmuDim_;
+                if(h == getNOutTiles() - 1 && nOutChannels%hardware_->mvmuDim_ > 0) {
+                    tileHeight = nOutChannels%hardware_->mvmuDim_;
                 }
 
                 tiles_[dh][dw][h].resize(getNInTiles());
                 for(unsigned int w = 0; w < getNInTiles(); w++){
                     unsigned int tileWidth = nInChannels * kernelWidth * kernelHeight;
                     tiles_[dh][dw][h][w] = 
-                        new ConstantMatrixTile
+                        new (model->getArena()) ConstantMatrixTile
                         (model, name + "[" + 
                         std::to_string(dh) + "][" + 
                         std::to_string(dw) + "][" + 
@@ -441,21 +459,22 @@ FCConstantMatrixImpl::FCConstantMatrixImpl
     Layer* layer = *it;
 
     assert(layer != NULL);
-    assert(layer->duplicateWidth_ == 1);
     assert(layer->duplicateHeight_ == 1);
+    assert(layer->isFC_ || layer->duplicateWidth_ == 1);
+    split_ = layer->duplicateWidth_;
     model->layer_erase_head();
 
     tiles_.resize(getNOutTiles());
     for(unsigned int h = 0; h < getNOutTiles(); h++){
-        unsigned int tileHeight = MVMU_DIM;
-        if(h == getNOutTiles() - 1 && nOutChannels%MVMU_DIM > 0) {
-            tileHeight = nOutChannels%MVMU_DIM;
+        unsigned int tileHeight = hardware_->mvmuDim_;
+        if(h == getNOutTiles() - 1 && nOutChannels%hardware_->mvmuDim_ > 0) {
+            tileHeight = nOutChannels%hardware_->mvmuDim_;
         }
         tiles_[h].resize(getNInTiles());
         for(unsigned int w = 0; w < getNInTiles(); w++){
             unsigned int tileWidth = nInChannels * kernelWidth * kernelHeight;
             tiles_[h][w] = 
-                new ConstantMatrixTile
+                new (model->getArena()) ConstantMatrixTile
                 (model, name + "[" + 
                 std::to_string(h) + "][" + 
                 std::to_string(w) + "]", tileWidth, tileHeight,
@@ -467,7 +486,7 @@ FCConstantMatrixImpl::FCConstantMatrixImpl
 }
 
 VectorImpl::VectorImpl(ModelImpl* model, unsigned int length)
-    : AbstractVector(model, "", length), tiles_((length - 1)/MVMU_DIM + 1)
+    : AbstractVector(model, "", length), tiles_((length - 1)/hardware_->mvmuDim_ + 1)
 {
     model->addVectorImpl(this);
 }
@@ -499,20 +518,20 @@ ImagePixelStreamImpl::ImagePixelStreamImpl
     kernelWidth, kernelHeight, nChannels)
 {
     tiles_.resize(nTiles());
-    unsigned int nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
+    unsigned int nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
     for(unsigned int i = 0; i < nTiles(); ++i) {
         unsigned int tileSize;
         if(i < nCompleteTile) {
-            tileSize = MVMU_DIM;
+            tileSize = hardware_->mvmuDim_;
         } else {
-            unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
-            tileSize = maxConcat * (nChannels_ % MVMU_DIM);
+            unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
+            tileSize = maxConcat * (nChannels_ % hardware_->mvmuDim_);
             if(i == nTiles() - 1 && (kernelWidth_ * kernelHeight_) % maxConcat > 0) {
                 tileSize = ((kernelWidth_ * kernelHeight_) % maxConcat)
-                            * (nChannels_ % MVMU_DIM);
+                            * (nChannels_ % hardware_->mvmuDim_);
             }
         }
-        tiles_[i] = new ImagePixelStreamTile
+        tiles_[i] = new (model->getArena()) ImagePixelStreamTile
             (model, imageWidth, imageHeight, 
             kernelWidth, kernelHeight, 
             tileSize);
@@ -620,54 +639,54 @@ OutputVectorTile* OutputImagePixelStreamTile::get(unsigned int h, unsigned int w
 
 InputVectorImpl::~InputVectorImpl() {
     for(InputVectorTile* tile : tiles_) {
-        delete tile;
+        tile->~InputVectorTile();
     }
 }
 
 InputImagePixelStreamTile::~InputImagePixelStreamTile() {
     for(auto it : stream_) {
         for(InputVectorTile* tile : it) {
-            delete tile;
+            tile->~InputVectorTile();
         }
     }
 }
 
 InputImagePixelStreamImpl::~InputImagePixelStreamImpl() {
     for(InputImagePixelStreamTile* tile : tiles_) {
-        delete tile;
+        tile->~InputImagePixelStreamTile();
     }
 }
 
 ImagePixelStreamImpl::~ImagePixelStreamImpl() {
     for(ImagePixelStreamTile* tile : tiles_) {
-        delete tile;
+        tile->~ImagePixelStreamTile();
     }
 }
 
 OutputVectorImpl::~OutputVectorImpl() {
     for(OutputVectorTile* tile : tiles_) {
-        delete tile;
+        tile->~OutputVectorTile();
     }
 }
 
 OutputImagePixelStreamTile::~OutputImagePixelStreamTile() {
     for(auto it : stream_) {
         for(OutputVectorTile* tile : it) {
-            delete tile;
+            tile->~OutputVectorTile();
         }
     }
 }
 
 OutputImagePixelStreamImpl::~OutputImagePixelStreamImpl() {
     for(OutputImagePixelStreamTile* tile : tiles_) {
-        delete tile;
+        tile->~OutputImagePixelStreamTile();
     }
 }
 
 ConstantMatrixImpl::~ConstantMatrixImpl() {
     for(auto tileRow : tiles_) {
         for(ConstantMatrixTile* tile : tileRow) {
-            delete tile;
+            tile->~ConstantMatrixTile();
         }
     }
 }
@@ -677,7 +696,7 @@ ConvolutionalConstantMatrixImpl::~ConvolutionalConstantMatrixImpl() {
         for(auto duplicateColumn : duplicateRow) {
             for(auto kernelOut : duplicateColumn) {
                 for(ConstantMatrixTile* tile : kernelOut) {
-                    delete tile;
+                    tile->~ConstantMatrixTile();
                 }
             }
         }
@@ -687,11 +706,16 @@ ConvolutionalConstantMatrixImpl::~ConvolutionalConstantMatrixImpl() {
 FCConstantMatrixImpl::~FCConstantMatrixImpl() {
     for(auto kernelOut : tiles_) {
         for(ConstantMatrixTile* tile : kernelOut) {
-            delete tile;
+            tile->~ConstantMatrixTile();
         }
     }
 }
 
+AbstractTensor::AbstractTensor(ModelImpl* model, std::string name)
+    : model_(model), hardware_(&model->getHardwareConfig()), name_(name)
+{
+}
+
 std::string AbstractTensor::printNodeName() {
     std::stringstream ss;
     ss << '"' << printTensorType() << "\n" << name_ << '"';
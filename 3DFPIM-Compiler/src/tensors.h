@@ -6,6 +6,7 @@
 * LICENSE file.
 *******************************************************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -17,10 +18,10 @@ class AbstractTensor {
     protected:
 
         ModelImpl* model_;
+        const HardwareConfig* hardware_;
         std::string name_;
 
-        AbstractTensor(ModelImpl* model, std::string name) : 
-            model_(model), name_(name) {}
+        AbstractTensor(ModelImpl* model, std::string name);
 
     public:
 
@@ -48,7 +49,7 @@ class AbstractVector : public AbstractTensor {
         void checkCompatibility(AbstractVector* v);
 
         unsigned int length() const { return length_; }
-        unsigned int nTiles() { return (length_ - 1)/MVMU_DIM + 1; }
+        unsigned int nTiles() { return (length_ - 1)/hardware_->mvmuDim_ + 1; }
 
 };
 
@@ -101,9 +102,9 @@ class AbstractImagePixelStream : public AbstractTensor {
         unsigned int nTiles() {
             unsigned int nCompleteTile, nConcatTile;
 
-            nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nChannels_ % MVMU_DIM != 0) { // Concatenate incomplete vectors
-                unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
+            nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nChannels_ % hardware_->mvmuDim_ != 0) { // Concatenate incomplete vectors
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
                 nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
             } else { // No incomplete vectors
                 nConcatTile = 0;
@@ -144,7 +145,7 @@ class InputVectorImpl : public AbstractVector {
             (ModelImpl* model, std::string name, unsigned int length);
         ~InputVectorImpl();
 
-        unsigned int nTiles() { return (length_ - 1)/MVMU_DIM + 1; }
+        unsigned int nTiles() { return (length_ - 1)/hardware_->mvmuDim_ + 1; }
         InputVectorTile* getTile(unsigned int t);
 
         std::string printNodeStyle();
@@ -193,9 +194,9 @@ class InputImagePixelStreamImpl : public AbstractImagePixelStream {
         unsigned int nTiles() {
             unsigned int nCompleteTile, nConcatTile;
 
-            nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nChannels_ % MVMU_DIM != 0) { // Concatenate incomplete vectors
-                unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
+            nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nChannels_ % hardware_->mvmuDim_ != 0) { // Concatenate incomplete vectors
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
                 nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
             } else { // No incomplete vectors
                 nConcatTile = 0;
@@ -221,7 +222,7 @@ class VectorImpl : public AbstractVector {
 
         VectorImpl(ModelImpl* model, unsigned int length);
 
-        unsigned int nTiles() { return (length_ - 1)/MVMU_DIM + 1; }
+        unsigned int nTiles() { return (length_ - 1)/hardware_->mvmuDim_ + 1; }
         ProducerOperation* getTile(unsigned int t);
         void setTile(unsigned int t, ProducerOperation* producer);
 
@@ -268,11 +269,11 @@ class ImagePixelStreamImpl : public AbstractImagePixelStream {
         unsigned int nTiles() {
             unsigned int nCompleteTile, nConcatTile;
 
-            nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nChannels_ % MVMU_DIM != 0) {
+            nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nChannels_ % hardware_->mvmuDim_ != 0) {
                 // Concatenate incomplete vectors in
                 // (kernelWidth => kernelHeight => channel) order
-                unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
                 nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
             } else { // No incomplete vectors
                 nConcatTile = 0;
@@ -311,7 +312,7 @@ class OutputVectorImpl : public AbstractVector {
             (ModelImpl* model, std::string name, unsigned int length);
         ~OutputVectorImpl();
 
-        unsigned int nTiles() { return (length_ - 1)/MVMU_DIM + 1; }
+        unsigned int nTiles() { return (length_ - 1)/hardware_->mvmuDim_ + 1; }
         OutputVectorTile* getTile(unsigned int t);
 
         std::string printNodeStyle();
@@ -360,11 +361,11 @@ class OutputImagePixelStreamImpl : public AbstractImagePixelStream {
         unsigned int nTiles() {
             unsigned int nCompleteTile, nConcatTile;
 
-            nCompleteTile = (nChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nChannels_ % MVMU_DIM != 0) {
+            nCompleteTile = (nChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nChannels_ % hardware_->mvmuDim_ != 0) {
                 // Concatenate incomplete vectors in
                 // (kernelWidth => kernelHeight => channel) order
-                unsigned int maxConcat = MVMU_DIM / (nChannels_ % MVMU_DIM);
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nChannels_ % hardware_->mvmuDim_);
                 nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
             } else { // No incomplete vectors
                 nConcatTile = 0;
@@ -419,13 +420,13 @@ class ConstantMatrixImpl : public AbstractMatrix {
             unsigned int width, unsigned int height);
         ~ConstantMatrixImpl();
 
-        unsigned int nHeightTiles() { return (height_ - 1)/(MVMU_DIM) + 1; }
-        unsigned int nWidthTiles() { return ((width_ - 1)/MVMU_DIM) / MVMU_DPT + 1; }
+        unsigned int nHeightTiles() { return (height_ - 1)/(hardware_->mvmuDim_) + 1; }
+        unsigned int nWidthTiles() { return ((width_ - 1)/hardware_->mvmuDim_) / hardware_->mvmuDpt_ + 1; }
         unsigned int nWidthRest() { 
-            unsigned int rest = ((width_ - 1)/(MVMU_DIM) + 1) % MVMU_DPT; 
-            return rest != 0 ? rest : MVMU_DPT;
+            unsigned int rest = ((width_ - 1)/(hardware_->mvmuDim_) + 1) % hardware_->mvmuDpt_; 
+            return rest != 0 ? rest : hardware_->mvmuDpt_;
         }
-        unsigned int nWidthDPT() { return MVMU_DPT; }
+        unsigned int nWidthDPT() { return hardware_->mvmuDpt_; }
         ConstantMatrixTile* getTile(unsigned int h, unsigned int w);
 
         std::string printTensorType();
@@ -479,37 +480,37 @@ class ConvolutionalConstantMatrixImpl : public AbstractTensor {
         unsigned int getNInTiles() {
             unsigned int nCompleteTile, nConcatTile;
 
-            nCompleteTile = (nInChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nInChannels_ % MVMU_DIM != 0) {
+            nCompleteTile = (nInChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nInChannels_ % hardware_->mvmuDim_ != 0) {
                 // Concatenate incomplete vectors in
                 // (kernelWidth => kernelHeight => channel) order
-                unsigned int maxConcat = MVMU_DIM / (nInChannels_ % MVMU_DIM);
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nInChannels_ % hardware_->mvmuDim_);
                 nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
             } else {
                 nConcatTile = 0;
             }
 
-            return (nCompleteTile + nConcatTile - 1) / MVMU_DPT + 1;
+            return (nCompleteTile + nConcatTile - 1) / hardware_->mvmuDpt_ + 1;
         }
         // # of stack used in MVMUs
-        unsigned int getNInDPT() { return MVMU_DPT; }
+        unsigned int getNInDPT() { return hardware_->mvmuDpt_; }
         // # of stack used in the last MVMU
         unsigned int getNInRestDPT() { 
             unsigned int nCompleteTile, nConcatTile;
 
-            nCompleteTile = (nInChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nInChannels_ % MVMU_DIM != 0) {
-                unsigned int maxConcat = MVMU_DIM / (nInChannels_ % MVMU_DIM);
+            nCompleteTile = (nInChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nInChannels_ % hardware_->mvmuDim_ != 0) {
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nInChannels_ % hardware_->mvmuDim_);
                 nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
             } else {
                 nConcatTile = 0;
             }
 
-            unsigned int nInRestDPT = (nCompleteTile + nConcatTile) % MVMU_DPT;
-            return (nInRestDPT == 0) ? MVMU_DPT : nInRestDPT;
+            unsigned int nInRestDPT = (nCompleteTile + nConcatTile) % hardware_->mvmuDpt_;
+            return (nInRestDPT == 0) ? hardware_->mvmuDpt_ : nInRestDPT;
         }
         // # of output side 3D MVMU
-        unsigned int getNOutTiles() { return (nOutChannels_ - 1)/MVMU_DIM + 1; }
+        unsigned int getNOutTiles() { return (nOutChannels_ - 1)/hardware_->mvmuDim_ + 1; }
 
         ConstantMatrixTile* getTile
             (unsigned int dh, unsigned int dw,
@@ -529,9 +530,24 @@ class FCConstantMatrixImpl : public AbstractTensor {
         unsigned int nOutChannels_;
         unsigned int kernelWidth_;
         unsigned int kernelHeight_;
+        unsigned int split_;            /* Spreads the input stacks over this many more MVMUs */
         std::vector<
             std::vector<ConstantMatrixTile*> >tiles_;
 
+        unsigned int getNInStacks() {
+            unsigned int nCompleteTile, nConcatTile;
+
+            nCompleteTile = (nInChannels_ / hardware_->mvmuDim_) * kernelWidth_ * kernelHeight_;
+            if(nInChannels_ % hardware_->mvmuDim_ != 0) {
+                unsigned int maxConcat = hardware_->mvmuDim_ / (nInChannels_ % hardware_->mvmuDim_);
+                nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
+            } else {
+                nConcatTile = 0;
+            }
+
+            return nCompleteTile + nConcatTile;
+        }
+
     public:
 
         FCConstantMatrixImpl
@@ -545,35 +561,12 @@ class FCConstantMatrixImpl : public AbstractTensor {
         unsigned int getNInChannels() { return nInChannels_; }
         unsigned int getNOutChannels() { return nOutChannels_; }
 
-        unsigned int getNInTiles() {
-            unsigned int nCompleteTile, nConcatTile;
-
-            nCompleteTile = (nInChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nInChannels_ % MVMU_DIM != 0) {
-                unsigned int maxConcat = MVMU_DIM / (nInChannels_ % MVMU_DIM);
-                nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
-            } else {
-                nConcatTile = 0;
-            }
-
-            return (nCompleteTile + nConcatTile - 1) / MVMU_DPT + 1;
-        }
-        unsigned int getNInDPT() { return MVMU_DPT; }
-        unsigned int getNInRestDPT() { 
-            unsigned int nCompleteTile, nConcatTile;
-
-            nCompleteTile = (nInChannels_ / MVMU_DIM) * kernelWidth_ * kernelHeight_;
-            if(nInChannels_ % MVMU_DIM != 0) {
-                unsigned int maxConcat = MVMU_DIM / (nInChannels_ % MVMU_DIM);
-                nConcatTile = (kernelWidth_ * kernelHeight_ - 1) / maxConcat + 1;
-            } else {
-                nConcatTile = 0;
-            }
-
-            unsigned int nInRestDPT = (nCompleteTile + nConcatTile) % MVMU_DPT;
-            return (nInRestDPT == 0) ? MVMU_DPT : nInRestDPT;
+        unsigned int getNInTiles() { return (getNInStacks() - 1) / getNInDPT() + 1; }
+        unsigned int getNInDPT() {
+            return (std::min(getNInStacks(), hardware_->mvmuDpt_) - 1) / split_ + 1;
         }
-        unsigned int getNOutTiles() { return (nOutChannels_ - 1)/MVMU_DIM + 1; }
+        unsigned int getNInRestDPT() { return getNInStacks() - (getNInTiles() - 1) * getNInDPT(); }
+        unsigned int getNOutTiles() { return (nOutChannels_ - 1)/hardware_->mvmuDim_ + 1; }
 
         ConstantMatrixTile* getTile(unsigned int h, unsigned int w);
         void checkCompatibility(AbstractImagePixelStream* vs);
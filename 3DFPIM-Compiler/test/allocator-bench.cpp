@@ -0,0 +1,188 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <algorithm>
+#include <assert.h>
+#include <bitset>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "3dfpim.h"
+
+#include "allocator.h"
+
+// Microbenchmark of the register file allocator. A trace of allocate and
+// free requests shaped like the register allocation of the example networks
+// (single registers for addresses and immediates, load/store sized vectors
+// and MVMU wide vectors, with the file kept about 3/4 full) is replayed
+// against CoreAllocator and the bitset first-fit it replaced. Both must
+// return the same registers; their times are reported.
+//
+//   ./allocator-bench.bench [-n <requests>] [-w <hardware config>]...
+
+static const unsigned int MAX_REGISTER_FILE_SIZE = 1 << 16;
+
+// The register allocator before the free-range tree: a linear scan for the
+// leftmost free run over a bitset
+class BitsetAllocator {
+
+    private:
+
+        unsigned int startAddress_;
+        unsigned int size_;
+        std::bitset<MAX_REGISTER_FILE_SIZE> memPool_;
+
+    public:
+
+        BitsetAllocator(unsigned int startAddress, unsigned int size)
+            : startAddress_(startAddress), size_(size) { }
+
+        unsigned int allocate(unsigned int size) {
+            for(unsigned int i = 0; i + size <= size_; ++i) {
+                unsigned int j;
+                for(j = i; j < i + size; ++j) {
+                    if(memPool_[j]) {
+                        break;
+                    }
+                }
+                if(j == i + size) {
+                    for(unsigned int k = i; k < j; ++k) {
+                        memPool_.set(k);
+                    }
+                    return startAddress_ + i;
+                } else {
+                    i = j;
+                }
+            }
+            return CoreAllocator::OUT_OF_REGISTERS;
+        }
+
+        void free(unsigned int reg, unsigned int size) {
+            unsigned int pos = reg - startAddress_;
+            for(unsigned int i = pos; i < pos + size; ++i) {
+                assert(memPool_[i] && "Attempt to free unallocated registers!");
+                memPool_.reset(i);
+            }
+        }
+
+};
+
+struct Request {
+    unsigned int size;      /* Registers to allocate, or 0 to free */
+    unsigned int victim;    /* Index of the live allocation to free */
+};
+
+// The trace depends only on the sizes, so both allocators replay the same one
+static std::vector<Request> make_trace(HardwareConfig& hardware, unsigned int nRequests) {
+    std::mt19937 random(42);
+    std::vector<Request> trace;
+    std::vector<unsigned int> live;
+    unsigned int used = 0;
+    unsigned int target = hardware.registerFileSize_*3/4;
+    while(trace.size() < nRequests) {
+        Request request = { 0, 0 };
+        unsigned int kind = random() % 4;
+        if(kind == 0) {
+            request.size = 1;
+        } else if(kind == 1) {
+            request.size = hardware.maxLoadStoreWidth_;
+        } else {
+            unsigned int step = hardware.maxLoadStoreWidth_;
+            request.size = step*(1 + random() % (hardware.mvmuDim_/step));
+        }
+        if(!live.empty() && (used + request.size > target || random() % 2 == 0)) {
+            request.victim = random() % live.size();
+            request.size = 0;
+            used -= live[request.victim];
+            live[request.victim] = live.back();
+            live.pop_back();
+        } else {
+            live.push_back(request.size);
+            used += request.size;
+        }
+        trace.push_back(request);
+    }
+    return trace;
+}
+
+template <class Allocator>
+static double replay(Allocator& allocator, const std::vector<Request>& trace,
+    std::vector<unsigned int>& registers) {
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned int> live;
+    std::vector<unsigned int> liveSizes;
+    for(const Request& request : trace) {
+        if(request.size == 0) {
+            if(liveSizes[request.victim] != 0) {
+                allocator.free(live[request.victim], liveSizes[request.victim]);
+            }
+            live[request.victim] = live.back();
+            liveSizes[request.victim] = liveSizes.back();
+            live.pop_back();
+            liveSizes.pop_back();
+        } else {
+            // A request that does not fit stays in the trace as an empty allocation
+            unsigned int reg = allocator.allocate(request.size);
+            registers.push_back(reg);
+            live.push_back(reg);
+            liveSizes.push_back(reg == CoreAllocator::OUT_OF_REGISTERS ? 0 : request.size);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+
+    unsigned int nRequests = 2000000;
+    std::vector<std::string> configs;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "-n" && i + 1 < argc) {
+            nRequests = std::stoul(argv[++i]);
+        } else if(arg == "-w" && i + 1 < argc) {
+            configs.push_back(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                << " [-n <requests>] [-w <hardware config>]..." << std::endl;
+            return 1;
+        }
+    }
+
+    for(unsigned int c = 0; c < std::max<size_t>(configs.size(), 1); ++c) {
+        HardwareConfig hardware;
+        std::string name = "default";
+        if(!configs.empty()) {
+            name = configs[c];
+            hardware = HardwareConfig::load(configs[c]);
+        }
+        assert(hardware.registerFileSize_ <= MAX_REGISTER_FILE_SIZE);
+
+        std::vector<Request> trace = make_trace(hardware, nRequests);
+        std::vector<unsigned int> bitsetRegisters, treeRegisters;
+        BitsetAllocator bitset(hardware.registerFileStartAddress(), hardware.registerFileSize_);
+        CoreAllocator tree(hardware.registerFileStartAddress(), hardware.registerFileSize_);
+        double bitsetSeconds = replay(bitset, trace, bitsetRegisters);
+        double treeSeconds = replay(tree, trace, treeRegisters);
+        if(bitsetRegisters != treeRegisters) {
+            std::cerr << name << ": the allocators returned different registers" << std::endl;
+            return 1;
+        }
+
+        std::cout << "# " << name << ": " << hardware.registerFileSize_ << " registers, "
+            << nRequests << " requests, bitset " << bitsetSeconds << " s, tree "
+            << treeSeconds << " s (" << bitsetSeconds/treeSeconds << "x)" << std::endl;
+    }
+
+    return 0;
+
+}
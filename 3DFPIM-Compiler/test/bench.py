@@ -0,0 +1,127 @@
+#
+# Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+# level directory. This file contains code from puma-compiler, (c) 2019,
+# University of Illinois. See LICENSE_PUMA file in the parent directory.
+# 3D-FPIM Project can be copied according to the terms contained in the
+# LICENSE file.
+#
+
+# Compiles each network several times and reports the median time and peak
+# memory of every pass from the <model>-stats.json files the compiler writes.
+# With a baseline, passes that got slower or bigger than the tolerance are
+# reported and the script exits with status 1.
+#
+#   python3 bench.py [-n runs] [-o result.json] [-b baseline.json] [-t tolerance] <network>...
+#
+# Each <network> is built as <network>.bench (see "make bench").
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+
+def run_network(network, runs, scratch):
+    # Run against the library in ../src, as built by "make bench"
+    env = dict(os.environ)
+    library = os.path.abspath(os.path.join("..", "src"))
+    env["LD_LIBRARY_PATH"] = library + os.pathsep + env.get("LD_LIBRARY_PATH", "")
+    results = []
+    for run in range(runs):
+        directory = os.path.join(scratch, network, str(run))
+        shutil.rmtree(directory, ignore_errors=True)
+        os.makedirs(directory)
+        with open(os.path.join(directory, "stdout.txt"), "w") as out:
+            status = subprocess.call([os.path.abspath(network + ".bench")],
+                cwd=directory, env=env, stdout=out, stderr=subprocess.STDOUT)
+        if status != 0:
+            sys.exit("%s failed with status %d, see %s/stdout.txt" % (network, status, directory))
+        stats = glob.glob(os.path.join(directory, "*-stats.json"))
+        if len(stats) != 1:
+            sys.exit("%s did not write a single stats file" % network)
+        with open(stats[0]) as f:
+            results.append(json.load(f))
+        # The generated code is large and not needed once the stats are read
+        shutil.rmtree(directory)
+    return results
+
+def summarize(results):
+    summary = {
+        "total_seconds": statistics.median(r["total_seconds"] for r in results),
+        "peak_rss_kb": statistics.median(r["peak_rss_kb"] for r in results),
+        "passes": {}
+    }
+    for p, first in enumerate(results[0]["passes"]):
+        passes = [r["passes"][p] for r in results]
+        summary["passes"][first["name"]] = {
+            "seconds": statistics.median(q["seconds"] for q in passes),
+            "peak_rss_delta_kb": statistics.median(q["peak_rss_delta_kb"] for q in passes),
+            "operations_after": first["operations_after"]
+        }
+    return summary
+
+def print_summary(name, summary):
+    print("%s: %.3f s, peak RSS = %d KB" % (name, summary["total_seconds"], summary["peak_rss_kb"]))
+    for pass_name, p in summary["passes"].items():
+        print("    %-24s %9.3f s %10d KB %10d ops" % (pass_name, p["seconds"],
+            p["peak_rss_delta_kb"], p["operations_after"]))
+
+def compare(name, summary, baseline, tolerance):
+    # Short passes are dominated by noise, so times under 0.1 s are not checked
+    regressions = []
+    def check(what, new, old, floor):
+        if new > floor and new > old*(1 + tolerance):
+            regressions.append("%s: %s %g -> %g (%+.1f%%)" % (name, what, old, new,
+                100.0*(new - old)/old if old > 0 else float("inf")))
+    check("total seconds", summary["total_seconds"], baseline["total_seconds"], 0.1)
+    check("peak RSS KB", summary["peak_rss_kb"], baseline["peak_rss_kb"], 0)
+    for pass_name, p in summary["passes"].items():
+        old = baseline["passes"].get(pass_name)
+        if old is None:
+            continue
+        check(pass_name + " seconds", p["seconds"], old["seconds"], 0.1)
+        if p["operations_after"] != old["operations_after"]:
+            print("%s: %s operations %d -> %d" % (name, pass_name,
+                old["operations_after"], p["operations_after"]))
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the compiler over the example networks")
+    parser.add_argument("networks", nargs="+")
+    parser.add_argument("-n", "--runs", type=int, default=3)
+    parser.add_argument("-o", "--output", default="bench.json")
+    parser.add_argument("-b", "--baseline")
+    parser.add_argument("-t", "--tolerance", type=float, default=0.1)
+    parser.add_argument("-s", "--scratch", default="bench-runs")
+    args = parser.parse_args()
+
+    summaries = {}
+    for network in args.networks:
+        print("Benchmarking %s (%d runs)... " % (network, args.runs), end="", flush=True)
+        summaries[network] = summarize(run_network(network, args.runs, args.scratch))
+        print("done.")
+    for network in args.networks:
+        print_summary(network, summaries[network])
+    with open(args.output, "w") as f:
+        json.dump({"runs": args.runs, "networks": summaries}, f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)["networks"]
+        regressions = []
+        for network in args.networks:
+            if network in baseline:
+                regressions += compare(network, summaries[network], baseline[network], args.tolerance)
+            else:
+                print("%s is not in the baseline" % network)
+        for regression in regressions:
+            print("regression: " + regression)
+        if regressions:
+            sys.exit(1)
+        print("No regressions over %s" % args.baseline)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,75 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "3dfpim.h"
+#include "network-loader.h"
+
+static std::string base_name(std::string fileName) {
+    std::string name = fileName.substr(fileName.find_last_of('/') + 1);
+    return name.substr(0, name.find('.'));
+}
+
+// Compiles every network description against every hardware configuration.
+// Models are named after the network, followed by the configuration if any
+// is given. With a cache directory, configurations that differ only in
+// parameters the compiler does not read (ALU, tile memory and network
+// timing) reuse the code compiled for an earlier one.
+int main(int argc, char** argv) {
+
+    CompilerOptions options;
+    std::vector<std::string> configs;
+    std::vector<std::string> networks;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "-c" && i + 1 < argc) {
+            options.cacheDirectory_ = argv[++i];
+        } else if(arg == "-w" && i + 1 < argc) {
+            configs.push_back(argv[++i]);
+        } else {
+            networks.push_back(arg);
+        }
+    }
+    if(networks.empty()) {
+        std::cerr << "Usage: " << argv[0]
+            << " [-c <cache directory>] [-w <hardware config>]... <network>..." << std::endl;
+        return 1;
+    }
+
+    for(std::string& network : networks) {
+        for(unsigned int c = 0; c < std::max<size_t>(configs.size(), 1); ++c) {
+
+            std::string name = base_name(network);
+            HardwareConfig hardware;
+            if(!configs.empty()) {
+                name += "-" + base_name(configs[c]);
+                hardware = HardwareConfig::load(configs[c]);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            Model model = Model::create(name, hardware);
+            load_network(model, network);
+            model.compile(options);
+            model.destroy();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "# " << name << ": " << elapsed.count() << " seconds" << std::endl;
+
+        }
+    }
+
+    return 0;
+
+}
+
@@ -0,0 +1,244 @@
+/*******************************************************************************
+* Copyright (c) 2022 Seoul National University. See LICENSE file in the top-
+* level directory. This file contains code from puma-compiler, (c) 2019,
+* University of Illinois. See LICENSE_PUMA file in the parent directory.
+* 3D-FPIM Project can be copied according to the terms contained in the
+* LICENSE file.
+*******************************************************************************/
+
+#ifndef _3DFPIM_TEST_NETWORK_LOADER_
+#define _3DFPIM_TEST_NETWORK_LOADER_
+
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "3dfpim.h"
+#include "load-balancer.h"
+#include "conv-layer.h"
+#include "residual-block.h"
+#include "fully-connected-layer.h"
+
+// A network description has one statement per line, and '#' starts a comment:
+//
+//   input <width> <height> <channels>     image input (or "input <length>" for a vector)
+//   conv <name> <kernel> <channels> [stride=<s>] [noact]
+//   maxpool <size>
+//   basic <name> <channels> [stride=<s>] [blocks=<n>]
+//   bottleneck <name> <channels> [stride=<s>] [blocks=<n>]
+//   fc <name> <channels>
+//
+// Image sizes follow from the input and the strides, so every layer is written
+// once and the loader issues both the load balancing and the network calls.
+struct NetworkStatement {
+
+    std::string type;
+    std::string name;
+    unsigned int kernel = 0;
+    unsigned int channels = 0;
+    unsigned int stride = 1;
+    unsigned int blocks = 1;
+    bool activation = true;
+
+    // Input shape of the statement, filled in while parsing
+    unsigned int inSizeX = 0;
+    unsigned int inSizeY = 0;
+    unsigned int inChannels = 0;
+
+};
+
+static void network_error(std::string fileName, unsigned int line, std::string message) {
+    std::cerr << fileName << ":" << line << ": " << message << std::endl;
+    assert(0 && "Malformed network description");
+}
+
+static unsigned int network_number(std::string fileName, unsigned int line, std::string token) {
+    std::stringstream ss(token);
+    unsigned int value;
+    if(!(ss >> value) || !ss.eof() || value == 0) {
+        network_error(fileName, line, "expected a positive number instead of \"" + token + "\"");
+    }
+    return value;
+}
+
+static void load_network(Model model, std::string fileName) {
+
+    std::ifstream file(fileName);
+    if(!file.good()) {
+        std::cerr << "Cannot open network description " << fileName << std::endl;
+        assert(0 && "Cannot open network description");
+    }
+
+    // Parse the statements and propagate the image shape through them
+    std::vector<NetworkStatement> statements;
+    bool isVector = false;
+    unsigned int inSizeX = 0, inSizeY = 0, inChannels = 0;
+    unsigned int sizeX = 0, sizeY = 0, channels = 0;
+    std::string line;
+    for(unsigned int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        std::stringstream ss(line.substr(0, line.find('#')));
+        std::vector<std::string> tokens;
+        std::string token;
+        while(ss >> token) {
+            tokens.push_back(token);
+        }
+        if(tokens.empty()) {
+            continue;
+        }
+
+        NetworkStatement statement;
+        statement.type = tokens[0];
+        std::vector<std::string> args;
+        for(unsigned int t = 1; t < tokens.size(); ++t) {
+            std::string& arg = tokens[t];
+            if(arg.compare(0, 7, "stride=") == 0) {
+                statement.stride = network_number(fileName, lineNumber, arg.substr(7));
+            } else if(arg.compare(0, 7, "blocks=") == 0) {
+                statement.blocks = network_number(fileName, lineNumber, arg.substr(7));
+            } else if(arg == "noact") {
+                statement.activation = false;
+            } else {
+                args.push_back(arg);
+            }
+        }
+
+        if(statement.type == "input") {
+            if(channels != 0 || (args.size() != 1 && args.size() != 3)) {
+                network_error(fileName, lineNumber, "expected a single \"input <width> <height> <channels>\" or \"input <length>\" first");
+            }
+            isVector = (args.size() == 1);
+            sizeX = isVector ? 1 : network_number(fileName, lineNumber, args[0]);
+            sizeY = isVector ? 1 : network_number(fileName, lineNumber, args[1]);
+            channels = network_number(fileName, lineNumber, args.back());
+            inSizeX = sizeX;
+            inSizeY = sizeY;
+            inChannels = channels;
+            continue;
+        }
+        if(channels == 0) {
+            network_error(fileName, lineNumber, "the network must start with \"input\"");
+        }
+        statement.inSizeX = sizeX;
+        statement.inSizeY = sizeY;
+        statement.inChannels = channels;
+
+        if(statement.type == "maxpool") {
+            if(args.size() != 1 || isVector) {
+                network_error(fileName, lineNumber, "expected \"maxpool <size>\" on an image");
+            }
+            statement.kernel = network_number(fileName, lineNumber, args[0]);
+            if(sizeX % statement.kernel != 0 || sizeY % statement.kernel != 0) {
+                network_error(fileName, lineNumber, "the pool size does not divide the image");
+            }
+            sizeX /= statement.kernel;
+            sizeY /= statement.kernel;
+        } else if(statement.type == "conv" || statement.type == "basic"
+            || statement.type == "bottleneck" || statement.type == "fc") {
+            bool isConv = (statement.type == "conv");
+            if(args.size() != (isConv ? 3 : 2)) {
+                network_error(fileName, lineNumber, "expected \"" + statement.type
+                    + " <name>" + (isConv ? " <kernel>" : "") + " <channels>\"");
+            }
+            if(isVector && statement.type != "fc") {
+                network_error(fileName, lineNumber, "only fc layers can follow a vector input");
+            }
+            statement.name = args[0];
+            statement.kernel = isConv ? network_number(fileName, lineNumber, args[1]) : 0;
+            statement.channels = network_number(fileName, lineNumber, args.back());
+            if(sizeX % statement.stride != 0 || sizeY % statement.stride != 0) {
+                network_error(fileName, lineNumber, "the stride does not divide the image");
+            }
+            if(statement.type == "fc") {
+                sizeX = 1;
+                sizeY = 1;
+            } else {
+                sizeX /= statement.stride;
+                sizeY /= statement.stride;
+            }
+            channels = statement.channels * (statement.type == "bottleneck" ? 4 : 1);
+        } else {
+            network_error(fileName, lineNumber, "unknown statement \"" + statement.type + "\"");
+        }
+        statements.push_back(statement);
+    }
+    if(statements.empty()) {
+        std::cerr << fileName << ": the network has no layers" << std::endl;
+        assert(0 && "Malformed network description");
+    }
+
+    // Vector networks are not duplicated, so they skip load balancing
+    if(isVector) {
+        auto in = InputVector::create(model, "in", inChannels);
+        auto out = OutputVector::create(model, "out", channels);
+        Vector vec = in;
+        for(NetworkStatement& s : statements) {
+            vec = fully_connected_vector_layer(model, s.name, s.inChannels, s.channels, vec);
+        }
+        out = vec;
+        return;
+    }
+
+    auto in_stream = InputImagePixelStream::create
+        (model, "in_stream", inSizeX, inSizeY, inChannels);
+    auto out_stream = OutputImagePixelStream::create
+        (model, "out_stream", sizeX, sizeY, channels);
+
+    // Load balance
+    for(NetworkStatement& s : statements) {
+        unsigned int outSizeX = s.inSizeX / s.stride;
+        unsigned int outSizeY = s.inSizeY / s.stride;
+        if(s.type == "conv") {
+            balance_conv(model, s.kernel, s.kernel, s.inSizeX, s.inSizeY, s.inChannels,
+                outSizeX, outSizeY, s.channels);
+        } else if(s.type == "basic") {
+            balance_basic_block(model, s.inSizeX, s.inSizeY, s.inChannels,
+                outSizeX, outSizeY, s.channels, s.stride, s.blocks);
+        } else if(s.type == "bottleneck") {
+            balance_bottleneck_block(model, s.inSizeX, s.inSizeY, s.inChannels,
+                outSizeX, outSizeY, s.channels, s.stride, s.blocks);
+        } else if(s.type == "fc") {
+            balance_fc(model, s.inSizeX, s.inSizeY, s.inSizeX, s.inSizeY, s.inChannels,
+                1, 1, s.channels);
+        }
+    }
+
+    model.loadBalance();
+
+    // Define network; a convolution followed by a max pool is split for pooling
+    ImagePixelStream stream = in_stream;
+    for(unsigned int i = 0; i < statements.size(); ++i) {
+        NetworkStatement& s = statements[i];
+        unsigned int outSizeX = s.inSizeX / s.stride;
+        unsigned int outSizeY = s.inSizeY / s.stride;
+        if(s.type == "conv") {
+            bool isPool = (i + 1 < statements.size() && statements[i + 1].type == "maxpool");
+            if(s.activation) {
+                stream = conv_layer(model, s.name, s.kernel, s.kernel, s.inSizeX, s.inSizeY,
+                    s.inChannels, s.channels, s.stride, outSizeX, outSizeY, stream, isPool);
+            } else {
+                stream = convnoact_layer(model, s.name, s.kernel, s.kernel, s.inSizeX, s.inSizeY,
+                    s.inChannels, s.channels, s.stride, outSizeX, outSizeY, stream, isPool);
+            }
+        } else if(s.type == "maxpool") {
+            stream = maxpool(stream, s.kernel, s.kernel);
+        } else if(s.type == "basic") {
+            stream = basic_block(model, s.name, s.inSizeX, s.inSizeY, s.inChannels,
+                outSizeX, outSizeY, s.channels, s.stride, s.blocks, stream);
+        } else if(s.type == "bottleneck") {
+            stream = bottleneck_block(model, s.name, s.inSizeX, s.inSizeY, s.inChannels,
+                outSizeX, outSizeY, s.channels, s.stride, s.blocks, stream);
+        } else if(s.type == "fc") {
+            stream = fully_connected_layer(model, s.name, s.inChannels, s.channels,
+                stream, s.inSizeX, s.inSizeY);
+        }
+    }
+
+    out_stream = stream;
+
+}
+
+#endif
+
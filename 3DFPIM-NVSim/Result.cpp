@@ -340,88 +340,115 @@ void Result::print() {
         cout << "      |--- Discharge Select Decoder = " << subarray->selectDecoder.dischargeLatency * 1e9 << " ns" << endl;
     }
     else {
-        ////////////////////////////////////////////
-        double rowDecoderInitLatency;
-        double rowDecoderShiftLatency;
-        double rowDecoderDischargeLatency;
-        double cellDelay;
-        double selectDecoderLatency;
-        double dacLatency;
-        double prechargeLatency;
-        if(inputParameter->lpDecoder){
-            rowDecoderShiftLatency = int(std::ceil((subarray->completeDecoder.readLatency) * CLOCK_FREQ));
-        }
-        else{
-            rowDecoderShiftLatency = int(std::ceil((subarray->completeDecoder.readLatency) * CLOCK_FREQ));
-            rowDecoderInitLatency = int(std::ceil((subarray->completeDecoder.readLatency) * CLOCK_FREQ));
-            rowDecoderDischargeLatency = int(std::ceil((subarray->completeDecoder.dischargeLatency) * CLOCK_FREQ));
-        }
-        
-        cellDelay = int(std::ceil((subarray->cellDelay) * CLOCK_FREQ)) * pow(2, int(inputParameter->inputPrecision));
-        selectDecoderLatency = int(std::ceil(((subarray->selectDecoder.readLatency + subarray->selectDecoder.dischargeLatency) * CLOCK_FREQ))) * 
-                        int(inputParameter->inputPrecision);
-        dacLatency = int(std::ceil((CLOCK_PERIOD * max(double(subarray->numRow) / DTC_BATCH, 1.) * CLOCK_FREQ))) * int(inputParameter->inputPrecision);
-
-        prechargeLatency = int(std::ceil((subarray->precharger.prechargeLatency * CLOCK_FREQ))) * int(inputParameter->inputPrecision);
+        PIMCost cost = calculatePIMCost();
 
         if(!inputParameter->lpDecoder) {
             cout << "   |--- Row Decoder Latency (NR) = " 
-                    << int(rowDecoderInitLatency + selectDecoderLatency + dacLatency + prechargeLatency + rowDecoderDischargeLatency) << " ns" << endl;
+                    << cost.rowDecoderLatency << " ns" << endl;
         }
         else {
             cout << "   |--- Row Decoder Latency (SR) = " 
-                    << int(rowDecoderShiftLatency + selectDecoderLatency + dacLatency + prechargeLatency) << " ns" << endl;
+                    << cost.rowDecoderLatency << " ns" << endl;
         }
         cout << "   |--- Row Decoder Latency (CR) = " 
-                << int(selectDecoderLatency + dacLatency + prechargeLatency) << " ns" << endl;
+                << cost.reuseLatency << " ns" << endl;
         cout << "   |--- Capacitor Drive Latency = " 
-                << int(cellDelay) << " ns" << endl;
+                << cost.capacitorDriveLatency << " ns" << endl;
 
         cout << scientific << "Energy:" << endl;
 
-        /////////////////// PRINT AGAIN /////////////////////////
-        double rowDecoderInitEnergy;
-        double rowDecoderShiftEnergy;
-        double selectDecoderEnergy;
-        double senseAmpEnergy;
-        double prechargeEnergy;
-        double currentEnergy;
-        double leakage;
-        if(inputParameter->lpDecoder){
-            rowDecoderInitEnergy = subarray->completeDecoder.readDynamicEnergy;
-            rowDecoderShiftEnergy = subarray->completeDecoder.shiftEnergy;
-            selectDecoderEnergy = subarray->selectDecoder.readDynamicEnergy * int(inputParameter->inputPrecision);
-            senseAmpEnergy = subarray->capLoad.readDynamicEnergy;
-            prechargeEnergy = subarray->precharger.readDynamicEnergy * int(inputParameter->inputPrecision);
-            // We manually scale the current energy considering the average input and weight value (conservative)
-            currentEnergy = 0.25 * 0.25 * subarray->maxBitlineCurrent * prechargeLatency * CLOCK_PERIOD * cell->prechargeVoltage * subarray->numColumn;
-            leakage = subarray->leakage;
-        }
-        else{
-            rowDecoderInitEnergy = subarray->completeDecoder.readDynamicEnergy;
-            selectDecoderEnergy = subarray->selectDecoder.readDynamicEnergy * int(inputParameter->inputPrecision);
-            senseAmpEnergy = subarray->capLoad.readDynamicEnergy;
-            prechargeEnergy = subarray->precharger.readDynamicEnergy * int(inputParameter->inputPrecision);
-            // We manually scale the current energy considering the average input and weight value (conservative)
-            currentEnergy = 0.25 * 0.25 * subarray->maxBitlineCurrent * prechargeLatency * CLOCK_PERIOD * cell->prechargeVoltage * subarray->numColumn;
-            leakage = subarray->leakage;
-        }
-
         cout << "   |--- CELL + Others = "
-             << (prechargeEnergy + currentEnergy) * 1e12 << " fJ" << endl;
+             << cost.cellEnergy * 1e12 << " fJ" << endl;
         cout << "   |--- Load Capacitor = "
-             << senseAmpEnergy * 1e12 << " fJ" << endl;
+             << cost.loadCapEnergy * 1e12 << " fJ" << endl;
         if(!inputParameter->lpDecoder) {
             cout << "   |---  Row Decoder Energy (NR) = "
-                 << (rowDecoderInitEnergy + selectDecoderEnergy) * 1e12 << " fJ" << endl;
+                 << cost.rowDecoderEnergy * 1e12 << " fJ" << endl;
         }
         else {
             cout << "   |--- Row Decoder Energy (SR) = "
-                 << (rowDecoderShiftEnergy + selectDecoderEnergy) * 1e12 << " fJ" << endl;
+                 << cost.rowDecoderEnergy * 1e12 << " fJ" << endl;
         }
         cout << "   |--- Row Decoder Energy (CR) = "
-             << selectDecoderEnergy * 1e12 << " fJ" << endl;
-        cout << "   |--- Leakage = " << leakage * 1e9 << " nW" << endl;
+             << cost.reuseEnergy * 1e12 << " fJ" << endl;
+        cout << "   |--- Leakage = " << cost.leakage * 1e9 << " nW" << endl;
         cout << "#################################################" << endl;
     }
 }
+
+PIMCost Result::calculatePIMCost() {
+    PIMCost cost;
+
+    double rowDecoderInitLatency = 0;
+    double rowDecoderShiftLatency;
+    double rowDecoderDischargeLatency = 0;
+    double cellDelay;
+    double selectDecoderLatency;
+    double dacLatency;
+    double prechargeLatency;
+    rowDecoderShiftLatency = int(std::ceil((subarray->completeDecoder.readLatency) * CLOCK_FREQ));
+    if(!inputParameter->lpDecoder){
+        rowDecoderInitLatency = int(std::ceil((subarray->completeDecoder.readLatency) * CLOCK_FREQ));
+        rowDecoderDischargeLatency = int(std::ceil((subarray->completeDecoder.dischargeLatency) * CLOCK_FREQ));
+    }
+
+    cellDelay = int(std::ceil((subarray->cellDelay) * CLOCK_FREQ)) * pow(2, int(inputParameter->inputPrecision));
+    selectDecoderLatency = int(std::ceil(((subarray->selectDecoder.readLatency + subarray->selectDecoder.dischargeLatency) * CLOCK_FREQ))) * 
+                    int(inputParameter->inputPrecision);
+    dacLatency = int(std::ceil((CLOCK_PERIOD * max(double(subarray->numRow) / DTC_BATCH, 1.) * CLOCK_FREQ))) * int(inputParameter->inputPrecision);
+
+    prechargeLatency = int(std::ceil((subarray->precharger.prechargeLatency * CLOCK_FREQ))) * int(inputParameter->inputPrecision);
+
+    if(!inputParameter->lpDecoder) {
+        cost.rowDecoderLatency = int(rowDecoderInitLatency + selectDecoderLatency + dacLatency + prechargeLatency + rowDecoderDischargeLatency);
+    }
+    else {
+        cost.rowDecoderLatency = int(rowDecoderShiftLatency + selectDecoderLatency + dacLatency + prechargeLatency);
+    }
+    cost.reuseLatency = int(selectDecoderLatency + dacLatency + prechargeLatency);
+    cost.capacitorDriveLatency = int(cellDelay);
+
+    double selectDecoderEnergy = subarray->selectDecoder.readDynamicEnergy * int(inputParameter->inputPrecision);
+    double prechargeEnergy = subarray->precharger.readDynamicEnergy * int(inputParameter->inputPrecision);
+    // We manually scale the current energy considering the average input and weight value (conservative)
+    double currentEnergy = 0.25 * 0.25 * subarray->maxBitlineCurrent * prechargeLatency * CLOCK_PERIOD * cell->prechargeVoltage * subarray->numColumn;
+
+    cost.cellEnergy = prechargeEnergy + currentEnergy;
+    cost.loadCapEnergy = subarray->capLoad.readDynamicEnergy;
+    if(inputParameter->lpDecoder) {
+        cost.rowDecoderEnergy = subarray->completeDecoder.shiftEnergy + selectDecoderEnergy;
+    }
+    else {
+        cost.rowDecoderEnergy = subarray->completeDecoder.readDynamicEnergy + selectDecoderEnergy;
+    }
+    cost.reuseEnergy = selectDecoderEnergy;
+    cost.leakage = subarray->leakage;
+
+    return cost;
+}
+
+void Result::printCompilerConfig(const string & fileName) {
+    /* The compiler charges every MVM the capacitor drive, plus either a
+     * stack shift or a stack reuse; ADC costs come from HSPICE instead */
+    PIMCost cost = calculatePIMCost();
+    ofstream file(fileName.c_str());
+    if (!file.good()) {
+        cout << "[NAND Flash (PIM) Error]: Cannot open " << fileName << endl;
+        exit(-1);
+    }
+    file << "#" << endl;
+    file << "# MVMU parameters exported by 3DNAND_SIM (" << inputParameter->numStack
+            << " stacks, " << subarray->numRow << "x" << subarray->numColumn
+            << " subarray, " << inputParameter->inputPrecision << "-bit input)." << endl;
+    file << "# Latencies are in cycles at " << CLOCK_FREQ / 1e9 << " GHz, energies in pJ." << endl;
+    file << "#" << endl;
+    file << "MVMU_DPT = " << inputParameter->numStack << endl;
+    file << "STACK_SHIFT_LATENCY = " << cost.rowDecoderLatency << endl;
+    file << "STACK_REUSE_LATENCY = " << cost.reuseLatency << endl;
+    file << "PRECHARGE_LATENCY = " << cost.capacitorDriveLatency << endl;
+    file << scientific << setprecision(6);
+    file << "STACK_SHIFT_ENERGY = " << cost.rowDecoderEnergy * 1e12 << endl;
+    file << "STACK_REUSE_ENERGY = " << cost.reuseEnergy * 1e12 << endl;
+    file << "PRECHARGE_ENERGY = " << (cost.cellEnergy + cost.loadCapEnergy) * 1e12 << endl;
+    file.close();
+}
@@ -10,9 +10,23 @@
 #ifndef RESULT_H_
 #define RESULT_H_
 
+#include <string>
+
 #include "SubArray.h"
 #include "Wire.h"
 
+/* Cost of a single MVM step in PIM mode */
+struct PIMCost {
+    int rowDecoderLatency;      /* Stack shift (SR), or full decode (NR) without the LP decoder, Unit: cycles */
+    int reuseLatency;           /* Stack reuse (CR), Unit: cycles */
+    int capacitorDriveLatency;  /* Unit: cycles */
+    double cellEnergy;          /* Cells, bitlines and precharger, Unit: J */
+    double loadCapEnergy;       /* Unit: J */
+    double rowDecoderEnergy;    /* SR or NR, Unit: J */
+    double reuseEnergy;         /* CR, Unit: J */
+    double leakage;             /* Unit: W */
+};
+
 class Result {
 public:
     Result();
@@ -22,6 +36,8 @@ public:
     void print();
     void reset();
     void compareAndUpdate(Result &newResult);
+    PIMCost calculatePIMCost();
+    void printCompilerConfig(const std::string & fileName);  /* Writes the PIM costs as compiler hardware parameters */
 
     OptimizationTarget optimizationTarget;  /* Exploration should not be assigned here */
 
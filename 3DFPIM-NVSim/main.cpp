@@ -46,14 +46,18 @@ int main(int argc, char *argv[])
 {
     cout << fixed << setprecision(3);
     string inputFileName;
+    string compilerConfigFileName;
 
-    if (argc == 2) {
+    if (argc == 2 || argc == 3) {
         inputFileName = argv[1];
         cout << "User-defined configuration file (" << inputFileName << ") is loaded" << endl;
+        if (argc == 3)
+            compilerConfigFileName = argv[2];
     } else {
         cout << "[NAND Flash (PIM) Error]: Please use the correct format as follows" << endl;
         cout << "  Use the default configuration: " << argv[0] << endl;
         cout << "  Use the customized configuration: " << argv[0] << " <.cfg file>"  << endl;
+        cout << "  Also export the compiler parameters (PIM mode): " << argv[0] << " <.cfg file> <compiler .cfg file>"  << endl;
         exit(-1);
     }
     cout << endl;
@@ -266,6 +270,14 @@ int main(int argc, char *argv[])
     if (inputParameter->optimizationTarget != full_exploration) {
         if (numSolution > 0) {
             bestDataResults[inputParameter->optimizationTarget].print();
+            if (!compilerConfigFileName.empty()) {
+                if (inputParameter->pimMode) {
+                    bestDataResults[inputParameter->optimizationTarget].printCompilerConfig(compilerConfigFileName);
+                    cout << "Compiler parameters are written to " << compilerConfigFileName << endl;
+                } else {
+                    cout << "[NAND Flash (PIM) Error]: Compiler parameters are only available in PIM mode" << endl;
+                }
+            }
         } else {
             cout << "No valid solutions." << endl;
         }